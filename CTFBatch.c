@@ -0,0 +1,1788 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "CTFBatch.h"
+
+#ifdef CTF_HAVE_POSIX
+#include <dirent.h>
+#include <pthread.h>
+#endif
+
+#if defined(_WIN32)
+#include <direct.h>
+#define make_directory(path) _mkdir(path)
+#else
+#define make_directory(path) mkdir(path, 0777)
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#include "CTFPatch.h"
+
+#ifdef CTF_HAVE_POSIX
+#include "CTFUring.h"
+#include "CTFWorkPool.h"
+#endif
+
+typedef struct
+{
+	char *input_rom_path;
+	char *relative_path;
+	char *output_rom_path;
+	int status;
+	SC55ROMStats stats;
+	/* Set when this job patched a digest that later duplicates link to */
+	int owns_digest;
+	/* Set when the outputs were linked to an identical ROM's */
+	int linked;
+	uint8_t rom_sha256[32];
+	/* Digest of the output written, for jobs that write a single output */
+	uint8_t output_sha256[32];
+} batch_job;
+
+typedef struct
+{
+	batch_job *jobs;
+	size_t num_jobs;
+	size_t capacity;
+} batch_job_list;
+
+#define DIGEST_EMPTY 0
+#define DIGEST_PENDING 1
+#define DIGEST_DONE 2
+#define DIGEST_FAILED 3
+
+#ifdef CTF_HAVE_POSIX
+typedef struct
+{
+	uint8_t rom_sha256[32];
+	batch_job *owner;
+	int state;
+} digest_entry;
+
+/*
+** Input digests seen in a batch, for linking duplicate outputs.  Every
+** job in a batch uses the same options, so the digest alone identifies
+** the result.  The table is sized for every job up front and never
+** grows; entries are found by open addressing on the digest.
+*/
+typedef struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t finished;
+	digest_entry *entries;
+	size_t mask;
+} batch_dedup;
+
+typedef struct
+{
+	batch_job *job;
+	/* A copy of the batch options, with stats pointing at the job's own */
+	rom_patch_options options;
+	batch_dedup *dedup;
+} batch_task;
+
+/* Files each io_uring worker keeps in flight */
+#define RING_DEPTH 16
+
+/* Reads start with room for any known ROM and double for larger files */
+#define RING_BUFFER_SIZE 0x200000
+
+/* Completions of closes that nothing waits for */
+#define RING_IGNORE UINT64_MAX
+
+#define RING_OPEN_INPUT 0
+#define RING_READ 1
+#define RING_OPEN_OUTPUT 2
+#define RING_WRITE 3
+#define RING_CLOSE_OUTPUT 4
+
+/* One file moving through an io_uring worker; its buffer is kept for the next file */
+typedef struct
+{
+	batch_task *task;
+	int state;
+	int fd;
+	uint8_t *data;
+	size_t capacity;
+	size_t size;
+	size_t written;
+	int made_directories;
+	SC55ROMData rom;
+} ring_slot;
+
+/* The tasks of a batch, handed out in order to io_uring workers */
+typedef struct
+{
+	pthread_mutex_t lock;
+	batch_task *tasks;
+	size_t num_tasks;
+	size_t next_task;
+} ring_batch;
+#else
+/* Batches need threads, so outside POSIX only the single-ROM paths are built and nothing is deduplicated */
+typedef struct batch_dedup batch_dedup;
+#endif
+
+static const uint8_t variant_compat_modes[] = { SC55_STRICT_SC55_COMPAT, SC55_SC55_COMPAT, SC55_SC55MKII_COMPAT };
+static const uint8_t variant_drum_compat_modes[] = { SC55_DRUM_EARLY_COMPAT, SC55_DRUM_LATE_COMPAT };
+
+#define NUM_VARIANTS (sizeof(variant_compat_modes) * sizeof(variant_drum_compat_modes))
+
+static int make_parent_directories(const char *file_path);
+
+static void init_read_options(SC55ReadOptions *read_options, const rom_patch_options *options)
+{
+	InitReadOptions(read_options);
+	read_options->ignore_sha256_failures = options->ignore_checksum;
+	read_options->use_mmap = options->use_mmap;
+	read_options->hash_database = options->hash_database;
+	read_options->stats = options->stats;
+	read_options->buffer_pool = options->buffer_pool;
+}
+
+static SC55ROMData read_rom(const char *input_rom_path, const rom_patch_options *options)
+{
+	SC55ReadOptions read_options;
+
+	init_read_options(&read_options, options);
+
+	if(strcmp(input_rom_path, ROM_PATH_STDIO) == 0)
+	{
+		return ReadROMStream(stdin, &read_options);
+	}
+
+	return ReadROMWithOptions(input_rom_path, &read_options);
+}
+
+/*
+** Writes a ROM patched with the given modes, hashing the output as it
+** goes into output_sha256 and checking it against the known patched
+** digests.  stdout is written as one stream; a file is written as a
+** clone of the input plus the patched ranges when the input is a file.
+** Returns a ROM_JOB_ status.
+*/
+static int write_rom(const SC55ROMData *rom, const char *input_rom_path, const char *output_rom_path, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version, uint8_t output_sha256[32])
+{
+	int result;
+
+	if(strcmp(output_rom_path, ROM_PATH_STDIO) == 0)
+	{
+		result = WriteROMStreamWithDigest(rom, stdout, output_sha256);
+	}
+	else
+	{
+		result = WriteROMDeltaWithDigest(rom, strcmp(input_rom_path, ROM_PATH_STDIO) == 0 ? NULL : input_rom_path, output_rom_path, output_sha256);
+	}
+
+	if(result != 0)
+	{
+		return ROM_JOB_WRITE_FAILED;
+	}
+
+	if(CheckPatchedDigest(rom->rom_sha256, compat_mode, drum_compat_mode, update_version, output_sha256) == SC55_PATCHED_DIGEST_MISMATCH)
+	{
+		return ROM_JOB_VERIFY_FAILED;
+	}
+
+	return ROM_JOB_OK;
+}
+
+static void print_digest(FILE *fp, const uint8_t sha256[32])
+{
+	size_t i;
+
+	for(i = 0; i < 32; i++)
+	{
+		fprintf(fp, "%02x", sha256[i]);
+	}
+}
+
+/* Returns a malloc()ed path for the cache entry of patch, or NULL */
+static char *patch_cache_path(const char *cache_directory, const SC55ROMData *rom, const SC55ROMPatch *patch)
+{
+	char *path = (char*)malloc(strlen(cache_directory) + 96);
+	size_t length;
+	size_t i;
+
+	if(path == NULL)
+	{
+		return NULL;
+	}
+
+	length = (size_t)sprintf(path, "%s/", cache_directory);
+	for(i = 0; i < 32; i++)
+	{
+		length += (size_t)sprintf(path + length, "%02x", rom->rom_sha256[i]);
+	}
+	sprintf(path + length, "-%s-%s-%s.ctfp", compat_mode_name(patch->compat_mode), drum_compat_mode_name(patch->drum_compat_mode), patch->update_version ? "ct" : "orig");
+
+	return path;
+}
+
+/*
+** Fills each patch, whose modes are already set, from the patch cache
+** where a valid entry exists and builds the rest, storing them in the
+** cache for next time.  A cache that cannot be written is not an error.
+*/
+static int build_patches(const SC55ROMData *rom, SC55ROMPatch *patches, const size_t num_patches, const rom_patch_options *options)
+{
+	char *cache_path;
+	size_t i;
+	int result = 0;
+
+	if(options->cache_directory == NULL)
+	{
+		return BuildROMPatches(rom, patches, num_patches);
+	}
+
+	for(i = 0; i < num_patches && result == 0; i++)
+	{
+		cache_path = patch_cache_path(options->cache_directory, rom, &patches[i]);
+		if(cache_path == NULL || LoadROMPatch(rom, &patches[i], cache_path) != 0)
+		{
+			result = BuildROMPatches(rom, &patches[i], 1);
+			if(result == 0 && cache_path != NULL && make_parent_directories(cache_path) == 0)
+			{
+				SaveROMPatch(rom, &patches[i], cache_path);
+			}
+		}
+		free(cache_path);
+	}
+
+	return result;
+}
+
+int patch_rom_data(SC55ROMData *rom_data, const rom_patch_options *options)
+{
+	SC55ROMPatch *patch = (SC55ROMPatch*)malloc(sizeof(SC55ROMPatch));
+	int result;
+
+	if(!patch)
+	{
+		return 1;
+	}
+
+	patch->compat_mode = options->sc55_compat_mode;
+	patch->drum_compat_mode = options->sc55_drum_compat_mode;
+	patch->update_version = options->update_version;
+
+	result = build_patches(rom_data, patch, 1, options) != 0 || ApplyROMPatch(rom_data, patch) != 0;
+	free(patch);
+
+	return result;
+}
+
+static int link_duplicate(batch_dedup *dedup, batch_job *job, const SC55ROMData *rom_data, const rom_patch_options *options);
+static void finish_digest(batch_dedup *dedup, batch_job *job, int status);
+
+/* Patches and writes a ROM that has been read, storing the output's digest in output_sha256, then destroys it */
+static int write_patched_rom(SC55ROMData *rom_data, const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress, uint8_t output_sha256[32])
+{
+	int operation_result = 0;
+
+	if(patch_rom_data(rom_data, options) != 0)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Error applying ROM patch.\n");
+		}
+		DestroyROM(rom_data);
+		return ROM_JOB_PATCH_FAILED;
+	}
+
+	if(progress)
+	{
+		fprintf(progress, "ROM data patched.  Writing...\n");
+	}
+
+	operation_result = write_rom(rom_data, input_rom_path, output_rom_path, options->sc55_compat_mode, options->sc55_drum_compat_mode, options->update_version, output_sha256);
+	DestroyROM(rom_data);
+	if(operation_result == ROM_JOB_VERIFY_FAILED)
+	{
+		if(progress)
+		{
+			fprintf(progress, "ROM written to %s, but its SHA-256 does not match the expected patched ROM.\n", output_rom_path);
+		}
+		return operation_result;
+	}
+
+	if(operation_result)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Error writing ROM to %s\n", output_rom_path);
+		}
+		return ROM_JOB_WRITE_FAILED;
+	}
+
+	if(progress)
+	{
+		fprintf(progress, "ROM written successfully.  SHA-256: ");
+		print_digest(progress, output_sha256);
+		fprintf(progress, "\n");
+	}
+
+	return ROM_JOB_OK;
+}
+
+static int patch_rom_job(const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress, batch_dedup *dedup, batch_job *job)
+{
+	SC55ROMData rom_data;
+	uint8_t output_sha256[32];
+	int status;
+
+	if(progress)
+	{
+		fprintf(progress, "Reading ROM...\n");
+	}
+
+	rom_data = read_rom(input_rom_path, options);
+
+	if(!rom_data.rom_data)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Unable to read ROM data from %s\n", input_rom_path);
+			fprintf(progress, "Verify that the ROM is a supported image.\n");
+		}
+		return ROM_JOB_READ_FAILED;
+	}
+
+	if(progress)
+	{
+		fprintf(progress, "ROM data read.  Patching...\n");
+	}
+
+	if(dedup && link_duplicate(dedup, job, &rom_data, options) == 0)
+	{
+		DestroyROM(&rom_data);
+		return ROM_JOB_OK;
+	}
+
+	status = write_patched_rom(&rom_data, input_rom_path, output_rom_path, options, progress, job ? job->output_sha256 : output_sha256);
+	finish_digest(dedup, job, status);
+
+	return status;
+}
+
+int patch_rom_file(const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress)
+{
+	return patch_rom_job(input_rom_path, output_rom_path, options, progress, NULL, NULL);
+}
+
+/* Builds, patches and writes every variant of a ROM that has been read, then destroys it */
+static int write_patched_variants(SC55ROMData *rom_data, const char *input_rom_path, const char *output_template, const char *relative_path, const rom_patch_options *options, const int create_directories, FILE *progress)
+{
+	SC55ROMPatch *patches;
+	char *output_rom_path;
+	uint8_t output_sha256[32];
+	size_t i;
+	int result;
+	int status = ROM_JOB_OK;
+
+	/* Every variant is built from the unpatched tables, before any of them is applied */
+	patches = (SC55ROMPatch*)malloc(NUM_VARIANTS * sizeof(SC55ROMPatch));
+	if(patches == NULL)
+	{
+		DestroyROM(rom_data);
+		return ROM_JOB_PATCH_FAILED;
+	}
+
+	for(i = 0; i < NUM_VARIANTS; i++)
+	{
+		patches[i].compat_mode = variant_compat_modes[i / sizeof(variant_drum_compat_modes)];
+		patches[i].drum_compat_mode = variant_drum_compat_modes[i % sizeof(variant_drum_compat_modes)];
+		patches[i].update_version = options->update_version;
+	}
+
+	if(build_patches(rom_data, patches, NUM_VARIANTS, options) != 0)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Error applying ROM patch.\n");
+		}
+		free(patches);
+		DestroyROM(rom_data);
+		return ROM_JOB_PATCH_FAILED;
+	}
+
+	for(i = 0; i < NUM_VARIANTS; i++)
+	{
+		output_rom_path = expand_output_template(output_template, relative_path, patches[i].compat_mode, patches[i].drum_compat_mode);
+		if(output_rom_path == NULL || (create_directories && make_parent_directories(output_rom_path) != 0))
+		{
+			free(output_rom_path);
+			if(status == ROM_JOB_OK)
+			{
+				status = ROM_JOB_OUTPUT_PATH_FAILED;
+			}
+			continue;
+		}
+
+		if(progress)
+		{
+			fprintf(progress, "Writing %s/%s variant to %s...\n", compat_mode_name(patches[i].compat_mode), drum_compat_mode_name(patches[i].drum_compat_mode), output_rom_path);
+		}
+
+		if(ApplyROMPatch(rom_data, &patches[i]) != 0)
+		{
+			if(status == ROM_JOB_OK)
+			{
+				status = ROM_JOB_PATCH_FAILED;
+			}
+		}
+		else if((result = write_rom(rom_data, input_rom_path, output_rom_path, patches[i].compat_mode, patches[i].drum_compat_mode, patches[i].update_version, output_sha256)) != ROM_JOB_OK)
+		{
+			if(progress)
+			{
+				fprintf(progress, result == ROM_JOB_VERIFY_FAILED ? "SHA-256 of %s does not match the expected patched ROM\n" : "Error writing ROM to %s\n", output_rom_path);
+			}
+			if(status == ROM_JOB_OK)
+			{
+				status = result;
+			}
+		}
+
+		free(output_rom_path);
+	}
+
+	free(patches);
+	DestroyROM(rom_data);
+
+	if(progress && status == ROM_JOB_OK)
+	{
+		fprintf(progress, "ROMs written successfully.\n");
+	}
+
+	return status;
+}
+
+static int patch_rom_variants_job(const char *input_rom_path, const char *output_template, const char *relative_path, const rom_patch_options *options, const int create_directories, FILE *progress, batch_dedup *dedup, batch_job *job)
+{
+	SC55ROMData rom_data;
+	int status;
+
+	if(progress)
+	{
+		fprintf(progress, "Reading ROM...\n");
+	}
+
+	rom_data = read_rom(input_rom_path, options);
+
+	if(!rom_data.rom_data)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Unable to read ROM data from %s\n", input_rom_path);
+			fprintf(progress, "Verify that the ROM is a supported image.\n");
+		}
+		return ROM_JOB_READ_FAILED;
+	}
+
+	if(progress)
+	{
+		fprintf(progress, "ROM data read.  Patching...\n");
+	}
+
+	if(dedup && link_duplicate(dedup, job, &rom_data, options) == 0)
+	{
+		DestroyROM(&rom_data);
+		return ROM_JOB_OK;
+	}
+
+	status = write_patched_variants(&rom_data, input_rom_path, output_template, relative_path, options, create_directories, progress);
+	finish_digest(dedup, job, status);
+
+	return status;
+}
+
+int patch_rom_file_variants(const char *input_rom_path, const char *output_template, const char *relative_path, const rom_patch_options *options, const int create_directories, FILE *progress)
+{
+	return patch_rom_variants_job(input_rom_path, output_template, relative_path, options, create_directories, progress, NULL, NULL);
+}
+
+
+const char *compat_mode_name(const uint8_t sc55_compat_mode)
+{
+	switch(sc55_compat_mode)
+	{
+		case SC55_STRICT_SC55_COMPAT:
+			return "strict";
+		case SC55_SC55MKII_COMPAT:
+			return "mkii";
+		default:
+			return "sc55";
+	}
+}
+
+const char *drum_compat_mode_name(const uint8_t sc55_drum_compat_mode)
+{
+	return sc55_drum_compat_mode == SC55_DRUM_LATE_COMPAT ? "late" : "early";
+}
+
+const char *rom_job_status_string(const int status)
+{
+	switch(status)
+	{
+		case ROM_JOB_OK:
+			return "ok";
+		case ROM_JOB_READ_FAILED:
+			return "unable to read ROM or ROM not supported";
+		case ROM_JOB_PATCH_FAILED:
+			return "unable to patch ROM";
+		case ROM_JOB_WRITE_FAILED:
+			return "unable to write ROM";
+		case ROM_JOB_OUTPUT_PATH_FAILED:
+			return "unable to create output path";
+		case ROM_JOB_SERVER_UNAVAILABLE:
+			return "unable to reach patch server";
+		case ROM_JOB_SERVER_FAILED:
+			return "patch server request failed";
+		case ROM_JOB_VERIFY_FAILED:
+			return "patched ROM does not match its known digest";
+		case ROM_JOB_SERVER_SKIPPED:
+			return "input and output are the same file";
+		default:
+			return "unknown error";
+	}
+}
+
+void add_rom_stats(SC55ROMStats *total, const SC55ROMStats *from)
+{
+	total->read_ns += from->read_ns;
+	total->hash_ns += from->hash_ns;
+	total->identify_ns += from->identify_ns;
+	total->patch_ns += from->patch_ns;
+	total->write_ns += from->write_ns;
+	total->bytes_read += from->bytes_read;
+	total->bytes_hashed += from->bytes_hashed;
+	total->bytes_written += from->bytes_written;
+	total->sub_capital_fills += from->sub_capital_fills;
+	total->capital_fills += from->capital_fills;
+	total->drum_fills += from->drum_fills;
+	total->identified += from->identified;
+}
+
+void print_rom_stats_json(const SC55ROMStats *stats, FILE *output)
+{
+	fprintf(output, "{\"phases_ns\": {\"read\": %llu, \"hash\": %llu, \"identify\": %llu, \"patch\": %llu, \"write\": %llu}, ",
+		(unsigned long long)stats->read_ns,
+		(unsigned long long)stats->hash_ns,
+		(unsigned long long)stats->identify_ns,
+		(unsigned long long)stats->patch_ns,
+		(unsigned long long)stats->write_ns);
+	fprintf(output, "\"bytes\": {\"read\": %llu, \"hashed\": %llu, \"written\": %llu}, ",
+		(unsigned long long)stats->bytes_read,
+		(unsigned long long)stats->bytes_hashed,
+		(unsigned long long)stats->bytes_written);
+	fprintf(output, "\"fills\": {\"sub_capital\": %lu, \"capital\": %lu, \"drum\": %lu}, \"identified\": %lu}\n",
+		(unsigned long)stats->sub_capital_fills,
+		(unsigned long)stats->capital_fills,
+		(unsigned long)stats->drum_fills,
+		(unsigned long)stats->identified);
+}
+
+static void append_text(char **buffer, size_t *length, size_t *capacity, const char *text, size_t text_length)
+{
+	char *grown;
+
+	if(*buffer == NULL)
+	{
+		return;
+	}
+
+	if(*length + text_length + 1 > *capacity)
+	{
+		*capacity = (*length + text_length + 1) * 2;
+		grown = (char*)realloc(*buffer, *capacity);
+		if(grown == NULL)
+		{
+			free(*buffer);
+			*buffer = NULL;
+			return;
+		}
+		*buffer = grown;
+	}
+
+	memcpy(*buffer + *length, text, text_length);
+	*length += text_length;
+	(*buffer)[*length] = 0;
+}
+
+char *expand_output_template(const char *output_template, const char *relative_path, const uint8_t sc55_compat_mode, const uint8_t sc55_drum_compat_mode)
+{
+	const char *file_name = strrchr(relative_path, '/');
+	const char *extension;
+	size_t directory_length;
+	size_t stem_length;
+	size_t capacity = strlen(output_template) + strlen(relative_path) + 16;
+	size_t length = 0;
+	char *expanded = (char*)malloc(capacity);
+
+	file_name = file_name ? file_name + 1 : relative_path;
+	directory_length = (size_t)(file_name - relative_path);
+	extension = strrchr(file_name, '.');
+	if(extension == NULL || extension == file_name)
+	{
+		extension = file_name + strlen(file_name);
+	}
+	stem_length = (size_t)(extension - file_name);
+
+	if(expanded == NULL)
+	{
+		return NULL;
+	}
+	expanded[0] = 0;
+
+	while(*output_template && expanded)
+	{
+		if(*output_template != '%')
+		{
+			append_text(&expanded, &length, &capacity, output_template, 1);
+			output_template++;
+			continue;
+		}
+
+		switch(output_template[1])
+		{
+			case 'p':
+				append_text(&expanded, &length, &capacity, relative_path, directory_length);
+				break;
+			case 'f':
+				append_text(&expanded, &length, &capacity, file_name, strlen(file_name));
+				break;
+			case 'n':
+				append_text(&expanded, &length, &capacity, file_name, stem_length);
+				break;
+			case 'e':
+				append_text(&expanded, &length, &capacity, extension, strlen(extension));
+				break;
+			case 's':
+				append_text(&expanded, &length, &capacity, compat_mode_name(sc55_compat_mode), strlen(compat_mode_name(sc55_compat_mode)));
+				break;
+			case 'd':
+				append_text(&expanded, &length, &capacity, drum_compat_mode_name(sc55_drum_compat_mode), strlen(drum_compat_mode_name(sc55_drum_compat_mode)));
+				break;
+			case '%':
+				append_text(&expanded, &length, &capacity, "%", 1);
+				break;
+			default:
+				free(expanded);
+				return NULL;
+		}
+
+		output_template += 2;
+	}
+
+	return expanded;
+}
+
+int output_template_has_token(const char *output_template, const char token)
+{
+	while(*output_template)
+	{
+		if(*output_template == '%' && output_template[1])
+		{
+			if(output_template[1] == token)
+			{
+				return 1;
+			}
+			output_template += 2;
+			continue;
+		}
+		output_template++;
+	}
+
+	return 0;
+}
+
+static int make_parent_directories(const char *file_path)
+{
+	char *path = strdup(file_path);
+	char *separator;
+	int result = 0;
+
+	if(path == NULL)
+	{
+		return 1;
+	}
+
+	for(separator = strchr(path + 1, '/'); separator != NULL && result == 0; separator = strchr(separator + 1, '/'))
+	{
+		*separator = 0;
+		if(make_directory(path) != 0 && errno != EEXIST)
+		{
+			result = 1;
+		}
+		*separator = '/';
+	}
+
+	free(path);
+	return result;
+}
+
+#ifdef CTF_HAVE_POSIX
+/*
+** Points destination at the same data as source: a reflink where the
+** filesystem supports one, since it shares blocks but stays
+** copy-on-write, or failing that a hardlink.  Writes to an output with
+** other hardlinks replace it rather than changing every name.
+*/
+static int link_output(const char *source_path, const char *destination_path)
+{
+#if defined(__linux__) && defined(FICLONE)
+	int source_fd;
+	int destination_fd;
+	int result;
+#endif
+
+	if(strcmp(source_path, destination_path) == 0)
+	{
+		return 0;
+	}
+
+	if(unlink(destination_path) != 0 && errno != ENOENT)
+	{
+		return 1;
+	}
+
+#if defined(__linux__) && defined(FICLONE)
+	source_fd = open(source_path, O_RDONLY);
+	if(source_fd < 0)
+	{
+		return 1;
+	}
+
+	destination_fd = open(destination_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	if(destination_fd < 0)
+	{
+		close(source_fd);
+		return 1;
+	}
+
+	result = ioctl(destination_fd, FICLONE, source_fd);
+	close(source_fd);
+	close(destination_fd);
+	if(result == 0)
+	{
+		return 0;
+	}
+	unlink(destination_path);
+#endif
+
+	return link(source_path, destination_path) == 0 ? 0 : 1;
+}
+
+int unshare_output(const char *output_rom_path)
+{
+	struct stat st;
+
+	if(lstat(output_rom_path, &st) == 0 && S_ISREG(st.st_mode) && st.st_nlink > 1 && unlink(output_rom_path) != 0)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Links every output of job to the matching output of owner, removing them all if any fails */
+static int link_outputs(const batch_job *owner, const batch_job *job, const rom_patch_options *options)
+{
+	char *source_paths[NUM_VARIANTS];
+	char *destination_paths[NUM_VARIANTS];
+	size_t linked = 0;
+	size_t i;
+	int result = 0;
+
+	if(!options->all_variants)
+	{
+		return link_output(owner->output_rom_path, job->output_rom_path);
+	}
+
+	for(i = 0; i < NUM_VARIANTS; i++)
+	{
+		source_paths[i] = expand_output_template(owner->output_rom_path, owner->relative_path, variant_compat_modes[i / sizeof(variant_drum_compat_modes)], variant_drum_compat_modes[i % sizeof(variant_drum_compat_modes)]);
+		destination_paths[i] = expand_output_template(job->output_rom_path, job->relative_path, variant_compat_modes[i / sizeof(variant_drum_compat_modes)], variant_drum_compat_modes[i % sizeof(variant_drum_compat_modes)]);
+	}
+
+	for(i = 0; i < NUM_VARIANTS && result == 0; i++)
+	{
+		if(source_paths[i] == NULL || destination_paths[i] == NULL || make_parent_directories(destination_paths[i]) != 0 || link_output(source_paths[i], destination_paths[i]) != 0)
+		{
+			result = 1;
+			break;
+		}
+		linked++;
+	}
+
+	/* A partial set would leave outputs sharing an inode with the owner's when this job rewrites them */
+	for(i = 0; i < linked && result != 0; i++)
+	{
+		if(strcmp(source_paths[i], destination_paths[i]) != 0)
+		{
+			unlink(destination_paths[i]);
+		}
+	}
+
+	for(i = 0; i < NUM_VARIANTS; i++)
+	{
+		free(source_paths[i]);
+		free(destination_paths[i]);
+	}
+
+	return result;
+}
+
+/* Digests are already uniform, so their leading bytes serve as the hash */
+static size_t first_digest_slot(const batch_dedup *dedup, const uint8_t rom_sha256[32])
+{
+	return ((size_t)rom_sha256[0] | ((size_t)rom_sha256[1] << 8) | ((size_t)rom_sha256[2] << 16) | ((size_t)rom_sha256[3] << 24)) & dedup->mask;
+}
+
+/*
+** Claims the digest of rom_data for job, or waits for the job that
+** already claimed it to finish.  Returns that job if it succeeded, or
+** NULL if this job should patch the ROM itself.
+*/
+static batch_job *wait_for_digest(batch_dedup *dedup, batch_job *job, const SC55ROMData *rom_data)
+{
+	digest_entry *entry;
+	batch_job *owner = NULL;
+	size_t index;
+
+	memcpy(job->rom_sha256, rom_data->rom_sha256, sizeof(job->rom_sha256));
+	index = first_digest_slot(dedup, job->rom_sha256);
+
+	pthread_mutex_lock(&dedup->lock);
+
+	for(;;)
+	{
+		entry = &dedup->entries[index];
+		if(entry->state == DIGEST_EMPTY || memcmp(entry->rom_sha256, job->rom_sha256, sizeof(job->rom_sha256)) == 0)
+		{
+			break;
+		}
+		index = (index + 1) & dedup->mask;
+	}
+
+	if(entry->state == DIGEST_EMPTY || entry->state == DIGEST_FAILED)
+	{
+		/* A failed owner hands the digest to the next job, which may still succeed */
+		memcpy(entry->rom_sha256, job->rom_sha256, sizeof(job->rom_sha256));
+		entry->owner = job;
+		entry->state = DIGEST_PENDING;
+		job->owns_digest = 1;
+	}
+	else
+	{
+		while(entry->state == DIGEST_PENDING)
+		{
+			pthread_cond_wait(&dedup->finished, &dedup->lock);
+		}
+
+		if(entry->state == DIGEST_DONE)
+		{
+			owner = entry->owner;
+		}
+		else
+		{
+			entry->owner = job;
+			entry->state = DIGEST_PENDING;
+			job->owns_digest = 1;
+		}
+	}
+
+	pthread_mutex_unlock(&dedup->lock);
+
+	return owner;
+}
+
+static int link_duplicate(batch_dedup *dedup, batch_job *job, const SC55ROMData *rom_data, const rom_patch_options *options)
+{
+	batch_job *owner = wait_for_digest(dedup, job, rom_data);
+
+	if(owner == NULL || link_outputs(owner, job, options) != 0)
+	{
+		return 1;
+	}
+
+	job->linked = 1;
+	memcpy(job->output_sha256, owner->output_sha256, sizeof(job->output_sha256));
+	return 0;
+}
+
+static void finish_digest(batch_dedup *dedup, batch_job *job, int status)
+{
+	size_t index;
+
+	if(dedup == NULL || !job->owns_digest)
+	{
+		return;
+	}
+
+	index = first_digest_slot(dedup, job->rom_sha256);
+
+	pthread_mutex_lock(&dedup->lock);
+	while(memcmp(dedup->entries[index].rom_sha256, job->rom_sha256, sizeof(job->rom_sha256)) != 0)
+	{
+		index = (index + 1) & dedup->mask;
+	}
+	dedup->entries[index].state = status == ROM_JOB_OK ? DIGEST_DONE : DIGEST_FAILED;
+	pthread_cond_broadcast(&dedup->finished);
+	pthread_mutex_unlock(&dedup->lock);
+}
+
+static int add_job(batch_job_list *list, const char *input_rom_path, const char *relative_path, const char *output_rom_path)
+{
+	batch_job *jobs;
+	batch_job *job;
+
+	if(list->num_jobs == list->capacity)
+	{
+		list->capacity = list->capacity ? list->capacity * 2 : 64;
+		jobs = (batch_job*)realloc(list->jobs, list->capacity * sizeof(batch_job));
+		if(jobs == NULL)
+		{
+			return 1;
+		}
+		list->jobs = jobs;
+	}
+
+	job = &list->jobs[list->num_jobs];
+	job->input_rom_path = strdup(input_rom_path);
+	job->relative_path = strdup(relative_path);
+	job->output_rom_path = output_rom_path ? strdup(output_rom_path) : NULL;
+	job->status = ROM_JOB_OK;
+	job->owns_digest = 0;
+	job->linked = 0;
+
+	if(!job->input_rom_path || !job->relative_path || (output_rom_path && !job->output_rom_path))
+	{
+		free(job->input_rom_path);
+		free(job->relative_path);
+		free(job->output_rom_path);
+		return 1;
+	}
+
+	list->num_jobs++;
+	return 0;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* Adds every regular file under root/relative_directory, in name order so runs are repeatable */
+static int collect_directory(batch_job_list *list, const char *root, const char *relative_directory)
+{
+	DIR *dir;
+	struct dirent *entry;
+	struct stat st;
+	char *directory_path;
+	char *entry_path;
+	char *relative_path;
+	char **names = NULL;
+	char **grown;
+	size_t num_names = 0;
+	size_t capacity = 0;
+	size_t i;
+	int result = 0;
+
+	directory_path = (char*)malloc(strlen(root) + strlen(relative_directory) + 2);
+	if(directory_path == NULL)
+	{
+		return 1;
+	}
+	sprintf(directory_path, "%s/%s", root, relative_directory);
+
+	dir = opendir(directory_path);
+	free(directory_path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+		{
+			continue;
+		}
+
+		if(num_names == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 64;
+			grown = (char**)realloc(names, capacity * sizeof(char*));
+			if(grown == NULL)
+			{
+				result = 1;
+				break;
+			}
+			names = grown;
+		}
+
+		names[num_names] = strdup(entry->d_name);
+		if(names[num_names] == NULL)
+		{
+			result = 1;
+			break;
+		}
+		num_names++;
+	}
+	closedir(dir);
+
+	qsort(names, num_names, sizeof(char*), compare_names);
+
+	for(i = 0; i < num_names && result == 0; i++)
+	{
+		relative_path = (char*)malloc(strlen(relative_directory) + strlen(names[i]) + 2);
+		entry_path = (char*)malloc(strlen(root) + strlen(relative_directory) + strlen(names[i]) + 3);
+		if(relative_path == NULL || entry_path == NULL)
+		{
+			free(relative_path);
+			free(entry_path);
+			result = 1;
+			break;
+		}
+
+		sprintf(relative_path, "%s%s%s", relative_directory, *relative_directory ? "/" : "", names[i]);
+		sprintf(entry_path, "%s/%s", root, relative_path);
+
+		if(stat(entry_path, &st) == 0)
+		{
+			if(S_ISDIR(st.st_mode))
+			{
+				result = collect_directory(list, root, relative_path);
+			}
+			else if(S_ISREG(st.st_mode))
+			{
+				result = add_job(list, entry_path, relative_path, NULL);
+			}
+		}
+
+		free(relative_path);
+		free(entry_path);
+	}
+
+	for(i = 0; i < num_names; i++)
+	{
+		free(names[i]);
+	}
+	free(names);
+
+	return result;
+}
+
+static int collect_manifest(batch_job_list *list, const char *manifest_path)
+{
+	FILE *fp = fopen(manifest_path, "r");
+	char line[4096];
+	char *output_rom_path;
+	size_t length;
+	int result = 0;
+
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	while(result == 0 && fgets(line, sizeof(line), fp) != NULL)
+	{
+		length = strlen(line);
+		while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+		{
+			line[--length] = 0;
+		}
+
+		if(length == 0 || line[0] == '#')
+		{
+			continue;
+		}
+
+		output_rom_path = strchr(line, '\t');
+		if(output_rom_path)
+		{
+			*output_rom_path++ = 0;
+		}
+
+		result = add_job(list, line, line, output_rom_path);
+	}
+
+	fclose(fp);
+	return result;
+}
+
+static void run_batch_job(void *argument, size_t worker_index)
+{
+	batch_task *task = (batch_task*)argument;
+	batch_job *job = task->job;
+
+	(void)worker_index;
+
+	if(task->options.all_variants)
+	{
+		job->status = patch_rom_variants_job(job->input_rom_path, job->output_rom_path, job->relative_path, &task->options, 1, NULL, task->dedup, job);
+		return;
+	}
+
+	if(make_parent_directories(job->output_rom_path) != 0)
+	{
+		job->status = ROM_JOB_OUTPUT_PATH_FAILED;
+		return;
+	}
+
+	job->status = patch_rom_job(job->input_rom_path, job->output_rom_path, &task->options, NULL, task->dedup, job);
+}
+
+static batch_task *next_ring_task(ring_batch *batch)
+{
+	batch_task *task = NULL;
+
+	pthread_mutex_lock(&batch->lock);
+	if(batch->next_task < batch->num_tasks)
+	{
+		task = &batch->tasks[batch->next_task++];
+	}
+	pthread_mutex_unlock(&batch->lock);
+
+	return task;
+}
+
+/* Records the job's status and frees the slot, closing any file it still has open without waiting */
+static void finish_ring_slot(io_ring *ring, ring_slot *slot, int status)
+{
+	if(slot->fd >= 0 && io_ring_close(ring, slot->fd, RING_IGNORE) != 0)
+	{
+		close(slot->fd);
+	}
+
+	slot->task->job->status = status;
+	DestroyROM(&slot->rom);
+	slot->task = NULL;
+	slot->fd = -1;
+}
+
+/* Frees a slot without recording a status, closing its file directly, and returns the task it held */
+static batch_task *reset_ring_slot(ring_slot *slot)
+{
+	batch_task *task = slot->task;
+
+	if(slot->fd >= 0)
+	{
+		close(slot->fd);
+	}
+
+	DestroyROM(&slot->rom);
+	slot->task = NULL;
+	slot->fd = -1;
+
+	return task;
+}
+
+static void start_ring_slot(io_ring *ring, ring_slot *slot, batch_task *task, uint64_t slot_index)
+{
+	slot->task = task;
+	slot->state = RING_OPEN_INPUT;
+	slot->fd = -1;
+	slot->size = 0;
+	slot->written = 0;
+	slot->made_directories = 0;
+
+	if(slot->data == NULL)
+	{
+		slot->data = (uint8_t*)malloc(RING_BUFFER_SIZE);
+		slot->capacity = slot->data ? RING_BUFFER_SIZE : 0;
+	}
+
+	if(slot->data == NULL || io_ring_openat(ring, task->job->input_rom_path, O_RDONLY | O_CLOEXEC, 0, slot_index) != 0)
+	{
+		finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+	}
+}
+
+/*
+** As with ReadROM, rejects a regular file whose size cannot match a known
+** ROM before any of it is read, unless checksum failures are ignored,
+** and grows the buffer so the whole file and the end of file read fit.
+*/
+static int size_ring_slot(ring_slot *slot, const rom_patch_options *options)
+{
+	struct stat st;
+	uint8_t *grown;
+	size_t size;
+
+	if(fstat(slot->fd, &st) != 0)
+	{
+		return -1;
+	}
+
+	if(!S_ISREG(st.st_mode))
+	{
+		return 0;
+	}
+
+	size = (size_t)st.st_size;
+	if(!options->ignore_checksum && !IsKnownROMSize(size, options->hash_database))
+	{
+		return -1;
+	}
+
+	if(size >= slot->capacity)
+	{
+		grown = (uint8_t*)realloc(slot->data, size + 1);
+		if(grown == NULL)
+		{
+			return -1;
+		}
+		slot->data = grown;
+		slot->capacity = size + 1;
+	}
+
+	return 0;
+}
+
+static int queue_ring_read(io_ring *ring, ring_slot *slot, uint64_t slot_index)
+{
+	uint8_t *grown;
+
+	if(slot->size == slot->capacity)
+	{
+		grown = (uint8_t*)realloc(slot->data, slot->capacity * 2);
+		if(grown == NULL)
+		{
+			return -1;
+		}
+		slot->data = grown;
+		slot->capacity *= 2;
+	}
+
+	return io_ring_read(ring, slot->fd, slot->data + slot->size, slot->capacity - slot->size, slot->size, slot_index);
+}
+
+static int queue_ring_write(io_ring *ring, ring_slot *slot, uint64_t slot_index)
+{
+	return io_ring_write(ring, slot->fd, slot->rom.rom_data + slot->written, slot->rom.rom_size - slot->written, slot->written, slot_index);
+}
+
+/* Hashes, identifies and patches a ROM that has been read in full, then opens its output */
+static void patch_ring_slot(io_ring *ring, ring_slot *slot, uint64_t slot_index)
+{
+	const rom_patch_options *options = &slot->task->options;
+	SC55ReadOptions read_options;
+
+	init_read_options(&read_options, options);
+	if(options->stats)
+	{
+		options->stats->bytes_read += slot->size;
+	}
+
+	/* The slot keeps the buffer, so the ROM only borrows it */
+	slot->rom = ParseROMBorrowed(slot->data, slot->size, &read_options);
+	if(slot->rom.rom_data == NULL)
+	{
+		finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+		return;
+	}
+
+	if(patch_rom_data(&slot->rom, options) != 0)
+	{
+		finish_ring_slot(ring, slot, ROM_JOB_PATCH_FAILED);
+		return;
+	}
+
+	ComputeSHA256(GetSHA256Backend(), slot->rom.rom_data, slot->rom.rom_size, slot->task->job->output_sha256);
+
+	slot->state = RING_OPEN_OUTPUT;
+	if(unshare_output(slot->task->job->output_rom_path) != 0)
+	{
+		finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+	}
+	else if(io_ring_openat(ring, slot->task->job->output_rom_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666, slot_index) != 0)
+	{
+		finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+	}
+}
+
+/* Moves a slot on by one step when one of its operations completes */
+static void advance_ring_slot(io_ring *ring, ring_slot *slot, uint64_t slot_index, int32_t result)
+{
+	const rom_patch_options *options = &slot->task->options;
+	batch_job *job = slot->task->job;
+
+	switch(slot->state)
+	{
+		case RING_OPEN_INPUT:
+			if(result < 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+				return;
+			}
+			slot->fd = result;
+			if(size_ring_slot(slot, options) != 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+				return;
+			}
+			slot->state = RING_READ;
+			if(queue_ring_read(ring, slot, slot_index) != 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+			}
+			return;
+
+		case RING_READ:
+			if(result < 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+				return;
+			}
+			if(result > 0)
+			{
+				slot->size += (size_t)result;
+				if(queue_ring_read(ring, slot, slot_index) != 0)
+				{
+					finish_ring_slot(ring, slot, ROM_JOB_READ_FAILED);
+				}
+				return;
+			}
+			/* End of file: the input is closed in the background while the ROM is patched */
+			if(io_ring_close(ring, slot->fd, RING_IGNORE) != 0)
+			{
+				close(slot->fd);
+			}
+			slot->fd = -1;
+			patch_ring_slot(ring, slot, slot_index);
+			return;
+
+		case RING_OPEN_OUTPUT:
+			if(result == -ENOENT && !slot->made_directories)
+			{
+				slot->made_directories = 1;
+				if(make_parent_directories(job->output_rom_path) != 0)
+				{
+					finish_ring_slot(ring, slot, ROM_JOB_OUTPUT_PATH_FAILED);
+				}
+				else if(io_ring_openat(ring, job->output_rom_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666, slot_index) != 0)
+				{
+					finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+				}
+				return;
+			}
+			if(result < 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+				return;
+			}
+			slot->fd = result;
+			slot->state = RING_WRITE;
+			if(queue_ring_write(ring, slot, slot_index) != 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+			}
+			return;
+
+		case RING_WRITE:
+			if(result <= 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+				return;
+			}
+			slot->written += (size_t)result;
+			if(slot->written < slot->rom.rom_size)
+			{
+				if(queue_ring_write(ring, slot, slot_index) != 0)
+				{
+					finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+				}
+				return;
+			}
+			if(options->stats)
+			{
+				options->stats->bytes_written += slot->written;
+			}
+			slot->state = RING_CLOSE_OUTPUT;
+			if(io_ring_close(ring, slot->fd, slot_index) != 0)
+			{
+				finish_ring_slot(ring, slot, close(slot->fd) == 0 ? ROM_JOB_OK : ROM_JOB_WRITE_FAILED);
+				return;
+			}
+			slot->fd = -1;
+			return;
+
+		default:
+			if(result < 0)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_WRITE_FAILED);
+			}
+			else if(CheckPatchedDigest(slot->rom.rom_sha256, options->sc55_compat_mode, options->sc55_drum_compat_mode, options->update_version, job->output_sha256) == SC55_PATCHED_DIGEST_MISMATCH)
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_VERIFY_FAILED);
+			}
+			else
+			{
+				finish_ring_slot(ring, slot, ROM_JOB_OK);
+			}
+			return;
+	}
+}
+
+/*
+** Runs batch tasks through an io_uring with up to RING_DEPTH files in
+** flight.  Everything queued while handling one round of completions is
+** submitted together, and a file is hashed and patched on this thread
+** as soon as its last read completes.  If the ring cannot be set up, or
+** fails part way, the files it held and the remaining tasks are run
+** with blocking stdio.
+*/
+static void run_ring_worker(void *argument, size_t worker_index)
+{
+	ring_batch *batch = (ring_batch*)argument;
+	ring_slot slots[RING_DEPTH];
+	io_ring *ring = io_ring_create(RING_DEPTH * 2);
+	batch_task *task;
+	uint64_t user_data;
+	int32_t result;
+	int exhausted = 0;
+	size_t active;
+	size_t i;
+
+	memset(slots, 0, sizeof(slots));
+	for(i = 0; i < RING_DEPTH; i++)
+	{
+		slots[i].fd = -1;
+	}
+
+	while(ring)
+	{
+		for(i = 0; i < RING_DEPTH && !exhausted; i++)
+		{
+			if(slots[i].task == NULL)
+			{
+				task = next_ring_task(batch);
+				if(task == NULL)
+				{
+					exhausted = 1;
+				}
+				else
+				{
+					start_ring_slot(ring, &slots[i], task, i);
+				}
+			}
+		}
+
+		active = 0;
+		for(i = 0; i < RING_DEPTH; i++)
+		{
+			active += slots[i].task ? 1 : 0;
+		}
+
+		if(active == 0)
+		{
+			if(exhausted)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if(io_ring_submit(ring, 1) != 0)
+		{
+			/* Files already in the ring start over with stdio, ahead of the tasks nobody has taken */
+			io_ring_destroy(ring);
+			ring = NULL;
+			for(i = 0; i < RING_DEPTH; i++)
+			{
+				if(slots[i].task)
+				{
+					task = reset_ring_slot(&slots[i]);
+					run_batch_job(task, worker_index);
+				}
+			}
+			break;
+		}
+
+		while(io_ring_complete(ring, &user_data, &result))
+		{
+			if(user_data < RING_DEPTH && slots[user_data].task)
+			{
+				advance_ring_slot(ring, &slots[user_data], user_data, result);
+			}
+		}
+	}
+
+	if(ring)
+	{
+		/* Let the background closes finish before the ring goes away */
+		io_ring_drain(ring);
+		io_ring_destroy(ring);
+	}
+
+	for(i = 0; i < RING_DEPTH; i++)
+	{
+		free(slots[i].data);
+	}
+
+	while((task = next_ring_task(batch)) != NULL)
+	{
+		run_batch_job(task, worker_index);
+	}
+}
+
+int run_batch(const char *batch_source, const char *output_template, const rom_patch_options *options, size_t num_threads)
+{
+	batch_job_list list;
+	batch_task *tasks = NULL;
+	work_pool *pool = NULL;
+	batch_dedup dedup;
+	ring_batch ring;
+	/* Dedup waits on other jobs, which could be queued behind it in the same ring */
+	int use_ring = options->use_io_uring && !options->all_variants && !options->dedup_outputs;
+	struct stat st;
+	size_t i;
+	size_t failures = 0;
+	size_t linked = 0;
+	int result = 0;
+
+	memset(&list, 0, sizeof(list));
+	memset(&dedup, 0, sizeof(dedup));
+
+	if(stat(batch_source, &st) != 0)
+	{
+		fprintf(stderr, "Unable to open batch source %s\n", batch_source);
+		return 1;
+	}
+
+	if(S_ISDIR(st.st_mode))
+	{
+		result = collect_directory(&list, batch_source, "");
+	}
+	else
+	{
+		result = collect_manifest(&list, batch_source);
+	}
+
+	if(result != 0)
+	{
+		fprintf(stderr, "Unable to list ROMs from %s\n", batch_source);
+	}
+
+	for(i = 0; i < list.num_jobs && result == 0; i++)
+	{
+		if(options->all_variants)
+		{
+			/* Outputs stay templates and are expanded once per variant when the job runs */
+			if(list.jobs[i].output_rom_path == NULL)
+			{
+				list.jobs[i].output_rom_path = output_template ? strdup(output_template) : NULL;
+			}
+
+			if(list.jobs[i].output_rom_path == NULL || !output_template_has_token(list.jobs[i].output_rom_path, 's') || !output_template_has_token(list.jobs[i].output_rom_path, 'd'))
+			{
+				fprintf(stderr, "Output templates must contain %%s and %%d when writing all variants\n");
+				result = 1;
+			}
+			continue;
+		}
+
+		if(list.jobs[i].output_rom_path)
+		{
+			continue;
+		}
+
+		if(output_template == NULL || strchr(output_template, '%') == NULL)
+		{
+			fprintf(stderr, "An output template containing %% tokens is required for batch mode\n");
+			result = 1;
+			break;
+		}
+
+		list.jobs[i].output_rom_path = expand_output_template(output_template, list.jobs[i].relative_path, options->sc55_compat_mode, options->sc55_drum_compat_mode);
+		if(list.jobs[i].output_rom_path == NULL)
+		{
+			fprintf(stderr, "Invalid output template %s\n", output_template);
+			result = 1;
+		}
+	}
+
+	if(result == 0 && list.num_jobs > 0)
+	{
+		tasks = (batch_task*)malloc(list.num_jobs * sizeof(batch_task));
+		pool = work_pool_create(num_threads);
+		if(tasks == NULL || pool == NULL)
+		{
+			fprintf(stderr, "Unable to start batch workers\n");
+			result = 1;
+		}
+	}
+
+	if(result == 0 && list.num_jobs > 0 && options->dedup_outputs)
+	{
+		/* At most half full, so probes stay short */
+		for(dedup.mask = 1; dedup.mask < list.num_jobs * 2; dedup.mask <<= 1);
+		dedup.entries = (digest_entry*)calloc(dedup.mask, sizeof(digest_entry));
+		dedup.mask--;
+		if(dedup.entries == NULL)
+		{
+			fprintf(stderr, "Unable to start batch workers\n");
+			result = 1;
+		}
+		else
+		{
+			pthread_mutex_init(&dedup.lock, NULL);
+			pthread_cond_init(&dedup.finished, NULL);
+		}
+	}
+
+	if(result == 0)
+	{
+		for(i = 0; i < list.num_jobs; i++)
+		{
+			tasks[i].job = &list.jobs[i];
+			tasks[i].options = *options;
+			tasks[i].dedup = dedup.entries ? &dedup : NULL;
+			if(options->stats)
+			{
+				InitROMStats(&list.jobs[i].stats);
+				tasks[i].options.stats = &list.jobs[i].stats;
+			}
+			if(!use_ring && work_pool_submit(pool, run_batch_job, &tasks[i]) != 0)
+			{
+				list.jobs[i].status = ROM_JOB_PATCH_FAILED;
+			}
+		}
+
+		/* Each worker runs one ring and takes tasks from the shared list as its slots free up */
+		if(use_ring)
+		{
+			ring.tasks = tasks;
+			ring.num_tasks = list.num_jobs;
+			ring.next_task = 0;
+			pthread_mutex_init(&ring.lock, NULL);
+			for(i = 0; i < work_pool_size(pool); i++)
+			{
+				work_pool_submit_to(pool, i, run_ring_worker, &ring);
+			}
+		}
+
+		work_pool_wait(pool);
+		if(use_ring)
+		{
+			pthread_mutex_destroy(&ring.lock);
+		}
+
+		for(i = 0; i < list.num_jobs && options->stats; i++)
+		{
+			add_rom_stats(options->stats, &list.jobs[i].stats);
+		}
+
+		for(i = 0; i < list.num_jobs; i++)
+		{
+			if(list.jobs[i].status == ROM_JOB_OK)
+			{
+				printf("ok\t%s\t%s", list.jobs[i].input_rom_path, list.jobs[i].output_rom_path);
+				if(!options->all_variants)
+				{
+					printf("\t");
+					print_digest(stdout, list.jobs[i].output_sha256);
+				}
+				printf("\n");
+				linked += list.jobs[i].linked ? 1 : 0;
+			}
+			else
+			{
+				printf("error\t%s\t%s\n", list.jobs[i].input_rom_path, rom_job_status_string(list.jobs[i].status));
+				failures++;
+			}
+		}
+
+		if(dedup.entries)
+		{
+			printf("%lu of %lu ROMs patched, %lu linked to identical outputs\n", (unsigned long)(list.num_jobs - failures), (unsigned long)list.num_jobs, (unsigned long)linked);
+		}
+		else
+		{
+			printf("%lu of %lu ROMs patched\n", (unsigned long)(list.num_jobs - failures), (unsigned long)list.num_jobs);
+		}
+		if(failures > 0)
+		{
+			result = 1;
+		}
+	}
+
+	work_pool_destroy(pool);
+	if(dedup.entries)
+	{
+		pthread_mutex_destroy(&dedup.lock);
+		pthread_cond_destroy(&dedup.finished);
+		free(dedup.entries);
+	}
+	free(tasks);
+	for(i = 0; i < list.num_jobs; i++)
+	{
+		free(list.jobs[i].input_rom_path);
+		free(list.jobs[i].relative_path);
+		free(list.jobs[i].output_rom_path);
+	}
+	free(list.jobs);
+
+	return result;
+}
+#else
+static int link_duplicate(batch_dedup *dedup, batch_job *job, const SC55ROMData *rom_data, const rom_patch_options *options)
+{
+	(void)dedup;
+	(void)job;
+	(void)rom_data;
+	(void)options;
+	return 1;
+}
+
+static void finish_digest(batch_dedup *dedup, batch_job *job, int status)
+{
+	(void)dedup;
+	(void)job;
+	(void)status;
+}
+
+int run_batch(const char *batch_source, const char *output_template, const rom_patch_options *options, size_t num_threads)
+{
+	(void)batch_source;
+	(void)output_template;
+	(void)options;
+	(void)num_threads;
+	fprintf(stderr, "Batch mode is not supported on this platform.\n");
+	return 1;
+}
+#endif
@@ -0,0 +1,154 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_BATCH_H
+#define CTF_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "CTFPatch.h"
+
+/*
+** Batch mode, library scans and the patch server need threads,
+** directory walking and Unix sockets, so on other platforms (Windows)
+** they are stubs that report an error and only single ROMs are patched.
+*/
+#if defined(__unix__) || defined(__APPLE__)
+#define CTF_HAVE_POSIX
+#endif
+
+#define ROM_JOB_OK 0
+#define ROM_JOB_READ_FAILED 1
+#define ROM_JOB_PATCH_FAILED 2
+#define ROM_JOB_WRITE_FAILED 3
+#define ROM_JOB_OUTPUT_PATH_FAILED 4
+#define ROM_JOB_SERVER_UNAVAILABLE 5
+#define ROM_JOB_SERVER_FAILED 6
+/* The output was written, but its digest differs from the expected one in SC55_PATCHED_HASHES */
+#define ROM_JOB_VERIFY_FAILED 7
+/* The input is also the output, which the patch server cannot patch in place */
+#define ROM_JOB_SERVER_SKIPPED 8
+
+/* As an input or output path, stdin or stdout */
+#define ROM_PATH_STDIO "-"
+
+typedef struct
+{
+	uint8_t sc55_compat_mode;
+	uint8_t sc55_drum_compat_mode;
+	uint8_t ignore_checksum;
+	uint8_t update_version;
+	uint8_t use_mmap;
+	uint8_t all_variants;
+	/* In batch mode, link the outputs of byte-identical inputs to one patched copy */
+	uint8_t dedup_outputs;
+	/* In batch mode, do file I/O through io_uring where the kernel allows it */
+	uint8_t use_io_uring;
+	/* Directory of cached patch results, or NULL to always compute them */
+	const char *cache_directory;
+	/* Extra known ROMs, or NULL for only the built-in ones */
+	const SC55HashDatabase *hash_database;
+	/* Receives timings and counters, summed over every ROM, or NULL */
+	SC55ROMStats *stats;
+	/* Reusable read buffers shared by every ROM, or NULL to allocate each one */
+	SC55BufferPool *buffer_pool;
+} rom_patch_options;
+
+/* Patches a ROM in memory with the options' modes, using the patch cache if one is set.  Returns 0 on success. */
+int patch_rom_data(SC55ROMData *rom_data, const rom_patch_options *options);
+
+/* Reads, patches and writes one ROM.  Progress and errors go to progress unless it is NULL. */
+int patch_rom_file(const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress);
+
+/*
+** Reads and hashes one ROM once and writes all six compatibility and
+** drum mode combinations.  Each output path is output_template expanded
+** for relative_path and that variant; the template must contain %s and
+** %d.  Parent directories are created when create_directories is set.
+** Returns the first failure, or ROM_JOB_OK.
+*/
+int patch_rom_file_variants(const char *input_rom_path, const char *output_template, const char *relative_path, const rom_patch_options *options, int create_directories, FILE *progress);
+
+const char *rom_job_status_string(int status);
+
+const char *compat_mode_name(uint8_t sc55_compat_mode);
+
+const char *drum_compat_mode_name(uint8_t sc55_drum_compat_mode);
+
+/* Adds every counter and timing in from to total */
+void add_rom_stats(SC55ROMStats *total, const SC55ROMStats *from);
+
+/* Prints stats as one JSON object on a line of its own */
+void print_rom_stats_json(const SC55ROMStats *stats, FILE *output);
+
+/*
+** Expands an output path template for one input ROM.  relative_path is
+** the input's path relative to the batch source.  Supported tokens:
+**   %p  directory part of relative_path, with a trailing '/' if not empty
+**   %f  file name of the input
+**   %n  file name without its extension
+**   %e  extension of the input, including the '.'
+**   %s  compatibility mode: strict, sc55 or mkii
+**   %d  drum compatibility mode: early or late
+**   %%  a literal '%'
+** Returns a malloc()ed string, or NULL on an unknown token.
+*/
+char *expand_output_template(const char *output_template, const char *relative_path, uint8_t sc55_compat_mode, uint8_t sc55_drum_compat_mode);
+
+/* Returns 1 if output_template uses token (a single character such as 's') */
+int output_template_has_token(const char *output_template, char token);
+
+#ifdef CTF_HAVE_POSIX
+/*
+** Removes output_rom_path if it is a file with other hardlinks, such as
+** an output linked by -D, so that writing it does not change the others.
+** Returns 0 once the path can be written.
+*/
+int unshare_output(const char *output_rom_path);
+#endif
+
+/*
+** Patches every ROM listed by batch_source, which is either a directory
+** (walked recursively) or a manifest file with one input path per line,
+** optionally followed by a tab and an explicit output path.  Blank lines
+** and lines starting with '#' are skipped.  Jobs run on num_threads
+** workers (0 for one per core) and a status line is printed per file.
+** With options->all_variants, each ROM is written once per variant and
+** explicit manifest outputs are templates as well.  With
+** options->dedup_outputs, only the first ROM with a given SHA-256 is
+** patched and written; the outputs of its duplicates are reflinked to
+** it where the filesystem allows, or else hardlinked.  With
+** options->use_io_uring (and neither of those), each worker drives an
+** io_uring that keeps several files in flight and writes whole images;
+** workers whose ring cannot be set up use blocking stdio instead.
+** Returns 0 if every ROM was patched.
+*/
+int run_batch(const char *batch_source, const char *output_template, const rom_patch_options *options, size_t num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTF_BATCH_H */
@@ -0,0 +1,717 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+** Benchmarks each phase of reading, identifying, patching and writing a
+** ROM and prints the results as JSON.  The library is compiled into
+** this program with its allocation functions routed through the
+** counters below (see the bench target in the Makefile).
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CTFPatch.h"
+
+typedef struct
+{
+	const char *label;
+	char *owned_label;
+	uint8_t *data;
+	size_t size;
+} bench_rom;
+
+typedef struct
+{
+	size_t iterations;
+	const char *temp_directory;
+	FILE *output;
+	int first_result;
+} bench_context;
+
+static size_t allocation_count;
+static size_t allocation_bytes;
+
+void *bench_malloc(size_t size)
+{
+	allocation_count++;
+	allocation_bytes += size;
+	return malloc(size);
+}
+
+void *bench_calloc(size_t count, size_t size)
+{
+	allocation_count++;
+	allocation_bytes += count * size;
+	return calloc(count, size);
+}
+
+void *bench_realloc(void *pointer, size_t size)
+{
+	allocation_count++;
+	allocation_bytes += size;
+	return realloc(pointer, size);
+}
+
+void bench_free(void *pointer)
+{
+	free(pointer);
+}
+
+static void print_help(void)
+{
+	printf("Usage: CTFPatchBench [options]\n");
+	printf("Options:\n");
+	printf("  -s SIZE     Size of the synthetic ROM in bytes\n");
+	printf("              Defaults to 524288\n");
+	printf("  -d DENSITY  Fraction of tone and drum cells left empty\n");
+	printf("              in the synthetic ROM, from 0 to 1\n");
+	printf("              Defaults to 0.25\n");
+	printf("  -e SEED     Seed for the synthetic ROM\n");
+	printf("  -n N        Iterations per phase, defaults to 200\n");
+	printf("  -r PATH     Also benchmark a real dump, or every file\n");
+	printf("              in a directory; may be repeated\n");
+	printf("  -S          Skip the synthetic ROM\n");
+	printf("  -t DIR      Directory for temporary files, defaults\n");
+	printf("              to $TMPDIR or /tmp\n");
+	printf("  -o FILE     Write the JSON report to FILE\n");
+	printf("  -h          Display this information\n");
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift64*, so synthetic images are the same on every platform */
+static uint64_t next_random(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * UINT64_C(2685821657736338717);
+}
+
+static uint8_t *make_synthetic_rom(size_t size, double density, uint64_t seed)
+{
+	uint8_t *data = (uint8_t*)malloc(size);
+	uint64_t state = seed ? seed : 1;
+	uint64_t threshold = (uint64_t)(density * 4294967296.0);
+	size_t i;
+
+	if(data == NULL)
+	{
+		return NULL;
+	}
+
+	for(i = 0; i < size; i++)
+	{
+		data[i] = (uint8_t)(next_random(&state) >> 56);
+	}
+
+	/* Empty tone cells are 0xffff and empty drum slots 0xff */
+	for(i = 0; i < 0x4000; i++)
+	{
+		if((next_random(&state) >> 32) < threshold)
+		{
+			data[0x30000 + (i * 2)] = 0xff;
+			data[0x30000 + (i * 2) + 1] = 0xff;
+		}
+	}
+
+	for(i = 0; i < 0x80; i++)
+	{
+		if((next_random(&state) >> 32) < threshold)
+		{
+			data[0x38000 + i] = 0xff;
+		}
+	}
+
+	return data;
+}
+
+static uint8_t *load_file(const char *path, size_t *size)
+{
+	FILE *fp = fopen(path, "rb");
+	uint8_t *data = NULL;
+	long file_size;
+
+	if(fp == NULL)
+	{
+		return NULL;
+	}
+
+	if(fseek(fp, 0L, SEEK_END) == 0 && (file_size = ftell(fp)) > 0 && fseek(fp, 0L, SEEK_SET) == 0)
+	{
+		data = (uint8_t*)malloc((size_t)file_size);
+		if(data && fread(data, 1, (size_t)file_size, fp) != (size_t)file_size)
+		{
+			free(data);
+			data = NULL;
+		}
+		*size = (size_t)file_size;
+	}
+
+	fclose(fp);
+	return data;
+}
+
+static int add_rom(bench_rom **roms, size_t *num_roms, const char *label, char *owned_label, uint8_t *data, size_t size)
+{
+	bench_rom *grown = (bench_rom*)realloc(*roms, (*num_roms + 1) * sizeof(bench_rom));
+
+	if(grown == NULL)
+	{
+		return 1;
+	}
+
+	*roms = grown;
+	(*roms)[*num_roms].label = label;
+	(*roms)[*num_roms].owned_label = owned_label;
+	(*roms)[*num_roms].data = data;
+	(*roms)[*num_roms].size = size;
+	(*num_roms)++;
+	return 0;
+}
+
+static int add_real_roms(bench_rom **roms, size_t *num_roms, const char *path)
+{
+	struct stat st;
+	struct dirent *entry;
+	DIR *dir;
+	char *entry_path;
+	uint8_t *data;
+	size_t size;
+
+	if(stat(path, &st) != 0)
+	{
+		return 1;
+	}
+
+	if(!S_ISDIR(st.st_mode))
+	{
+		data = load_file(path, &size);
+		return data == NULL || add_rom(roms, num_roms, path, NULL, data, size) != 0;
+	}
+
+	dir = opendir(path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		entry_path = (char*)malloc(strlen(path) + strlen(entry->d_name) + 2);
+		if(entry_path == NULL)
+		{
+			break;
+		}
+		sprintf(entry_path, "%s/%s", path, entry->d_name);
+
+		if(stat(entry_path, &st) == 0 && S_ISREG(st.st_mode) && (data = load_file(entry_path, &size)) != NULL)
+		{
+			if(add_rom(roms, num_roms, entry_path, entry_path, data, size) == 0)
+			{
+				continue;
+			}
+			free(data);
+		}
+
+		free(entry_path);
+	}
+
+	closedir(dir);
+	return 0;
+}
+
+static void print_json_string(FILE *fp, const char *text)
+{
+	fputc('"', fp);
+	for(; *text; text++)
+	{
+		if(*text == '"' || *text == '\\')
+		{
+			fprintf(fp, "\\%c", *text);
+		}
+		else if((unsigned char)*text < 0x20)
+		{
+			fprintf(fp, "\\u%04x", (unsigned char)*text);
+		}
+		else
+		{
+			fputc(*text, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+static void report(bench_context *context, const bench_rom *rom, const char *phase, uint64_t elapsed_ns, size_t bytes_per_op, size_t allocations, size_t allocated_bytes)
+{
+	double ns_per_op = (double)elapsed_ns / (double)context->iterations;
+
+	fprintf(context->output, "%s\n    {\"rom\": ", context->first_result ? "" : ",");
+	print_json_string(context->output, rom->label);
+	fprintf(context->output, ", \"phase\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.1f, \"mb_per_s\": %.2f, \"allocations_per_op\": %.2f, \"allocated_bytes_per_op\": %.1f}",
+		phase,
+		(unsigned long)context->iterations,
+		ns_per_op,
+		ns_per_op > 0 ? ((double)bytes_per_op * 1000.0) / ns_per_op : 0.0,
+		(double)allocations / (double)context->iterations,
+		(double)allocated_bytes / (double)context->iterations);
+	context->first_result = 0;
+}
+
+static void start_counting(size_t *allocations, size_t *allocated_bytes)
+{
+	*allocations = allocation_count;
+	*allocated_bytes = allocation_bytes;
+}
+
+static void stop_counting(size_t *allocations, size_t *allocated_bytes)
+{
+	*allocations = allocation_count - *allocations;
+	*allocated_bytes = allocation_bytes - *allocated_bytes;
+}
+
+static void bench_hashing(bench_context *context, const bench_rom *rom)
+{
+	char phase[64];
+	uint8_t sha256[32];
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+	int backend;
+
+	for(backend = 0; backend < SC55_SHA256_BACKEND_COUNT; backend++)
+	{
+		if(!SHA256BackendAvailable(backend))
+		{
+			continue;
+		}
+
+		start_counting(&allocations, &allocated_bytes);
+		start = now_ns();
+		for(i = 0; i < context->iterations; i++)
+		{
+			ComputeSHA256(backend, rom->data, rom->size, sha256);
+		}
+		stop_counting(&allocations, &allocated_bytes);
+
+		sprintf(phase, "sha256/%s", GetSHA256BackendName(backend));
+		report(context, rom, phase, now_ns() - start, rom->size, allocations, allocated_bytes);
+	}
+}
+
+/* Hashes a full group of copies of the ROM in lockstep, so throughput covers every lane */
+static void bench_hashing_multi(bench_context *context, const bench_rom *rom)
+{
+	static const int lane_counts[2] = {8, 16};
+	const uint8_t *buffers[16];
+	uint8_t sha256[16][32];
+	char phase[64];
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+	int lanes;
+
+	for(i = 0; i < 16; i++)
+	{
+		buffers[i] = rom->data;
+	}
+
+	for(lanes = 0; lanes < 2; lanes++)
+	{
+		if(!SHA256LanesAvailable(lane_counts[lanes]))
+		{
+			continue;
+		}
+
+		start_counting(&allocations, &allocated_bytes);
+		start = now_ns();
+		for(i = 0; i < context->iterations; i++)
+		{
+			ComputeSHA256Multi(lane_counts[lanes], buffers, (size_t)lane_counts[lanes], rom->size, sha256);
+		}
+		stop_counting(&allocations, &allocated_bytes);
+
+		sprintf(phase, "sha256/x%d", lane_counts[lanes]);
+		report(context, rom, phase, now_ns() - start, rom->size * (size_t)lane_counts[lanes], allocations, allocated_bytes);
+	}
+}
+
+static void bench_identify(bench_context *context, const bench_rom *rom)
+{
+	SC55ROMIdentity identity;
+	uint8_t sha256[32];
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+
+	ComputeSHA256(-1, rom->data, rom->size, sha256);
+
+	start_counting(&allocations, &allocated_bytes);
+	start = now_ns();
+	for(i = 0; i < context->iterations; i++)
+	{
+		LookupROM(NULL, sha256, rom->size, &identity);
+	}
+	stop_counting(&allocations, &allocated_bytes);
+	report(context, rom, "identify", now_ns() - start, 0, allocations, allocated_bytes);
+}
+
+static void bench_parse(bench_context *context, const bench_rom *rom, const SC55ReadOptions *options, const char *phase)
+{
+	SC55ROMData rom_data;
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+
+	start_counting(&allocations, &allocated_bytes);
+	start = now_ns();
+	for(i = 0; i < context->iterations; i++)
+	{
+		rom_data = ParseROMBorrowed(rom->data, rom->size, options);
+		DestroyROM(&rom_data);
+	}
+	stop_counting(&allocations, &allocated_bytes);
+	report(context, rom, phase, now_ns() - start, rom->size, allocations, allocated_bytes);
+}
+
+/* Times PatchROM alone; the tables are restored from the original between iterations, outside the timed region */
+static void bench_patch(bench_context *context, const bench_rom *rom, const SC55ReadOptions *options, uint8_t compat_mode, const char *phase)
+{
+	SC55ROMData rom_data;
+	uint8_t *image = (uint8_t*)malloc(rom->size);
+	uint64_t elapsed = 0;
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+
+	if(image == NULL)
+	{
+		return;
+	}
+
+	memcpy(image, rom->data, rom->size);
+	rom_data = ParseROMBorrowed(image, rom->size, options);
+	if(rom_data.rom_data == NULL)
+	{
+		free(image);
+		return;
+	}
+
+	start_counting(&allocations, &allocated_bytes);
+	for(i = 0; i < context->iterations; i++)
+	{
+		memcpy(image + 0x30000, rom->data + 0x30000, 0x8080);
+		rom_data.num_dirty_ranges = 0;
+
+		start = now_ns();
+		PatchROM(&rom_data, compat_mode, SC55_DRUM_EARLY_COMPAT, 1);
+		elapsed += now_ns() - start;
+	}
+	stop_counting(&allocations, &allocated_bytes);
+	report(context, rom, phase, elapsed, 0x8080, allocations, allocated_bytes);
+
+	DestroyROM(&rom_data);
+	free(image);
+}
+
+static void bench_build_all(bench_context *context, const bench_rom *rom, const SC55ReadOptions *options)
+{
+	static const uint8_t compat_modes[3] = {SC55_STRICT_SC55_COMPAT, SC55_SC55_COMPAT, SC55_SC55MKII_COMPAT};
+	SC55ROMPatch *patches = (SC55ROMPatch*)malloc(6 * sizeof(SC55ROMPatch));
+	SC55ROMData rom_data;
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+
+	if(patches == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < 6; i++)
+	{
+		patches[i].compat_mode = compat_modes[i / 2];
+		patches[i].drum_compat_mode = (uint8_t)((i % 2) + 1);
+		patches[i].update_version = 1;
+	}
+
+	rom_data = ParseROMBorrowed(rom->data, rom->size, options);
+	if(rom_data.rom_data != NULL)
+	{
+		start_counting(&allocations, &allocated_bytes);
+		start = now_ns();
+		for(i = 0; i < context->iterations; i++)
+		{
+			BuildROMPatches(&rom_data, patches, 6);
+		}
+		stop_counting(&allocations, &allocated_bytes);
+		report(context, rom, "build_all_variants", now_ns() - start, 6 * 0x8080, allocations, allocated_bytes);
+	}
+
+	DestroyROM(&rom_data);
+	free(patches);
+}
+
+static void bench_files(bench_context *context, const bench_rom *rom, const SC55ReadOptions *options)
+{
+	char *input_path = (char*)malloc(strlen(context->temp_directory) + 32);
+	char *output_path = (char*)malloc(strlen(context->temp_directory) + 32);
+	SC55ROMData rom_data;
+	SC55ReadOptions read_options = *options;
+	uint8_t *image = (uint8_t*)malloc(rom->size);
+	uint64_t start;
+	size_t allocations, allocated_bytes;
+	size_t i;
+	int fd;
+
+	if(input_path == NULL || output_path == NULL || image == NULL)
+	{
+		free(input_path);
+		free(output_path);
+		free(image);
+		return;
+	}
+
+	sprintf(input_path, "%s/ctfbench-in-XXXXXX", context->temp_directory);
+	sprintf(output_path, "%s/ctfbench-out-XXXXXX", context->temp_directory);
+	if((fd = mkstemp(input_path)) >= 0)
+	{
+		close(fd);
+	}
+	if((fd = mkstemp(output_path)) >= 0)
+	{
+		close(fd);
+	}
+
+	memcpy(image, rom->data, rom->size);
+	rom_data = ParseROMBorrowed(image, rom->size, options);
+	if(rom_data.rom_data == NULL || WriteROM(&rom_data, input_path) != 0)
+	{
+		fprintf(stderr, "Unable to write temporary files in %s\n", context->temp_directory);
+	}
+	else
+	{
+		PatchROM(&rom_data, SC55_SC55_COMPAT, SC55_DRUM_EARLY_COMPAT, 1);
+
+		start_counting(&allocations, &allocated_bytes);
+		start = now_ns();
+		for(i = 0; i < context->iterations; i++)
+		{
+			WriteROM(&rom_data, output_path);
+		}
+		stop_counting(&allocations, &allocated_bytes);
+		report(context, rom, "write", now_ns() - start, rom->size, allocations, allocated_bytes);
+
+		start_counting(&allocations, &allocated_bytes);
+		start = now_ns();
+		for(i = 0; i < context->iterations; i++)
+		{
+			WriteROMDelta(&rom_data, input_path, output_path);
+		}
+		stop_counting(&allocations, &allocated_bytes);
+		report(context, rom, "write_delta", now_ns() - start, rom->size, allocations, allocated_bytes);
+
+		DestroyROM(&rom_data);
+
+		for(read_options.use_mmap = 0; read_options.use_mmap < 2; read_options.use_mmap++)
+		{
+			start_counting(&allocations, &allocated_bytes);
+			start = now_ns();
+			for(i = 0; i < context->iterations; i++)
+			{
+				rom_data = ReadROMWithOptions(input_path, &read_options);
+				DestroyROM(&rom_data);
+			}
+			stop_counting(&allocations, &allocated_bytes);
+			report(context, rom, read_options.use_mmap ? "read_mapped" : "read", now_ns() - start, rom->size, allocations, allocated_bytes);
+		}
+
+		/* The pool is created outside the timed loop, as a batch would */
+		read_options.use_mmap = 0;
+		read_options.buffer_pool = CreateBufferPool(rom->size, 1, 1);
+		if(read_options.buffer_pool)
+		{
+			start_counting(&allocations, &allocated_bytes);
+			start = now_ns();
+			for(i = 0; i < context->iterations; i++)
+			{
+				rom_data = ReadROMWithOptions(input_path, &read_options);
+				DestroyROM(&rom_data);
+			}
+			stop_counting(&allocations, &allocated_bytes);
+			report(context, rom, "read_pooled", now_ns() - start, rom->size, allocations, allocated_bytes);
+			DestroyBufferPool(read_options.buffer_pool);
+			read_options.buffer_pool = NULL;
+		}
+	}
+
+	remove(input_path);
+	remove(output_path);
+	free(input_path);
+	free(output_path);
+	free(image);
+}
+
+static void bench_rom_phases(bench_context *context, const bench_rom *rom)
+{
+	SC55ReadOptions options;
+	SC55ReadOptions lazy_options;
+
+	InitReadOptions(&options);
+	options.ignore_sha256_failures = 1;
+	lazy_options = options;
+	lazy_options.lazy_identify = 1;
+
+	if(rom->size < 0x38080)
+	{
+		fprintf(stderr, "Skipping %s: too small to be a ROM\n", rom->label);
+		return;
+	}
+
+	bench_hashing(context, rom);
+	bench_hashing_multi(context, rom);
+	bench_identify(context, rom);
+	bench_parse(context, rom, &options, "parse");
+	bench_parse(context, rom, &lazy_options, "parse_lazy");
+	bench_patch(context, rom, &options, SC55_STRICT_SC55_COMPAT, "patch/strict");
+	bench_patch(context, rom, &options, SC55_SC55_COMPAT, "patch/sc55");
+	bench_patch(context, rom, &options, SC55_SC55MKII_COMPAT, "patch/mkii");
+	bench_build_all(context, rom, &options);
+	bench_files(context, rom, &options);
+}
+
+int main(int argc, char **argv)
+{
+	bench_context context;
+	bench_rom *roms = NULL;
+	size_t num_roms = 0;
+	size_t synthetic_size = 524288;
+	double density = 0.25;
+	uint64_t seed = 1;
+	long iterations = 200;
+	int use_synthetic = 1;
+	const char *output_path = NULL;
+	uint8_t *synthetic;
+	size_t i;
+	int c;
+
+	context.temp_directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+	while((c = getopt(argc, argv, "s:d:e:n:r:St:o:h")) != -1)
+	{
+		switch(c)
+		{
+			case 's':
+				synthetic_size = (size_t)strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				density = strtod(optarg, NULL);
+				break;
+			case 'e':
+				seed = (uint64_t)strtoull(optarg, NULL, 0);
+				break;
+			case 'n':
+				iterations = strtol(optarg, NULL, 10);
+				break;
+			case 'r':
+				if(add_real_roms(&roms, &num_roms, optarg) != 0)
+				{
+					fprintf(stderr, "Unable to read %s\n", optarg);
+					return 1;
+				}
+				break;
+			case 'S':
+				use_synthetic = 0;
+				break;
+			case 't':
+				context.temp_directory = optarg;
+				break;
+			case 'o':
+				output_path = optarg;
+				break;
+			case 'h':
+			default:
+				print_help();
+				return c == 'h' ? 0 : 1;
+		}
+	}
+
+	if(iterations <= 0 || density < 0 || density > 1 || synthetic_size < 0x38080)
+	{
+		print_help();
+		return 1;
+	}
+
+	if(use_synthetic)
+	{
+		synthetic = make_synthetic_rom(synthetic_size, density, seed);
+		if(synthetic == NULL || add_rom(&roms, &num_roms, "synthetic", NULL, synthetic, synthetic_size) != 0)
+		{
+			fprintf(stderr, "Unable to allocate the synthetic ROM\n");
+			return 1;
+		}
+	}
+
+	context.iterations = (size_t)iterations;
+	context.first_result = 1;
+	context.output = output_path ? fopen(output_path, "w") : stdout;
+	if(context.output == NULL)
+	{
+		fprintf(stderr, "Unable to open %s\n", output_path);
+		return 1;
+	}
+
+	fprintf(context.output, "{\n  \"sha256_backend\": \"%s\",\n  \"synthetic\": {\"size\": %lu, \"hole_density\": %.3f, \"seed\": %lu},\n  \"results\": [",
+		GetSHA256BackendName(GetSHA256Backend()), (unsigned long)synthetic_size, density, (unsigned long)seed);
+
+	for(i = 0; i < num_roms; i++)
+	{
+		bench_rom_phases(&context, &roms[i]);
+	}
+
+	fprintf(context.output, "\n  ]\n}\n");
+
+	if(output_path)
+	{
+		fclose(context.output);
+	}
+
+	for(i = 0; i < num_roms; i++)
+	{
+		free(roms[i].data);
+		free(roms[i].owned_label);
+	}
+	free(roms);
+
+	return 0;
+}
@@ -17,74 +17,241 @@
 ** If not, see <https://www.gnu.org/licenses/>.
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#elif !defined(_POSIX_C_SOURCE) && !defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "CTFPatch.h"
 
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SC55_HAVE_MMAP
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#if defined(__GNUC__) && !defined(SC55_NO_SIMD)
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef __SSE2__
+#define SC55_HAVE_SSE2
+#endif
+#define SC55_HAVE_AVX2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SC55_HAVE_NEON
+#endif
+#endif
 
 #define LONESHA256_STATIC
 #include "lonesha256.h"
 
 #include "SC55Hashes.h"
+#include "SC55ToneMap.h"
 
-SC55ROMData ParseROM(uint8_t *rom_data, const size_t rom_size, const uint8_t ignore_sha256_failures)
+/*
+** Allocation functions, which can be replaced at build time with the
+** names of functions defined elsewhere (the benchmark counts
+** allocations this way)
+*/
+#ifdef SC55_MALLOC
+void *SC55_MALLOC(size_t size);
+void *SC55_CALLOC(size_t count, size_t size);
+void *SC55_REALLOC(void *pointer, size_t size);
+void SC55_FREE(void *pointer);
+#else
+#define SC55_MALLOC malloc
+#define SC55_CALLOC calloc
+#define SC55_REALLOC realloc
+#define SC55_FREE free
+#endif
+
+/* ReadROM hashes each chunk as soon as it has been read */
+#define SC55_READ_CHUNK_SIZE 0x10000
+
+/* ReadROMStream starts with room for a typical ROM and doubles from there */
+#define SC55_STREAM_INITIAL_SIZE 0x80000
+
+/* Pooled buffers start on a huge page boundary and are a whole number of huge pages */
+#define SC55_POOL_ALIGNMENT 0x200000
+
+#if defined(_WIN32)
+#define SC55_POOL_LOCK CRITICAL_SECTION
+#define SC55_POOL_LOCK_INIT(lock) (InitializeCriticalSection(lock), 0)
+#define SC55_POOL_LOCK_DESTROY(lock) DeleteCriticalSection(lock)
+#define SC55_POOL_LOCK_ACQUIRE(lock) EnterCriticalSection(lock)
+#define SC55_POOL_LOCK_RELEASE(lock) LeaveCriticalSection(lock)
+#elif defined(SC55_HAVE_MMAP)
+#define SC55_POOL_LOCK pthread_mutex_t
+#define SC55_POOL_LOCK_INIT(lock) pthread_mutex_init(lock, NULL)
+#define SC55_POOL_LOCK_DESTROY(lock) pthread_mutex_destroy(lock)
+#define SC55_POOL_LOCK_ACQUIRE(lock) pthread_mutex_lock(lock)
+#define SC55_POOL_LOCK_RELEASE(lock) pthread_mutex_unlock(lock)
+#else
+/* Without a thread library the pool can only be used from one thread */
+#define SC55_POOL_LOCK int
+#define SC55_POOL_LOCK_INIT(lock) (*(lock) = 0)
+#define SC55_POOL_LOCK_DESTROY(lock) ((void)(lock))
+#define SC55_POOL_LOCK_ACQUIRE(lock) ((void)(lock))
+#define SC55_POOL_LOCK_RELEASE(lock) ((void)(lock))
+#endif
+
+/* A monotonic clock in nanoseconds, only used for SC55ROMStats */
+static uint64_t GetTimeNs(void)
 {
-    SC55ROMData rom;
-    rom.rom_size = 0;
-    rom.rom_data = NULL;
-    rom.early_rom_data = NULL;
-    rom.tone_table = NULL;
-    rom.drum_table = NULL;
-    rom.late_rom_data = NULL;
-    memset(rom.rom_sha256, 0, 32);
-    rom.is_known_rom = 0;
-    rom.rom_name = NULL;
-    rom.rom_version_address = 0;
-
-    if(rom_data == NULL || rom_size < 0x38080)
-    {
-        return rom;
-    }
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
 
-    if(lonesha256(rom.rom_sha256, rom_data, rom_size) > 0)
-    {
-        memset(rom.rom_sha256, 0, 32);
-        return rom;
-    }
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#elif defined(SC55_HAVE_MMAP)
+    struct timespec ts;
 
-    rom.rom_size = rom_size;
-    rom.rom_data = rom_data;
-    rom.early_rom_data = rom_data;
-    rom.tone_table = rom_data + 0x30000;
-    rom.drum_table = rom_data + 0x38000;
-    rom.late_rom_data = rom_data + 0x38080;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+/* Starts a timed phase; returns 0 when the ROM does not collect stats */
+#define SC55_STATS_START(stats) ((stats) ? GetTimeNs() : 0)
+#define SC55_STATS_STOP(stats, field, start) do { if(stats) { (stats)->field += GetTimeNs() - (start); } } while(0)
+#define SC55_STATS_ADD(stats, field, value) do { if(stats) { (stats)->field += (value); } } while(0)
+
+static void StoreLE32(uint8_t *out, const uint32_t value)
+{
+    out[0] = (uint8_t)(value & 0xff);
+    out[1] = (uint8_t)((value >> 8) & 0xff);
+    out[2] = (uint8_t)((value >> 16) & 0xff);
+    out[3] = (uint8_t)((value >> 24) & 0xff);
+}
+
+static uint32_t LoadLE32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void StoreLE64(uint8_t *out, const uint64_t value)
+{
+    StoreLE32(out, (uint32_t)(value & 0xffffffff));
+    StoreLE32(out + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t LoadLE64(const uint8_t *in)
+{
+    return (uint64_t)LoadLE32(in) | ((uint64_t)LoadLE32(in + 4) << 32);
+}
+
+/*
+** Hash database files are a 16-byte header (magic, record count and
+** record size) followed by fixed-size records sorted by digest and then
+** file size.  Each record is the binary digest, the file size and the
+** version string address as little-endian 64-bit values, and a
+** NUL-terminated name.  Lookups binary search the mapped file directly.
+*/
+#define SC55_HASH_DB_MAGIC "CTFHASH1"
+#define SC55_HASH_DB_HEADER_SIZE 16
+#define SC55_HASH_DB_RECORD_SIZE 176
+#define SC55_HASH_DB_NAME_OFFSET 48
+#define SC55_HASH_DB_NAME_SIZE 128
+
+struct SC55HashDatabase
+{
+    const uint8_t *data;
+    size_t data_size;
+    uint8_t mapped;
+    size_t num_records;
+    /* Distinct file sizes in the database, sorted, so sizes can be rejected before hashing */
+    size_t *file_sizes;
+    size_t num_file_sizes;
+};
+
+/*
+** Buffers that are released go on a free list and are handed out again
+** before anything new is allocated, so a long batch settles at one
+** buffer per ROM in flight and stops allocating.
+*/
+struct SC55BufferPool
+{
+    SC55_POOL_LOCK lock;
+    size_t buffer_size;
+    size_t max_free_buffers;
+    uint8_t use_huge_pages;
+    uint8_t **free_buffers;
+    size_t num_free_buffers;
+    size_t free_capacity;
+};
+
+static const uint8_t *HashDatabaseRecord(const SC55HashDatabase *hash_database, const size_t i)
+{
+    return hash_database->data + SC55_HASH_DB_HEADER_SIZE + (i * SC55_HASH_DB_RECORD_SIZE);
+}
+
+/* Returns 1 if rom_size is the size of a built-in ROM or of one in hash_database, which may be NULL */
+uint8_t IsKnownROMSize(const size_t rom_size, const SC55HashDatabase *hash_database)
+{
+    size_t i;
+    size_t low, high, middle;
+    size_t sc55_num_hashes = sizeof(SC55_HASHES)/sizeof(SC55Hash);
 
-    const SC55Hash rom_hash = IdentifyROM(rom.rom_sha256, rom.rom_size);
-    if(rom_hash.file_size == 0 && ignore_sha256_failures == 0)
+    for(i = 0; i < sc55_num_hashes; i++)
     {
-        DestroyROM(&rom);
-        return rom;
+        if(SC55_HASHES[i].file_size == rom_size)
+        {
+            return 1;
+        }
     }
 
-    if(rom_hash.file_size != 0)
+    if(hash_database)
     {
-        rom.is_known_rom = 1;
-        rom.rom_name = (char*)rom_hash.rom_name;
-        rom.rom_version_address = rom.rom_data + rom_hash.version_address;
+        low = 0;
+        high = hash_database->num_file_sizes;
+        while(low < high)
+        {
+            middle = low + ((high - low) / 2);
+            if(hash_database->file_sizes[middle] < rom_size)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        if(low < hash_database->num_file_sizes && hash_database->file_sizes[low] == rom_size)
+        {
+            return 1;
+        }
     }
 
-    return rom;
+    return 0;
 }
 
-void DestroyROM(SC55ROMData *rom)
+static void InitROMData(SC55ROMData *rom)
 {
     rom->rom_size = 0;
-    if(rom->rom_data != NULL)
-    {
-        free(rom->rom_data);
-    }
     rom->rom_data = NULL;
     rom->early_rom_data = NULL;
     rom->tone_table = NULL;
@@ -94,249 +261,3149 @@ void DestroyROM(SC55ROMData *rom)
     rom->is_known_rom = 0;
     rom->rom_name = NULL;
     rom->rom_version_address = NULL;
+    rom->rom_model = 0;
+    rom->rom_storage = SC55_ROM_STORAGE_HEAP;
+    rom->buffer_pool = NULL;
+    memset(rom->dirty_ranges, 0, sizeof(rom->dirty_ranges));
+    rom->num_dirty_ranges = 0;
+    memset(&rom->source, 0, sizeof(rom->source));
+    rom->stats = NULL;
+    rom->identify_state = SC55_IDENTIFY_DONE;
+    rom->ignore_sha256_failures = 0;
+    rom->hash_database = NULL;
+    rom->identification = NULL;
 }
 
-SC55ROMData ReadROM(const char *rom_file_path, const uint8_t ignore_sha256_failures)
+/*
+** Records that [offset, offset + length) differs from the image the ROM
+** was loaded from.  Ranges are kept sorted and merged when they touch;
+** once the list is full, a new range is merged into its neighbour.
+*/
+static void MarkROMDirty(SC55ROMData *rom, const size_t offset, const size_t length)
 {
-    FILE *fp;
-
-    int seek_status = 0;
-    uint8_t *rom_data = NULL;
-    size_t rom_size;
+    size_t start = offset;
+    size_t end = offset + length;
+    size_t i = 0;
+    size_t j;
 
-    SC55ROMData rom;
-    rom.rom_size = 0;
-    rom.rom_data = NULL;
-    rom.early_rom_data = NULL;
-    rom.tone_table = NULL;
-    rom.drum_table = NULL;
-    rom.late_rom_data = NULL;
-    memset(rom.rom_sha256, 0, 32);
-    rom.is_known_rom = 0;
-    rom.rom_name = NULL;
-    rom.rom_version_address = NULL;
+    if(length == 0)
+    {
+        return;
+    }
 
-    if(!rom_file_path)
+    /* Hashing the image now would describe the patched data, not the ROM that was loaded */
+    if(rom->identify_state == SC55_IDENTIFY_PENDING)
     {
-        return rom;
+        rom->identify_state = SC55_IDENTIFY_SKIPPED;
     }
 
-    fp = fopen(rom_file_path, "rb");
-    if(fp == NULL)
+    while(i < rom->num_dirty_ranges && rom->dirty_ranges[i].offset + rom->dirty_ranges[i].length < start)
     {
-        return rom;
+        i++;
     }
 
-    seek_status = fseek(fp, 0L, SEEK_END);
+    if(i == rom->num_dirty_ranges || rom->dirty_ranges[i].offset > end)
+    {
+        if(rom->num_dirty_ranges < SC55_MAX_DIRTY_RANGES)
+        {
+            for(j = rom->num_dirty_ranges; j > i; j--)
+            {
+                rom->dirty_ranges[j] = rom->dirty_ranges[j - 1];
+            }
+            rom->dirty_ranges[i].offset = start;
+            rom->dirty_ranges[i].length = length;
+            rom->num_dirty_ranges++;
+            return;
+        }
+
+        if(i == rom->num_dirty_ranges)
+        {
+            i--;
+        }
+    }
 
-    if(seek_status != 0)
+    /* Merge into range i, then absorb any following ranges it now reaches */
+    if(rom->dirty_ranges[i].offset < start)
     {
-        fclose(fp);
-        return rom;
+        start = rom->dirty_ranges[i].offset;
     }
-    else
+    if(rom->dirty_ranges[i].offset + rom->dirty_ranges[i].length > end)
+    {
+        end = rom->dirty_ranges[i].offset + rom->dirty_ranges[i].length;
+    }
+
+    while(i + 1 < rom->num_dirty_ranges && rom->dirty_ranges[i + 1].offset <= end)
     {
-        rom_size = (size_t)ftell(fp);
-        fseek(fp, 0L, SEEK_SET);
+        if(rom->dirty_ranges[i + 1].offset + rom->dirty_ranges[i + 1].length > end)
+        {
+            end = rom->dirty_ranges[i + 1].offset + rom->dirty_ranges[i + 1].length;
+        }
+        for(j = i + 1; j + 1 < rom->num_dirty_ranges; j++)
+        {
+            rom->dirty_ranges[j] = rom->dirty_ranges[j + 1];
+        }
+        rom->num_dirty_ranges--;
     }
 
-    rom_data = (uint8_t*)malloc(rom_size);
+    rom->dirty_ranges[i].offset = start;
+    rom->dirty_ranges[i].length = end - start;
+}
 
-    if(rom_data == NULL)
+/*
+** Maps a buffer aligned to SC55_POOL_ALIGNMENT by over-allocating and
+** trimming the ends, so the kernel can back it with huge pages.
+** Elsewhere the aligned start is carved out of a larger heap block, with
+** the block's own address kept just in front of it for FreePoolBuffer.
+*/
+static uint8_t *AllocatePoolBuffer(const SC55BufferPool *buffer_pool)
+{
+    uint8_t *block;
+    uint8_t *buffer;
+    size_t block_size = buffer_pool->buffer_size + SC55_POOL_ALIGNMENT;
+
+#ifdef SC55_HAVE_MMAP
+    size_t lead;
+
+    block = (uint8_t*)mmap(NULL, block_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(block == (uint8_t*)MAP_FAILED)
     {
-        fclose(fp);
-        return rom;
+        return NULL;
     }
 
-    fread(rom_data, 1, rom_size, fp);
-    fclose(fp);
+    lead = (SC55_POOL_ALIGNMENT - ((uintptr_t)block % SC55_POOL_ALIGNMENT)) % SC55_POOL_ALIGNMENT;
+    buffer = block + lead;
+    if(lead > 0)
+    {
+        munmap(block, lead);
+    }
+    munmap(buffer + buffer_pool->buffer_size, SC55_POOL_ALIGNMENT - lead);
 
-    rom = ParseROM(rom_data, rom_size, ignore_sha256_failures);
-    if(rom.rom_size == 0 || rom.rom_data == NULL)
+#ifdef MADV_HUGEPAGE
+    if(buffer_pool->use_huge_pages)
     {
-        DestroyROM(&rom);
-        return rom;
+        madvise(buffer, buffer_pool->buffer_size, MADV_HUGEPAGE);
+    }
+#endif
+#else
+    block = (uint8_t*)SC55_MALLOC(block_size + sizeof(uint8_t*));
+    if(!block)
+    {
+        return NULL;
     }
 
-    return rom;
+    buffer = block + sizeof(uint8_t*);
+    buffer += (SC55_POOL_ALIGNMENT - ((uintptr_t)buffer % SC55_POOL_ALIGNMENT)) % SC55_POOL_ALIGNMENT;
+    memcpy(buffer - sizeof(uint8_t*), &block, sizeof(uint8_t*));
+#endif
+
+    return buffer;
 }
 
-int WriteROM(const SC55ROMData *rom, const char *rom_file_path)
+static void FreePoolBuffer(const SC55BufferPool *buffer_pool, uint8_t *buffer)
 {
-    FILE *fp;
-    size_t bytes_written = 0;
+#ifdef SC55_HAVE_MMAP
+    munmap(buffer, buffer_pool->buffer_size);
+#else
+    uint8_t *block;
 
-    if(!rom || !rom_file_path)
+    (void)buffer_pool;
+    memcpy(&block, buffer - sizeof(uint8_t*), sizeof(uint8_t*));
+    SC55_FREE(block);
+#endif
+}
+
+/*
+** Creates a pool of buffer_size byte buffers for ReadROMWithOptions and
+** ReadROMStream, rounded up to a whole number of 2 MiB huge pages (0
+** for one).  Up to max_free_buffers released buffers are kept for reuse,
+** or all of them if it is 0.  With use_huge_pages set, buffers are
+** advised as huge page candidates where the platform supports it.  The
+** pool can be shared between threads.  Returns NULL on failure.
+*/
+SC55BufferPool *CreateBufferPool(const size_t buffer_size, const size_t max_free_buffers, const uint8_t use_huge_pages)
+{
+    SC55BufferPool *buffer_pool;
+
+    if(buffer_size > SIZE_MAX - (2 * SC55_POOL_ALIGNMENT))
     {
-        return 1;
+        return NULL;
     }
 
-    fp = fopen(rom_file_path, "wb");
-    if(!fp)
+    buffer_pool = (SC55BufferPool*)SC55_CALLOC(1, sizeof(SC55BufferPool));
+    if(!buffer_pool)
     {
-        return 1;
+        return NULL;
     }
 
-    bytes_written = fwrite(rom->rom_data, 1, rom->rom_size, fp);
-    fclose(fp);
-
-    if(bytes_written != rom->rom_size)
+    if(SC55_POOL_LOCK_INIT(&buffer_pool->lock) != 0)
     {
-        return 1;
+        SC55_FREE(buffer_pool);
+        return NULL;
     }
 
-    return 0;
+    buffer_pool->buffer_size = buffer_size == 0 ? SC55_POOL_ALIGNMENT : ((buffer_size + SC55_POOL_ALIGNMENT - 1) / SC55_POOL_ALIGNMENT) * SC55_POOL_ALIGNMENT;
+    buffer_pool->max_free_buffers = max_free_buffers;
+    buffer_pool->use_huge_pages = use_huge_pages;
+
+    return buffer_pool;
 }
 
-SC55Hash IdentifyROM(const uint8_t rom_sha256[32], const size_t rom_size)
+/* Frees the pool and the buffers on its free list; every ROM using it must have been destroyed */
+void DestroyBufferPool(SC55BufferPool *buffer_pool)
 {
-    char rom_sha256_str[65];
-    uint8_t i;
-
-    size_t sc55_num_hashes;
+    size_t i;
 
-    for(i = 0; i < 32; i++)
+    if(!buffer_pool)
     {
-        sprintf(rom_sha256_str + (2 * i), "%02x", rom_sha256[i]);
+        return;
     }
 
-    rom_sha256_str[64] = 0;
-    sc55_num_hashes = sizeof(SC55_HASHES)/sizeof(SC55Hash);
-
-    for(i = 0; i < sc55_num_hashes; i++)
+    for(i = 0; i < buffer_pool->num_free_buffers; i++)
     {
-        if(strcmp(SC55_HASHES[i].sha256hash, rom_sha256_str) == 0 && SC55_HASHES[i].file_size == rom_size)
-        {
-            return SC55_HASHES[i];
-        }
+        FreePoolBuffer(buffer_pool, buffer_pool->free_buffers[i]);
     }
 
-    return (SC55Hash){"", 0, "", 0};
+    SC55_POOL_LOCK_DESTROY(&buffer_pool->lock);
+    SC55_FREE(buffer_pool->free_buffers);
+    SC55_FREE(buffer_pool);
 }
 
-uint8_t SubcapitalToneExists(const size_t bank, const uint8_t tone)
+/* Takes a buffer off the free list, or allocates one if the list is empty */
+static uint8_t *AcquirePoolBuffer(SC55BufferPool *buffer_pool)
 {
-    size_t i;
+    uint8_t *buffer = NULL;
 
-    for(i = 0; i < SC55_TONES[bank].num_tones; i++)
+    SC55_POOL_LOCK_ACQUIRE(&buffer_pool->lock);
+    if(buffer_pool->num_free_buffers > 0)
     {
-        if(SC55_TONES[bank].tones[i].tone_id == tone)
-        {
-            return 1;
-        }
+        buffer = buffer_pool->free_buffers[--buffer_pool->num_free_buffers];
     }
+    SC55_POOL_LOCK_RELEASE(&buffer_pool->lock);
 
-    return 0;
+    return buffer ? buffer : AllocatePoolBuffer(buffer_pool);
 }
 
-uint16_t GetSubcapitalTone(const uint16_t tone_table[128][128], const size_t prog, const size_t bank, const uint8_t compat_mode)
+/* Puts a buffer back on the free list, or frees it if the list is full */
+static void ReleasePoolBuffer(SC55BufferPool *buffer_pool, uint8_t *buffer)
 {
-    uint16_t subcapital_tone = tone_table[bank & 0x78][prog];
-    uint8_t table_subcapital_tone_exists = 0;
+    uint8_t **grown;
+    size_t capacity;
+    uint8_t kept = 0;
 
-    if(compat_mode == SC55_STRICT_SC55_COMPAT || compat_mode == SC55_SC55_COMPAT)
+    SC55_POOL_LOCK_ACQUIRE(&buffer_pool->lock);
+    if(buffer_pool->max_free_buffers == 0 || buffer_pool->num_free_buffers < buffer_pool->max_free_buffers)
     {
-        table_subcapital_tone_exists = SubcapitalToneExists(prog, bank);
+        if(buffer_pool->num_free_buffers == buffer_pool->free_capacity)
+        {
+            capacity = buffer_pool->free_capacity ? buffer_pool->free_capacity * 2 : 8;
+            grown = (uint8_t**)SC55_REALLOC(buffer_pool->free_buffers, capacity * sizeof(uint8_t*));
+            if(grown)
+            {
+                buffer_pool->free_buffers = grown;
+                buffer_pool->free_capacity = capacity;
+            }
+        }
 
-        if(!table_subcapital_tone_exists)
+        if(buffer_pool->num_free_buffers < buffer_pool->free_capacity)
         {
-            subcapital_tone = 0xffff;
+            buffer_pool->free_buffers[buffer_pool->num_free_buffers++] = buffer;
+            kept = 1;
         }
     }
+    SC55_POOL_LOCK_RELEASE(&buffer_pool->lock);
 
-    return subcapital_tone;
+    if(!kept)
+    {
+        FreePoolBuffer(buffer_pool, buffer);
+    }
 }
 
-int PatchROM(SC55ROMData *rom, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version)
+/*
+** Fills in the digest (hashing the image unless rom_sha256 is given) and
+** the identity of a parsed ROM.  Returns 0 if the ROM was recognised, 1
+** if it was not and -1 if it could not be hashed.
+*/
+static int HashAndIdentifyROM(SC55ROMData *rom, const uint8_t *rom_sha256, const SC55HashDatabase *hash_database, SC55ROMStats *stats)
 {
-    size_t bank, prog, i;
-    uint16_t tone_table[128][128];
+    SC55ROMIdentity identity;
+    uint64_t start;
+    uint8_t identified;
+
+    if(rom_sha256 != NULL)
+    {
+        memcpy(rom->rom_sha256, rom_sha256, 32);
+    }
+    else
+    {
+        start = SC55_STATS_START(stats);
+        if(lonesha256(rom->rom_sha256, rom->rom_data, rom->rom_size) > 0)
+        {
+            return -1;
+        }
+        SC55_STATS_STOP(stats, hash_ns, start);
+        SC55_STATS_ADD(stats, bytes_hashed, rom->rom_size);
+    }
 
-    uint8_t new_tone_table[0x8000];
-    size_t table_index = 0;
+    start = SC55_STATS_START(stats);
+    identified = LookupROM(hash_database, rom->rom_sha256, rom->rom_size, &identity);
+    SC55_STATS_STOP(stats, identify_ns, start);
+
+    if(!identified)
+    {
+        return 1;
+    }
 
-    size_t drum_prog_threshold;
-    uint8_t drum_patch_value = 0;
+    SC55_STATS_ADD(stats, identified, 1);
+    rom->is_known_rom = 1;
+    rom->rom_name = (char*)identity.rom_name;
+    rom->rom_version_address = rom->rom_data + identity.version_address;
 
-    uint16_t table_tone = 0xffff;
-    uint16_t current_tone = 0xffff;
-    uint16_t updated_tone = 0xffff;
+    return 0;
+}
 
-    for(bank = 0; bank < 128; bank++)
+static SC55ROMData ParseROMWithSHA256(uint8_t *rom_data, const size_t rom_size, const SC55ReadOptions *options, const uint8_t *rom_sha256, const uint8_t rom_storage)
+{
+    SC55ROMData rom;
+    SC55ROMStats *stats = options->stats;
+    const SC55ModelLayout *layout;
+    int identified;
+    InitROMData(&rom);
+    rom.rom_storage = rom_storage;
+    if(rom_storage == SC55_ROM_STORAGE_POOLED)
     {
-        for(prog = 0; prog < 128; prog++)
-        {
-            table_tone = (uint16_t)(rom->tone_table[((bank * 128) + prog) * 2]) << 8;
-            table_tone = table_tone | (uint16_t)(rom->tone_table[(((bank * 128) + prog) * 2) + 1]);
-            tone_table[bank][prog] = table_tone;
-        }
+        rom.buffer_pool = options->buffer_pool;
     }
 
-    for(i = 0; i < 0x8000; i++)
+    if(rom_data == NULL || rom_size < SC55_MIN_ROM_SIZE)
     {
-        new_tone_table[i] = rom->tone_table[i];
+        return rom;
     }
 
-    /* Banks 64 and up are for special use and excluded */
-    for(bank = 0; bank < 64; bank++)
+    /*
+    ** The hash database does not record a model, so take the first layout
+    ** that fits, in the order gen_tone_map lists them.  SC55_MIN_ROM_SIZE
+    ** is the smallest late_data_offset, so one always fits, but a ROM no
+    ** layout fits is left unparsed rather than read past the table.
+    */
+    while(rom.rom_model < SC55_NUM_MODELS && SC55_MODEL_LAYOUTS[rom.rom_model].late_data_offset > rom_size)
     {
-        for(prog = 0; prog < 128; prog++)
-        {
-            current_tone = tone_table[bank][prog];
+        rom.rom_model++;
+    }
+    if(rom.rom_model == SC55_NUM_MODELS)
+    {
+        rom.rom_model = 0;
+        return rom;
+    }
+    layout = &SC55_MODEL_LAYOUTS[rom.rom_model];
 
-            /* Tones 121 (120 from a 0-indexed language like C) and up are sound effects and excluded */
-            if(prog < 120 && (current_tone == 0xffff || (compat_mode == SC55_STRICT_SC55_COMPAT && !SubcapitalToneExists(prog, bank))))
-            {
-                updated_tone = GetSubcapitalTone(tone_table, prog, bank, compat_mode);
-                if(updated_tone == 0xffff)
-                {
-                    updated_tone = tone_table[0][prog];
-                }
-            }
-            else
-            {
-                updated_tone = current_tone;
-            }
+    rom.rom_size = rom_size;
+    rom.rom_data = rom_data;
+    rom.early_rom_data = rom_data;
+    rom.tone_table = rom_data + layout->tone_table_offset;
+    rom.drum_table = rom_data + layout->drum_table_offset;
+    rom.late_rom_data = rom_data + layout->late_data_offset;
 
-            new_tone_table[table_index] = (uint8_t)(updated_tone >> 8);
-            new_tone_table[table_index + 1] = (uint8_t)(updated_tone & 0xff);
+    if(options->ignore_sha256_failures == 0 && !IsKnownROMSize(rom_size, options->hash_database))
+    {
+        DestroyROM(&rom);
+        return rom;
+    }
 
-            table_index += 2;
-        }
+    /* A digest computed while reading costs nothing more, so only a parse that would hash is deferred */
+    if(rom_sha256 == NULL && options->lazy_identify)
+    {
+        rom.stats = stats;
+        rom.identify_state = SC55_IDENTIFY_PENDING;
+        rom.ignore_sha256_failures = options->ignore_sha256_failures;
+        rom.hash_database = options->hash_database;
+        return rom;
     }
 
-    for(i = 0; i < 0x8000; i++)
+    identified = HashAndIdentifyROM(&rom, rom_sha256, options->hash_database, stats);
+    if(identified < 0 || (identified > 0 && options->ignore_sha256_failures == 0))
     {
-        rom->tone_table[i] = new_tone_table[i];
+        DestroyROM(&rom);
+        return rom;
     }
 
-    if(drum_compat_mode == SC55_DRUM_EARLY_COMPAT)
+    rom.stats = stats;
+
+    return rom;
+}
+
+/* Identifies a pending ROM in place, leaving it SC55_IDENTIFY_REJECTED where an eager parse would have rejected it */
+static void RunIdentification(SC55ROMData *rom)
+{
+    int identified = HashAndIdentifyROM(rom, NULL, rom->hash_database, rom->stats);
+
+    if(identified < 0 || (identified > 0 && rom->ignore_sha256_failures == 0))
     {
-        drum_prog_threshold = 64;
+        rom->identify_state = SC55_IDENTIFY_REJECTED;
     }
     else
     {
-        drum_prog_threshold = 48;
+        rom->identify_state = SC55_IDENTIFY_DONE;
     }
+}
+
+#if defined(_WIN32) || defined(SC55_HAVE_MMAP)
+/*
+** The background thread works on its own copy of the struct, so the
+** caller's SC55ROMData can still be returned or moved by value while it
+** runs; the results are copied back when the thread is joined.
+*/
+struct SC55Identification
+{
+#if defined(_WIN32)
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+    SC55ROMData rom;
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI IdentificationThread(LPVOID argument)
+#else
+static void *IdentificationThread(void *argument)
+#endif
+{
+    RunIdentification(&((SC55Identification*)argument)->rom);
+    return 0;
+}
+#endif
+
+/* Waits for a background identification of the ROM, if there is one, and takes its results */
+static void JoinIdentification(SC55ROMData *rom)
+{
+#if defined(_WIN32) || defined(SC55_HAVE_MMAP)
+    SC55Identification *identification = rom->identification;
 
-    for(i = 0; i < drum_prog_threshold; i++)
+    if(!identification)
     {
-        if(i % 8 == 0)
-        {
-            drum_patch_value = rom->drum_table[i];
-        }
+        return;
+    }
 
-        if(rom->drum_table[i] == 0xff)
-        {
-            rom->drum_table[i] = drum_patch_value;
-        }
+#if defined(_WIN32)
+    WaitForSingleObject(identification->thread, INFINITE);
+    CloseHandle(identification->thread);
+#else
+    pthread_join(identification->thread, NULL);
+#endif
+
+    memcpy(rom->rom_sha256, identification->rom.rom_sha256, 32);
+    rom->is_known_rom = identification->rom.is_known_rom;
+    rom->rom_name = identification->rom.rom_name;
+    rom->rom_version_address = identification->rom.rom_version_address;
+    rom->identify_state = identification->rom.identify_state;
+    rom->identification = NULL;
+    SC55_FREE(identification);
+#else
+    (void)rom;
+#endif
+}
+
+/*
+** Hashes and identifies a ROM parsed with lazy_identify, waiting for a
+** background identification if one is running.  PatchROM and the other
+** calls that write to the ROM do this themselves; anything else that
+** reads rom_sha256, is_known_rom, rom_name or rom_version_address from a
+** lazily parsed ROM should call it first.  Calling it again, or on a ROM
+** parsed without lazy_identify, does nothing.  Returns 0 once the ROM is
+** identified, or 1 if it would have been rejected by an eager parse, in
+** which case nothing will patch it, or if it was patched before being
+** identified.
+*/
+int IdentifyROMData(SC55ROMData *rom)
+{
+    if(!rom || !rom->rom_data)
+    {
+        return 1;
     }
 
-    if(update_version && rom->is_known_rom)
+    JoinIdentification(rom);
+
+    if(rom->identify_state == SC55_IDENTIFY_PENDING)
     {
-        rom->rom_version_address[2] = 'C';
-        rom->rom_version_address[3] = 'T';
+        RunIdentification(rom);
     }
 
-    return 0;
+    return rom->identify_state == SC55_IDENTIFY_DONE ? 0 : 1;
+}
+
+/*
+** Gets a ROM ready to be changed.  Only the version update and an
+** enforced checksum depend on what the ROM is, so without either a
+** lazily parsed ROM is patched without being hashed, and the first byte
+** that changes leaves it SC55_IDENTIFY_SKIPPED.  Returns 0 if the ROM
+** may be changed.
+*/
+static int IdentifyROMForPatch(SC55ROMData *rom, const uint8_t update_version)
+{
+    /* A background hash must not see the image change under it */
+    JoinIdentification(rom);
+
+    if(!update_version && rom->ignore_sha256_failures && (rom->identify_state == SC55_IDENTIFY_PENDING || rom->identify_state == SC55_IDENTIFY_SKIPPED))
+    {
+        return 0;
+    }
+
+    return IdentifyROMData(rom);
+}
+
+/*
+** Starts identifying a lazily parsed ROM on a new thread, so the hash
+** overlaps with whatever the caller does next.  The ROM can be read in
+** the meantime, but its identity is only valid once IdentifyROMData has
+** returned, and its stats should not be read before then either.  Where
+** threads are not available, the ROM is identified before returning.
+** Returns 0 if identification started or has already happened.
+*/
+int StartROMIdentification(SC55ROMData *rom)
+{
+#if defined(_WIN32) || defined(SC55_HAVE_MMAP)
+    SC55Identification *identification;
+#endif
+
+    if(!rom || !rom->rom_data)
+    {
+        return 1;
+    }
+
+    if(rom->identify_state != SC55_IDENTIFY_PENDING || rom->identification)
+    {
+        return 0;
+    }
+
+#if defined(_WIN32) || defined(SC55_HAVE_MMAP)
+    identification = (SC55Identification*)SC55_MALLOC(sizeof(SC55Identification));
+    if(identification)
+    {
+        identification->rom = *rom;
+#if defined(_WIN32)
+        identification->thread = CreateThread(NULL, 0, IdentificationThread, identification, 0, NULL);
+        if(identification->thread != NULL)
+#else
+        if(pthread_create(&identification->thread, NULL, IdentificationThread, identification) == 0)
+#endif
+        {
+            rom->identification = identification;
+            return 0;
+        }
+        SC55_FREE(identification);
+    }
+#endif
+
+    IdentifyROMData(rom);
+
+    return 0;
+}
+
+void InitReadOptions(SC55ReadOptions *options)
+{
+    options->ignore_sha256_failures = 0;
+    options->use_mmap = 0;
+    options->hash_database = NULL;
+    options->stats = NULL;
+    options->buffer_pool = NULL;
+    options->lazy_identify = 0;
+}
+
+void InitROMStats(SC55ROMStats *stats)
+{
+    memset(stats, 0, sizeof(SC55ROMStats));
+}
+
+SC55ROMData ParseROM(uint8_t *rom_data, const size_t rom_size, const uint8_t ignore_sha256_failures)
+{
+    SC55ReadOptions options;
+
+    InitReadOptions(&options);
+    options.ignore_sha256_failures = ignore_sha256_failures;
+
+    return ParseROMWithSHA256(rom_data, rom_size, &options, NULL, SC55_ROM_STORAGE_HEAP);
+}
+
+SC55ROMData ParseROMWithOptions(uint8_t *rom_data, const size_t rom_size, const SC55ReadOptions *options)
+{
+    return ParseROMWithSHA256(rom_data, rom_size, options, NULL, SC55_ROM_STORAGE_HEAP);
+}
+
+/*
+** Parses ROM data that stays owned by the caller.  Nothing is allocated,
+** and DestroyROM only clears the struct, so the buffer can live in an
+** emulator's own memory.  A rejected buffer is left untouched.
+*/
+SC55ROMData ParseROMBorrowed(uint8_t *rom_data, const size_t rom_size, const SC55ReadOptions *options)
+{
+    return ParseROMWithSHA256(rom_data, rom_size, options, NULL, SC55_ROM_STORAGE_BORROWED);
+}
+
+void DestroyROM(SC55ROMData *rom)
+{
+    /* The data cannot go while a background identification is still hashing it */
+    JoinIdentification(rom);
+
+    if(rom->rom_data != NULL)
+    {
+#ifdef SC55_HAVE_MMAP
+        if(rom->rom_storage == SC55_ROM_STORAGE_MAPPED)
+        {
+            munmap(rom->rom_data, rom->rom_size);
+        }
+        else
+#endif
+        if(rom->rom_storage == SC55_ROM_STORAGE_POOLED)
+        {
+            ReleasePoolBuffer(rom->buffer_pool, rom->rom_data);
+        }
+        else if(rom->rom_storage != SC55_ROM_STORAGE_BORROWED)
+        {
+            SC55_FREE(rom->rom_data);
+        }
+    }
+    InitROMData(rom);
+}
+
+/* Takes a rom_size byte buffer from the options' pool if it has one large enough, otherwise from the heap */
+static uint8_t *AllocateReadBuffer(const SC55ReadOptions *options, const size_t rom_size, uint8_t *rom_storage)
+{
+    if(options->buffer_pool && rom_size <= options->buffer_pool->buffer_size)
+    {
+        *rom_storage = SC55_ROM_STORAGE_POOLED;
+        return AcquirePoolBuffer(options->buffer_pool);
+    }
+
+    *rom_storage = SC55_ROM_STORAGE_HEAP;
+    return (uint8_t*)SC55_MALLOC(rom_size);
+}
+
+/* Gives back a buffer from AllocateReadBuffer that never became a ROM */
+static void FreeReadBuffer(const SC55ReadOptions *options, uint8_t *rom_data, const uint8_t rom_storage)
+{
+    if(rom_storage == SC55_ROM_STORAGE_POOLED)
+    {
+        ReleasePoolBuffer(options->buffer_pool, rom_data);
+    }
+    else
+    {
+        SC55_FREE(rom_data);
+    }
+}
+
+/*
+** Reads fp to end of file in chunks, growing the buffer as needed and
+** hashing each chunk as it arrives, for input that cannot be sized up
+** front such as a pipe.  With a buffer pool, reading starts in a pooled
+** buffer and only moves to the heap if the input outgrows it.  fp is
+** left open.
+*/
+static SC55ROMData ReadROMFromStream(FILE *fp, const SC55ReadOptions *options)
+{
+    uint8_t *rom_data = NULL;
+    uint8_t *grown;
+    uint8_t rom_storage = SC55_ROM_STORAGE_HEAP;
+    size_t capacity = 0;
+    size_t rom_size = 0;
+    size_t chunk_size;
+    lonesha256_ctx sha256_ctx;
+    uint8_t rom_sha256[32];
+    SC55ROMStats *stats = options->stats;
+    uint64_t start;
+    uint64_t hash_start;
+    uint64_t hash_ns = 0;
+
+    SC55ROMData rom;
+    InitROMData(&rom);
+
+    start = SC55_STATS_START(stats);
+    lonesha256_init(&sha256_ctx);
+
+    if(options->buffer_pool)
+    {
+        rom_data = AcquirePoolBuffer(options->buffer_pool);
+        if(rom_data)
+        {
+            capacity = options->buffer_pool->buffer_size;
+            rom_storage = SC55_ROM_STORAGE_POOLED;
+        }
+    }
+
+    for(;;)
+    {
+        if(rom_size == capacity)
+        {
+            capacity = capacity ? capacity * 2 : SC55_STREAM_INITIAL_SIZE;
+            if(rom_storage == SC55_ROM_STORAGE_POOLED)
+            {
+                grown = capacity > rom_size ? (uint8_t*)SC55_MALLOC(capacity) : NULL;
+                if(grown != NULL)
+                {
+                    memcpy(grown, rom_data, rom_size);
+                    ReleasePoolBuffer(options->buffer_pool, rom_data);
+                    rom_data = grown;
+                    rom_storage = SC55_ROM_STORAGE_HEAP;
+                }
+            }
+            else
+            {
+                grown = capacity > rom_size ? (uint8_t*)SC55_REALLOC(rom_data, capacity) : NULL;
+                if(grown != NULL)
+                {
+                    rom_data = grown;
+                }
+            }
+
+            if(grown == NULL)
+            {
+                FreeReadBuffer(options, rom_data, rom_storage);
+                return rom;
+            }
+        }
+
+        chunk_size = capacity - rom_size;
+        if(chunk_size > SC55_READ_CHUNK_SIZE)
+        {
+            chunk_size = SC55_READ_CHUNK_SIZE;
+        }
+
+        chunk_size = fread(rom_data + rom_size, 1, chunk_size, fp);
+        if(chunk_size == 0)
+        {
+            break;
+        }
+
+        hash_start = SC55_STATS_START(stats);
+        lonesha256_update(&sha256_ctx, rom_data + rom_size, chunk_size);
+        if(stats)
+        {
+            hash_ns += GetTimeNs() - hash_start;
+        }
+        rom_size += chunk_size;
+    }
+
+    if(ferror(fp) || rom_size < SC55_MIN_ROM_SIZE || (options->ignore_sha256_failures == 0 && !IsKnownROMSize(rom_size, options->hash_database)))
+    {
+        FreeReadBuffer(options, rom_data, rom_storage);
+        return rom;
+    }
+
+    if(stats)
+    {
+        stats->read_ns += GetTimeNs() - start - hash_ns;
+        stats->hash_ns += hash_ns;
+        stats->bytes_read += rom_size;
+        stats->bytes_hashed += rom_size;
+    }
+
+    lonesha256_final(&sha256_ctx, rom_sha256);
+
+    return ParseROMWithSHA256(rom_data, rom_size, options, rom_sha256, rom_storage);
+}
+
+#ifdef SC55_HAVE_MMAP
+#if defined(__APPLE__)
+#define SC55_STAT_NS(st, field) ((int64_t)(st)->field##timespec.tv_sec * 1000000000 + (st)->field##timespec.tv_nsec)
+#else
+#define SC55_STAT_NS(st, field) ((int64_t)(st)->field##tim.tv_sec * 1000000000 + (st)->field##tim.tv_nsec)
+#endif
+
+/* The change time catches any write to the file, even one that sets the modification time back */
+static void GetROMSource(const struct stat *st, SC55ROMSource *source)
+{
+    source->device = (uint64_t)st->st_dev;
+    source->inode = (uint64_t)st->st_ino;
+    source->size = (uint64_t)st->st_size;
+    source->modified_ns = SC55_STAT_NS(st, st_m);
+    source->changed_ns = SC55_STAT_NS(st, st_c);
+}
+#endif
+
+static SC55ROMData ReadROMBuffered(const char *rom_file_path, const SC55ReadOptions *options)
+{
+    FILE *fp;
+
+    long file_size;
+    uint8_t *rom_data = NULL;
+    uint8_t rom_storage;
+    size_t rom_size;
+    size_t bytes_read = 0;
+    size_t chunk_size;
+    lonesha256_ctx sha256_ctx;
+    uint8_t rom_sha256[32];
+    SC55ROMStats *stats = options->stats;
+    uint64_t start;
+    uint64_t hash_start;
+    uint64_t hash_ns = 0;
+    SC55ROMSource source;
+#ifdef SC55_HAVE_MMAP
+    struct stat st;
+#endif
+
+    SC55ROMData rom;
+    InitROMData(&rom);
+    memset(&source, 0, sizeof(source));
+
+    if(!rom_file_path)
+    {
+        return rom;
+    }
+
+    fp = fopen(rom_file_path, "rb");
+    if(fp == NULL)
+    {
+        return rom;
+    }
+
+    /* Pipes and other files that cannot be sized are read as a stream */
+    if(fseek(fp, 0L, SEEK_END) != 0 || (file_size = ftell(fp)) < 0 || fseek(fp, 0L, SEEK_SET) != 0)
+    {
+        clearerr(fp);
+        rom = ReadROMFromStream(fp, options);
+        fclose(fp);
+        return rom;
+    }
+
+    rom_size = (size_t)file_size;
+
+#ifdef SC55_HAVE_MMAP
+    if(fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode))
+    {
+        GetROMSource(&st, &source);
+    }
+#endif
+
+    /* Reject before reading anything if the size cannot match a known ROM */
+    if(rom_size < SC55_MIN_ROM_SIZE || (options->ignore_sha256_failures == 0 && !IsKnownROMSize(rom_size, options->hash_database)))
+    {
+        fclose(fp);
+        return rom;
+    }
+
+    rom_data = AllocateReadBuffer(options, rom_size, &rom_storage);
+
+    if(rom_data == NULL)
+    {
+        fclose(fp);
+        return rom;
+    }
+
+    start = SC55_STATS_START(stats);
+    lonesha256_init(&sha256_ctx);
+
+    while(bytes_read < rom_size)
+    {
+        chunk_size = rom_size - bytes_read;
+        if(chunk_size > SC55_READ_CHUNK_SIZE)
+        {
+            chunk_size = SC55_READ_CHUNK_SIZE;
+        }
+
+        chunk_size = fread(rom_data + bytes_read, 1, chunk_size, fp);
+        if(chunk_size == 0)
+        {
+            break;
+        }
+
+        hash_start = SC55_STATS_START(stats);
+        lonesha256_update(&sha256_ctx, rom_data + bytes_read, chunk_size);
+        if(stats)
+        {
+            hash_ns += GetTimeNs() - hash_start;
+        }
+        bytes_read += chunk_size;
+    }
+
+    fclose(fp);
+
+    /* Reading and hashing are interleaved, so the hash time is taken out of the read time */
+    if(stats)
+    {
+        stats->read_ns += GetTimeNs() - start - hash_ns;
+        stats->hash_ns += hash_ns;
+        stats->bytes_read += bytes_read;
+        stats->bytes_hashed += bytes_read;
+    }
+
+    if(bytes_read != rom_size)
+    {
+        FreeReadBuffer(options, rom_data, rom_storage);
+        return rom;
+    }
+
+    lonesha256_final(&sha256_ctx, rom_sha256);
+
+    rom = ParseROMWithSHA256(rom_data, rom_size, options, rom_sha256, rom_storage);
+    if(rom.rom_size == 0 || rom.rom_data == NULL)
+    {
+        DestroyROM(&rom);
+        return rom;
+    }
+
+    rom.source = source;
+    return rom;
+}
+
+#ifdef SC55_HAVE_MMAP
+static SC55ROMData ReadROMMappedFile(const char *rom_file_path, const SC55ReadOptions *options)
+{
+    int fd;
+    struct stat st;
+    uint8_t *rom_data;
+    size_t rom_size;
+    uint64_t start;
+    SC55ROMData rom;
+    InitROMData(&rom);
+
+    if(!rom_file_path)
+    {
+        return rom;
+    }
+
+    fd = open(rom_file_path, O_RDONLY);
+    if(fd < 0)
+    {
+        return rom;
+    }
+
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return rom;
+    }
+
+    /* Only regular files can be mapped; anything else, such as a pipe, is read as a stream */
+    if(!S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return ReadROMBuffered(rom_file_path, options);
+    }
+
+    rom_size = (size_t)st.st_size;
+
+    if(rom_size < SC55_MIN_ROM_SIZE || (options->ignore_sha256_failures == 0 && !IsKnownROMSize(rom_size, options->hash_database)))
+    {
+        close(fd);
+        return rom;
+    }
+
+    start = SC55_STATS_START(options->stats);
+    rom_data = (uint8_t*)mmap(NULL, rom_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(rom_data == (uint8_t*)MAP_FAILED)
+    {
+        return rom;
+    }
+
+    posix_madvise(rom_data, rom_size, POSIX_MADV_SEQUENTIAL);
+
+    /* Pages are read in as they are hashed, so most of the I/O time shows up as hash time */
+    SC55_STATS_STOP(options->stats, read_ns, start);
+    SC55_STATS_ADD(options->stats, bytes_read, rom_size);
+
+    /* A rejected image is unmapped by ParseROM through DestroyROM */
+    rom = ParseROMWithSHA256(rom_data, rom_size, options, NULL, SC55_ROM_STORAGE_MAPPED);
+    if(rom.rom_data)
+    {
+        GetROMSource(&st, &rom.source);
+    }
+
+    return rom;
+}
+#endif
+
+SC55ROMData ReadROM(const char *rom_file_path, const uint8_t ignore_sha256_failures)
+{
+    SC55ReadOptions options;
+
+    InitReadOptions(&options);
+    options.ignore_sha256_failures = ignore_sha256_failures;
+
+    return ReadROMBuffered(rom_file_path, &options);
+}
+
+/*
+** Maps the ROM file copy-on-write instead of copying it into a heap
+** buffer.  Hashing reads straight from the page cache, and PatchROM only
+** duplicates the pages it touches (the tone and drum tables and the page
+** holding the version string).  The file itself is never modified.  On
+** platforms without mmap this is the same as ReadROM.
+*/
+SC55ROMData ReadROMMapped(const char *rom_file_path, const uint8_t ignore_sha256_failures)
+{
+    SC55ReadOptions options;
+
+    InitReadOptions(&options);
+    options.ignore_sha256_failures = ignore_sha256_failures;
+    options.use_mmap = 1;
+
+    return ReadROMWithOptions(rom_file_path, &options);
+}
+
+/*
+** Reads a ROM from an open stream, such as stdin, up to end of file.
+** The size is not known in advance, so the data goes into a buffer that
+** grows as it fills and is hashed chunk by chunk along the way.  fp is
+** not closed.
+*/
+SC55ROMData ReadROMStream(FILE *fp, const SC55ReadOptions *options)
+{
+    SC55ROMData rom;
+
+    if(!fp)
+    {
+        InitROMData(&rom);
+        return rom;
+    }
+
+    return ReadROMFromStream(fp, options);
+}
+
+SC55ROMData ReadROMWithOptions(const char *rom_file_path, const SC55ReadOptions *options)
+{
+#ifdef SC55_HAVE_MMAP
+    if(options->use_mmap)
+    {
+        return ReadROMMappedFile(rom_file_path, options);
+    }
+#endif
+
+    return ReadROMBuffered(rom_file_path, options);
+}
+
+#ifdef SC55_HAVE_MMAP
+/*
+** Removes an output file that shares its inode with other names, such
+** as a hardlinked batch output, so that writing the path creates a new
+** file instead of rewriting every name at once.  Returns 0 once the
+** path can be written.
+*/
+static int UnshareOutput(const char *rom_file_path)
+{
+    struct stat st;
+
+    if(lstat(rom_file_path, &st) == 0 && S_ISREG(st.st_mode) && st.st_nlink > 1 && unlink(rom_file_path) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
+/* Writes the whole image, replacing an output that has other hardlinks instead of writing through them */
+int WriteROM(const SC55ROMData *rom, const char *rom_file_path)
+{
+    return WriteROMWithDigest(rom, rom_file_path, NULL);
+}
+
+/* Same as WriteROM, also storing the SHA-256 of the bytes written in output_sha256 unless it is NULL */
+int WriteROMWithDigest(const SC55ROMData *rom, const char *rom_file_path, uint8_t output_sha256[32])
+{
+    FILE *fp;
+    int result;
+
+    if(!rom || !rom_file_path)
+    {
+        return 1;
+    }
+
+#ifdef SC55_HAVE_MMAP
+    if(UnshareOutput(rom_file_path) != 0)
+    {
+        return 1;
+    }
+#endif
+
+    fp = fopen(rom_file_path, "wb");
+    if(!fp)
+    {
+        return 1;
+    }
+
+    result = WriteROMStreamWithDigest(rom, fp, output_sha256);
+    if(fclose(fp) != 0)
+    {
+        result = 1;
+    }
+
+    return result;
+}
+
+/* Writes the whole image to an open stream, such as stdout, in one write and flushes it.  fp is not closed. */
+int WriteROMStream(const SC55ROMData *rom, FILE *fp)
+{
+    return WriteROMStreamWithDigest(rom, fp, NULL);
+}
+
+/*
+** Same as WriteROMStream, also storing the SHA-256 of the bytes written
+** in output_sha256 unless it is NULL.  The image is then written in
+** chunks, each hashed just before it is written while it is still in
+** cache, so the output never has to be read back to be checked.
+*/
+int WriteROMStreamWithDigest(const SC55ROMData *rom, FILE *fp, uint8_t output_sha256[32])
+{
+    lonesha256_ctx sha256_ctx;
+    size_t bytes_written = 0;
+    size_t chunk_size;
+    uint64_t start;
+    uint64_t hash_start;
+    uint64_t hash_ns = 0;
+
+    if(!rom || !rom->rom_data || !fp)
+    {
+        return 1;
+    }
+
+    start = SC55_STATS_START(rom->stats);
+    if(output_sha256)
+    {
+        lonesha256_init(&sha256_ctx);
+        while(bytes_written < rom->rom_size)
+        {
+            chunk_size = rom->rom_size - bytes_written;
+            if(chunk_size > SC55_READ_CHUNK_SIZE)
+            {
+                chunk_size = SC55_READ_CHUNK_SIZE;
+            }
+
+            hash_start = SC55_STATS_START(rom->stats);
+            lonesha256_update(&sha256_ctx, rom->rom_data + bytes_written, chunk_size);
+            if(rom->stats)
+            {
+                hash_ns += GetTimeNs() - hash_start;
+            }
+
+            if(fwrite(rom->rom_data + bytes_written, 1, chunk_size, fp) != chunk_size)
+            {
+                break;
+            }
+            bytes_written += chunk_size;
+        }
+        lonesha256_final(&sha256_ctx, output_sha256);
+    }
+    else
+    {
+        bytes_written = fwrite(rom->rom_data, 1, rom->rom_size, fp);
+    }
+
+    if(fflush(fp) != 0)
+    {
+        bytes_written = 0;
+    }
+
+    if(rom->stats)
+    {
+        rom->stats->write_ns += GetTimeNs() - start - hash_ns;
+        rom->stats->hash_ns += hash_ns;
+        rom->stats->bytes_written += bytes_written;
+        rom->stats->bytes_hashed += output_sha256 ? bytes_written : 0;
+    }
+
+    return bytes_written == rom->rom_size ? 0 : 1;
+}
+
+#ifdef SC55_HAVE_MMAP
+static int WriteAll(const int fd, const uint8_t *data, size_t length, off_t offset)
+{
+    ssize_t written;
+
+    while(length > 0)
+    {
+        written = pwrite(fd, data, length, offset);
+        if(written <= 0)
+        {
+            return 1;
+        }
+        data += written;
+        length -= (size_t)written;
+        offset += written;
+    }
+
+    return 0;
+}
+
+/* Makes dst_fd a byte-for-byte copy of src_fd, sharing extents where the filesystem allows it */
+static int CloneFile(const int src_fd, const int dst_fd, const size_t size)
+{
+    uint8_t buffer[0x4000];
+    size_t copied = 0;
+    ssize_t bytes_read;
+
+#ifdef FICLONE
+    if(ioctl(dst_fd, FICLONE, src_fd) == 0)
+    {
+        return 0;
+    }
+#endif
+
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+    {
+        ssize_t result;
+        loff_t src_offset = 0;
+        loff_t dst_offset = 0;
+
+        while(copied < size)
+        {
+            result = copy_file_range(src_fd, &src_offset, dst_fd, &dst_offset, size - copied, 0);
+            if(result <= 0)
+            {
+                break;
+            }
+            copied += (size_t)result;
+        }
+
+        if(copied == size)
+        {
+            return 0;
+        }
+    }
+#endif
+
+    /* Plain copy, resuming wherever copy_file_range stopped */
+    while(copied < size)
+    {
+        bytes_read = pread(src_fd, buffer, sizeof(buffer), (off_t)copied);
+        if(bytes_read <= 0 || WriteAll(dst_fd, buffer, (size_t)bytes_read, (off_t)copied) != 0)
+        {
+            return 1;
+        }
+        copied += (size_t)bytes_read;
+    }
+
+    return 0;
+}
+#endif
+
+/*
+** Writes the ROM by cloning the file it was loaded from (a reflink on
+** filesystems that support it, otherwise copy_file_range or a plain
+** copy) and then writing only the ranges PatchROM recorded as dirty.
+** This needs the source to be the file the ROM was read from, unchanged
+** since the read, so otherwise the whole image is written.  If the
+** output is the source file itself, only the dirty ranges are written.  Like WriteROM, an output with other hardlinks is replaced
+** by a new file rather than written through them all.  Falls back to
+** WriteROM when the source cannot be used or on platforms without POSIX
+** file I/O.
+*/
+int WriteROMDelta(const SC55ROMData *rom, const char *source_rom_path, const char *rom_file_path)
+{
+    return WriteROMDeltaWithDigest(rom, source_rom_path, rom_file_path, NULL);
+}
+
+/*
+** Same as WriteROMDelta, also storing the SHA-256 of the output in
+** output_sha256 unless it is NULL.  Only the dirty ranges pass through
+** this process, so the digest is taken over the image in memory.  That
+** is only what the output holds if the source is the file the ROM was
+** read from and has not changed since, so the source is checked against
+** what the read recorded, and if it differs, or the ROM was not read
+** from a file, the whole image is written instead of cloning.
+*/
+int WriteROMDeltaWithDigest(const SC55ROMData *rom, const char *source_rom_path, const char *rom_file_path, uint8_t output_sha256[32])
+{
+#ifdef SC55_HAVE_MMAP
+    int src_fd, dst_fd;
+    struct stat src_st, dst_st;
+    SC55ROMSource source;
+    int source_unchanged;
+    size_t i;
+    uint64_t start;
+    int result = 0;
+
+    if(!rom || !rom->rom_data || !rom_file_path)
+    {
+        return 1;
+    }
+
+    if(!source_rom_path)
+    {
+        return WriteROMWithDigest(rom, rom_file_path, output_sha256);
+    }
+
+    start = SC55_STATS_START(rom->stats);
+    src_fd = open(source_rom_path, O_RDONLY);
+    if(src_fd < 0)
+    {
+        return WriteROMWithDigest(rom, rom_file_path, output_sha256);
+    }
+
+    if(fstat(src_fd, &src_st) != 0 || !S_ISREG(src_st.st_mode) || (size_t)src_st.st_size != rom->rom_size)
+    {
+        close(src_fd);
+        return WriteROMWithDigest(rom, rom_file_path, output_sha256);
+    }
+
+    GetROMSource(&src_st, &source);
+    source_unchanged = memcmp(&source, &rom->source, sizeof(source)) == 0;
+
+    /* The source stays open, so it can still be cloned if the output was one of its names */
+    if(UnshareOutput(rom_file_path) != 0)
+    {
+        close(src_fd);
+        return 1;
+    }
+
+    dst_fd = open(rom_file_path, O_WRONLY | O_CREAT, 0666);
+    if(dst_fd < 0 || fstat(dst_fd, &dst_st) != 0)
+    {
+        if(dst_fd >= 0)
+        {
+            close(dst_fd);
+        }
+        close(src_fd);
+        return 1;
+    }
+
+    if(!source_unchanged)
+    {
+        /* Cut to size only after writing, since a mapped image may still read its pages from this file */
+        if(WriteAll(dst_fd, rom->rom_data, rom->rom_size, 0) != 0 || ftruncate(dst_fd, (off_t)rom->rom_size) != 0)
+        {
+            result = 1;
+        }
+        SC55_STATS_ADD(rom->stats, bytes_written, rom->rom_size);
+    }
+    else if(dst_st.st_dev != src_st.st_dev || dst_st.st_ino != src_st.st_ino)
+    {
+        if(ftruncate(dst_fd, 0) != 0 || CloneFile(src_fd, dst_fd, rom->rom_size) != 0)
+        {
+            result = 1;
+        }
+    }
+
+    close(src_fd);
+
+    for(i = 0; i < rom->num_dirty_ranges && source_unchanged && result == 0; i++)
+    {
+        result = WriteAll(dst_fd, rom->rom_data + rom->dirty_ranges[i].offset, rom->dirty_ranges[i].length, (off_t)rom->dirty_ranges[i].offset);
+        SC55_STATS_ADD(rom->stats, bytes_written, rom->dirty_ranges[i].length);
+    }
+
+    if(close(dst_fd) != 0)
+    {
+        result = 1;
+    }
+
+    SC55_STATS_STOP(rom->stats, write_ns, start);
+
+    if(output_sha256 && result == 0)
+    {
+        start = SC55_STATS_START(rom->stats);
+        lonesha256(output_sha256, rom->rom_data, rom->rom_size);
+        SC55_STATS_STOP(rom->stats, hash_ns, start);
+        SC55_STATS_ADD(rom->stats, bytes_hashed, rom->rom_size);
+    }
+
+    return result;
+#else
+    (void)source_rom_path;
+    return WriteROMWithDigest(rom, rom_file_path, output_sha256);
+#endif
+}
+
+/* Returns the SC55_HASHES index of a built-in ROM, or the number of entries if it is not one */
+static size_t FindBuiltInROM(const uint8_t rom_sha256[32], const size_t rom_size)
+{
+    size_t sc55_num_hashes = sizeof(SC55_HASH_INDEX)/sizeof(SC55HashIndexEntry);
+    size_t low = 0;
+    size_t high = sc55_num_hashes;
+    size_t middle;
+    int order;
+
+    while(low < high)
+    {
+        middle = low + ((high - low) / 2);
+        order = memcmp(SC55_HASH_INDEX[middle].sha256, rom_sha256, 32);
+        if(order == 0)
+        {
+            if(SC55_HASHES[SC55_HASH_INDEX[middle].hash_index].file_size == rom_size)
+            {
+                return SC55_HASH_INDEX[middle].hash_index;
+            }
+            break;
+        }
+
+        if(order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return sizeof(SC55_HASHES)/sizeof(SC55Hash);
+}
+
+SC55Hash IdentifyROM(const uint8_t rom_sha256[32], const size_t rom_size)
+{
+    size_t hash_index = FindBuiltInROM(rom_sha256, rom_size);
+
+    if(hash_index < sizeof(SC55_HASHES)/sizeof(SC55Hash))
+    {
+        return SC55_HASHES[hash_index];
+    }
+
+    return (SC55Hash){"", 0, "", 0};
+}
+
+/*
+** Hashes num_roms images of rom_size bytes each, several at a time in
+** lockstep where the CPU supports it (see GetSHA256Lanes), and stores
+** each digest in rom_sha256.  If identities is not NULL, each image is
+** then looked up as LookupROM does, and unknown images get an identity
+** with a NULL rom_name.  Returns 0 on success.
+*/
+int IdentifyROMs(const SC55HashDatabase *hash_database, const uint8_t *const *rom_data, const size_t num_roms, const size_t rom_size, uint8_t (*rom_sha256)[32], SC55ROMIdentity *identities)
+{
+    size_t i;
+
+    if(ComputeSHA256Multi(-1, rom_data, num_roms, rom_size, rom_sha256) != 0)
+    {
+        return 1;
+    }
+
+    for(i = 0; identities && i < num_roms; i++)
+    {
+        if(!LookupROM(hash_database, rom_sha256[i], rom_size, &identities[i]))
+        {
+            identities[i].file_size = 0;
+            identities[i].rom_name = NULL;
+            identities[i].version_address = 0;
+        }
+    }
+
+    return 0;
+}
+
+/*
+** Looks a ROM up in the built-in hashes and then in hash_database, if
+** it is not NULL.  Returns 1 and fills identity if the ROM is known.
+** Names from the database point into it and stay valid until it is
+** closed.
+*/
+uint8_t LookupROM(const SC55HashDatabase *hash_database, const uint8_t rom_sha256[32], const size_t rom_size, SC55ROMIdentity *identity)
+{
+    size_t hash_index;
+    size_t low, high, middle;
+    const uint8_t *record;
+    int order;
+
+    if(!IsKnownROMSize(rom_size, hash_database))
+    {
+        return 0;
+    }
+
+    hash_index = FindBuiltInROM(rom_sha256, rom_size);
+    if(hash_index < sizeof(SC55_HASHES)/sizeof(SC55Hash))
+    {
+        identity->file_size = SC55_HASHES[hash_index].file_size;
+        identity->rom_name = SC55_HASHES[hash_index].rom_name;
+        identity->version_address = SC55_HASHES[hash_index].version_address;
+        return 1;
+    }
+
+    if(!hash_database)
+    {
+        return 0;
+    }
+
+    /* Records are ordered by digest and then size, so search on both */
+    low = 0;
+    high = hash_database->num_records;
+    while(low < high)
+    {
+        middle = low + ((high - low) / 2);
+        record = HashDatabaseRecord(hash_database, middle);
+        order = memcmp(record, rom_sha256, 32);
+        if(order == 0 && LoadLE64(record + 32) != (uint64_t)rom_size)
+        {
+            order = LoadLE64(record + 32) < (uint64_t)rom_size ? -1 : 1;
+        }
+
+        if(order == 0)
+        {
+            identity->file_size = rom_size;
+            identity->rom_name = (const char*)(record + SC55_HASH_DB_NAME_OFFSET);
+            identity->version_address = (size_t)LoadLE64(record + 40);
+            return 1;
+        }
+
+        if(order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return 0;
+}
+
+static int CompareHashRecords(const void *a, const void *b)
+{
+    const uint8_t *record_a = (const uint8_t*)a;
+    const uint8_t *record_b = (const uint8_t*)b;
+    int order = memcmp(record_a, record_b, 32);
+
+    if(order == 0 && LoadLE64(record_a + 32) != LoadLE64(record_b + 32))
+    {
+        order = LoadLE64(record_a + 32) < LoadLE64(record_b + 32) ? -1 : 1;
+    }
+
+    return order;
+}
+
+static int CompareSizes(const void *a, const void *b)
+{
+    size_t size_a = *(const size_t*)a;
+    size_t size_b = *(const size_t*)b;
+
+    return size_a < size_b ? -1 : (size_a > size_b ? 1 : 0);
+}
+
+/*
+** Opens a hash database written by BuildHashDatabase, mapping it where
+** mmap is available.  The whole file is validated here, so lookups can
+** trust it.  Returns NULL if it cannot be read or is malformed.
+*/
+SC55HashDatabase *OpenHashDatabase(const char *database_path)
+{
+    SC55HashDatabase *hash_database;
+    const uint8_t *record;
+    uint8_t *data = NULL;
+    size_t data_size = 0;
+    uint8_t mapped = 0;
+    size_t num_records;
+    size_t i;
+    int valid = 1;
+
+    if(!database_path)
+    {
+        return NULL;
+    }
+
+#ifdef SC55_HAVE_MMAP
+    {
+        int fd = open(database_path, O_RDONLY);
+        struct stat st;
+
+        if(fd < 0)
+        {
+            return NULL;
+        }
+
+        if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= SC55_HASH_DB_HEADER_SIZE)
+        {
+            data_size = (size_t)st.st_size;
+            data = (uint8_t*)mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data == (uint8_t*)MAP_FAILED)
+            {
+                data = NULL;
+            }
+            mapped = 1;
+        }
+        close(fd);
+    }
+#else
+    {
+        FILE *fp = fopen(database_path, "rb");
+        long file_size;
+
+        if(fp == NULL)
+        {
+            return NULL;
+        }
+
+        if(fseek(fp, 0L, SEEK_END) == 0 && (file_size = ftell(fp)) >= SC55_HASH_DB_HEADER_SIZE && fseek(fp, 0L, SEEK_SET) == 0)
+        {
+            data_size = (size_t)file_size;
+            data = (uint8_t*)SC55_MALLOC(data_size);
+            if(data && fread(data, 1, data_size, fp) != data_size)
+            {
+                SC55_FREE(data);
+                data = NULL;
+            }
+        }
+        fclose(fp);
+    }
+#endif
+
+    if(data == NULL)
+    {
+        return NULL;
+    }
+
+    hash_database = (SC55HashDatabase*)SC55_CALLOC(1, sizeof(SC55HashDatabase));
+    num_records = LoadLE32(data + 8);
+
+    if(!hash_database || memcmp(data, SC55_HASH_DB_MAGIC, 8) != 0 || LoadLE32(data + 12) != SC55_HASH_DB_RECORD_SIZE || (data_size - SC55_HASH_DB_HEADER_SIZE) / SC55_HASH_DB_RECORD_SIZE != num_records || (data_size - SC55_HASH_DB_HEADER_SIZE) % SC55_HASH_DB_RECORD_SIZE != 0)
+    {
+        valid = 0;
+    }
+
+    for(i = 0; valid && i < num_records; i++)
+    {
+        record = data + SC55_HASH_DB_HEADER_SIZE + (i * SC55_HASH_DB_RECORD_SIZE);
+
+        /* Sorted and unique, with a terminated name and a version string inside the ROM */
+        if((i > 0 && CompareHashRecords(record - SC55_HASH_DB_RECORD_SIZE, record) >= 0) || memchr(record + SC55_HASH_DB_NAME_OFFSET, 0, SC55_HASH_DB_NAME_SIZE) == NULL || LoadLE64(record + 32) < SC55_MIN_ROM_SIZE || LoadLE64(record + 32) > (uint64_t)SIZE_MAX || LoadLE64(record + 40) > LoadLE64(record + 32) - 4)
+        {
+            valid = 0;
+        }
+    }
+
+    if(valid)
+    {
+        hash_database->data = data;
+        hash_database->data_size = data_size;
+        hash_database->mapped = mapped;
+        hash_database->num_records = num_records;
+        hash_database->file_sizes = (size_t*)SC55_MALLOC((num_records ? num_records : 1) * sizeof(size_t));
+        if(hash_database->file_sizes == NULL)
+        {
+            valid = 0;
+        }
+    }
+
+    if(!valid)
+    {
+        if(hash_database)
+        {
+            SC55_FREE(hash_database->file_sizes);
+            SC55_FREE(hash_database);
+        }
+#ifdef SC55_HAVE_MMAP
+        munmap(data, data_size);
+#else
+        SC55_FREE(data);
+#endif
+        return NULL;
+    }
+
+    for(i = 0; i < num_records; i++)
+    {
+        hash_database->file_sizes[i] = (size_t)LoadLE64(HashDatabaseRecord(hash_database, i) + 32);
+    }
+
+    qsort(hash_database->file_sizes, num_records, sizeof(size_t), CompareSizes);
+    for(i = 0; i < num_records; i++)
+    {
+        if(i == 0 || hash_database->file_sizes[i] != hash_database->file_sizes[hash_database->num_file_sizes - 1])
+        {
+            hash_database->file_sizes[hash_database->num_file_sizes++] = hash_database->file_sizes[i];
+        }
+    }
+
+    return hash_database;
+}
+
+void CloseHashDatabase(SC55HashDatabase *hash_database)
+{
+    if(!hash_database)
+    {
+        return;
+    }
+
+#ifdef SC55_HAVE_MMAP
+    if(hash_database->mapped)
+    {
+        munmap((void*)hash_database->data, hash_database->data_size);
+    }
+    else
+#endif
+    {
+        SC55_FREE((void*)hash_database->data);
+    }
+
+    SC55_FREE(hash_database->file_sizes);
+    SC55_FREE(hash_database);
+}
+
+static int ParseHexDigest(const char *hex, uint8_t digest[32])
+{
+    size_t i;
+    int high, low;
+
+    for(i = 0; i < 64; i++)
+    {
+        if(!((hex[i] >= '0' && hex[i] <= '9') || (hex[i] >= 'a' && hex[i] <= 'f') || (hex[i] >= 'A' && hex[i] <= 'F')))
+        {
+            return 1;
+        }
+    }
+
+    for(i = 0; i < 32; i++)
+    {
+        high = hex[i * 2] <= '9' ? hex[i * 2] - '0' : (hex[i * 2] | 0x20) - 'a' + 10;
+        low = hex[(i * 2) + 1] <= '9' ? hex[(i * 2) + 1] - '0' : (hex[(i * 2) + 1] | 0x20) - 'a' + 10;
+        digest[i] = (uint8_t)((high << 4) | low);
+    }
+
+    return 0;
+}
+
+/*
+** Checks output_sha256, the digest of a ROM patched with the given
+** options, against SC55_PATCHED_HASHES.  rom_sha256 is the digest of
+** the ROM before it was patched.  Returns SC55_PATCHED_DIGEST_MATCH or
+** SC55_PATCHED_DIGEST_MISMATCH, or SC55_PATCHED_DIGEST_UNKNOWN if there
+** is no expected digest for that ROM and those options.
+*/
+int CheckPatchedDigest(const uint8_t rom_sha256[32], const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version, const uint8_t output_sha256[32])
+{
+    const SC55PatchedHash *entry;
+    uint8_t digest[32];
+
+    for(entry = SC55_PATCHED_HASHES; entry->source_sha256hash[0] != 0; entry++)
+    {
+        if(entry->compat_mode != compat_mode || entry->drum_compat_mode != drum_compat_mode || (entry->update_version != 0) != (update_version != 0))
+        {
+            continue;
+        }
+
+        if(ParseHexDigest(entry->source_sha256hash, digest) != 0 || memcmp(digest, rom_sha256, 32) != 0)
+        {
+            continue;
+        }
+
+        if(ParseHexDigest(entry->patched_sha256hash, digest) != 0 || memcmp(digest, output_sha256, 32) != 0)
+        {
+            return SC55_PATCHED_DIGEST_MISMATCH;
+        }
+
+        return SC55_PATCHED_DIGEST_MATCH;
+    }
+
+    return SC55_PATCHED_DIGEST_UNKNOWN;
+}
+
+/*
+** Converts a text listing into a hash database file.  Each line of the
+** listing holds a SHA-256 in hex, the file size, the address of the
+** version string and the ROM name, separated by whitespace; the name
+** runs to the end of the line.  Blank lines and lines starting with '#'
+** are skipped.  Returns 0 on success.
+*/
+int BuildHashDatabase(const char *listing_path, const char *database_path)
+{
+    FILE *fp;
+    char line[512];
+    char *cursor;
+    char *end;
+    uint8_t *records = NULL;
+    uint8_t *grown;
+    uint8_t *record;
+    size_t num_records = 0;
+    size_t capacity = 0;
+    size_t length;
+    size_t i;
+    unsigned long long file_size;
+    unsigned long long version_address;
+    uint8_t header[SC55_HASH_DB_HEADER_SIZE];
+    int result = 0;
+
+    if(!listing_path || !database_path)
+    {
+        return 1;
+    }
+
+    fp = fopen(listing_path, "r");
+    if(fp == NULL)
+    {
+        return 1;
+    }
+
+    while(result == 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        length = strlen(line);
+        while(length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t'))
+        {
+            line[--length] = 0;
+        }
+
+        cursor = line;
+        while(*cursor == ' ' || *cursor == '\t')
+        {
+            cursor++;
+        }
+
+        if(*cursor == 0 || *cursor == '#')
+        {
+            continue;
+        }
+
+        if(num_records == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            grown = (uint8_t*)SC55_REALLOC(records, capacity * SC55_HASH_DB_RECORD_SIZE);
+            if(grown == NULL)
+            {
+                result = 1;
+                break;
+            }
+            records = grown;
+        }
+
+        record = records + (num_records * SC55_HASH_DB_RECORD_SIZE);
+        memset(record, 0, SC55_HASH_DB_RECORD_SIZE);
+
+        if(strlen(cursor) < 64 || ParseHexDigest(cursor, record) != 0 || (cursor[64] != ' ' && cursor[64] != '\t'))
+        {
+            result = 1;
+            break;
+        }
+
+        file_size = strtoull(cursor + 64, &end, 0);
+        cursor = end;
+        version_address = strtoull(cursor, &end, 0);
+        if(end == cursor || (*end != ' ' && *end != '\t'))
+        {
+            result = 1;
+            break;
+        }
+
+        cursor = end;
+        while(*cursor == ' ' || *cursor == '\t')
+        {
+            cursor++;
+        }
+
+        if(file_size < SC55_MIN_ROM_SIZE || version_address > file_size - 4 || *cursor == 0 || strlen(cursor) >= SC55_HASH_DB_NAME_SIZE)
+        {
+            result = 1;
+            break;
+        }
+
+        StoreLE64(record + 32, (uint64_t)file_size);
+        StoreLE64(record + 40, (uint64_t)version_address);
+        memcpy(record + SC55_HASH_DB_NAME_OFFSET, cursor, strlen(cursor));
+        num_records++;
+    }
+
+    fclose(fp);
+
+    if(result == 0 && num_records > 0)
+    {
+        qsort(records, num_records, SC55_HASH_DB_RECORD_SIZE, CompareHashRecords);
+        for(i = 1; i < num_records; i++)
+        {
+            if(CompareHashRecords(records + ((i - 1) * SC55_HASH_DB_RECORD_SIZE), records + (i * SC55_HASH_DB_RECORD_SIZE)) == 0)
+            {
+                result = 1;
+            }
+        }
+    }
+
+    if(result == 0)
+    {
+        memcpy(header, SC55_HASH_DB_MAGIC, 8);
+        StoreLE32(header + 8, (uint32_t)num_records);
+        StoreLE32(header + 12, SC55_HASH_DB_RECORD_SIZE);
+
+        fp = fopen(database_path, "wb");
+        if(fp == NULL)
+        {
+            result = 1;
+        }
+        else
+        {
+            if(fwrite(header, 1, SC55_HASH_DB_HEADER_SIZE, fp) != SC55_HASH_DB_HEADER_SIZE || (num_records > 0 && fwrite(records, SC55_HASH_DB_RECORD_SIZE, num_records, fp) != num_records))
+            {
+                result = 1;
+            }
+
+            if(fclose(fp) != 0)
+            {
+                result = 1;
+            }
+        }
+    }
+
+    SC55_FREE(records);
+    return result;
+}
+
+/* Returns the patch program SC55ToneMap.h compiled for the ROM's model and the given modes */
+static const SC55PatchProgram *GetPatchProgram(const SC55ROMData *rom, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version)
+{
+    size_t plan;
+    size_t drum_mode = drum_compat_mode == SC55_DRUM_EARLY_COMPAT ? SC55_PATCH_DRUM_EARLY : SC55_PATCH_DRUM_LATE;
+
+    switch(compat_mode)
+    {
+        case SC55_STRICT_SC55_COMPAT:
+            plan = SC55_TONE_PLAN_STRICT;
+            break;
+        case SC55_SC55_COMPAT:
+            plan = SC55_TONE_PLAN_SC55;
+            break;
+        default:
+            plan = SC55_TONE_PLAN_MKII;
+            break;
+    }
+
+    return &SC55_PATCH_PROGRAMS[rom->rom_model][plan][drum_mode][update_version ? 1 : 0];
+}
+
+/* The two bytes of the version string a patch may replace, or NULL for an unknown ROM */
+uint8_t *PatchedVersionAddress(const SC55ROMData *rom)
+{
+    if(!rom->is_known_rom)
+    {
+        return NULL;
+    }
+
+    return rom->rom_version_address + SC55_MODEL_LAYOUTS[rom->rom_model].version_offset;
+}
+
+/* The count plan bits starting at prog, which must not cross a 64-program word */
+#define SC55_PLAN_BITS(mask, prog, count) ((unsigned)(((mask)[(prog) / 64] >> ((prog) % 64)) & ((1u << (count)) - 1)))
+
+/* Widens changed to cover [offset, offset + length) */
+static void NoteChange(SC55ROMRange *changed, const size_t offset, const size_t length)
+{
+    size_t end = offset + length;
+
+    if(changed->length == 0)
+    {
+        changed->offset = offset;
+        changed->length = length;
+        return;
+    }
+
+    if(changed->offset + changed->length > end)
+    {
+        end = changed->offset + changed->length;
+    }
+    if(offset < changed->offset)
+    {
+        changed->offset = offset;
+    }
+    changed->length = end - changed->offset;
+}
+
+/*
+** Every kernel below works on the table as stored, two big-endian bytes
+** per tone.  Tones are only compared against 0xffff and moved as whole
+** 16-bit lanes, so their byte order never matters.  Rows are filled
+** from bank 63 down to bank 0; a row only reads its group bank and bank
+** 0, which come before it, so each row sees the original table and the
+** result matches filling a separate copy.
+*/
+/* Also built as the reference the self-tests (SC55_SELF_TEST) check the vector kernels against */
+#if defined(SC55_SELF_TEST) || !(defined(SC55_HAVE_SSE2) || defined(SC55_HAVE_NEON))
+static void FillToneTablePortable(uint8_t *tone_table, const SC55TonePlan *plan, SC55ROMRange *changed)
+{
+    size_t bank, prog;
+    uint8_t *row;
+    const uint8_t *group_row;
+
+    uint16_t current_tone, group_tone, capital_tone;
+    uint16_t fallback_tone, updated_tone;
+    uint16_t use_group, need_fallback;
+
+    for(bank = SC55_TONE_MAP_BANKS; bank-- > 0;)
+    {
+        row = tone_table + (bank * 256);
+        group_row = tone_table + ((bank & 0x78) * 256);
+
+        for(prog = 0; prog < 128; prog++)
+        {
+            current_tone = (uint16_t)((row[prog * 2] << 8) | row[(prog * 2) + 1]);
+            group_tone = (uint16_t)((group_row[prog * 2] << 8) | group_row[(prog * 2) + 1]);
+            capital_tone = (uint16_t)((tone_table[prog * 2] << 8) | tone_table[(prog * 2) + 1]);
+
+            /* All ones when the group bank may be used and holds a tone, otherwise zero */
+            use_group = (uint16_t)(0 - (SC55_PLAN_BITS(plan->use_group[bank], prog, 1) & (group_tone != 0xffff)));
+            fallback_tone = (uint16_t)((group_tone & use_group) | (capital_tone & ~use_group));
+
+            need_fallback = (uint16_t)(0 - (SC55_PLAN_BITS(SC55_TONE_FILL, prog, 1) & ((current_tone == 0xffff) | SC55_PLAN_BITS(plan->force[bank], prog, 1))));
+            updated_tone = (uint16_t)((fallback_tone & need_fallback) | (current_tone & ~need_fallback));
+
+            if(updated_tone != current_tone)
+            {
+                row[prog * 2] = (uint8_t)(updated_tone >> 8);
+                row[(prog * 2) + 1] = (uint8_t)(updated_tone & 0xff);
+                NoteChange(changed, (bank * 256) + (prog * 2), 2);
+            }
+        }
+    }
+}
+#endif
+
+#ifdef SC55_HAVE_SSE2
+static __m128i ExpandPlanBitsSSE2(const unsigned bits)
+{
+    const __m128i lane_bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+
+    return _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16((short)bits), lane_bits), lane_bits);
+}
+
+static void FillToneTableSSE2(uint8_t *tone_table, const SC55TonePlan *plan, SC55ROMRange *changed)
+{
+    const __m128i empty = _mm_set1_epi8(-1);
+    size_t bank, prog;
+    uint8_t *row;
+    const uint8_t *group_row;
+    __m128i current, group, capital, use_group, fallback, need_fallback, updated;
+
+    for(bank = SC55_TONE_MAP_BANKS; bank-- > 0;)
+    {
+        row = tone_table + (bank * 256);
+        group_row = tone_table + ((bank & 0x78) * 256);
+
+        for(prog = 0; prog < 128; prog += 8)
+        {
+            current = _mm_loadu_si128((const __m128i*)(row + (prog * 2)));
+            group = _mm_loadu_si128((const __m128i*)(group_row + (prog * 2)));
+            capital = _mm_loadu_si128((const __m128i*)(tone_table + (prog * 2)));
+
+            use_group = _mm_andnot_si128(_mm_cmpeq_epi16(group, empty), ExpandPlanBitsSSE2(SC55_PLAN_BITS(plan->use_group[bank], prog, 8)));
+            fallback = _mm_or_si128(_mm_and_si128(use_group, group), _mm_andnot_si128(use_group, capital));
+
+            need_fallback = _mm_or_si128(_mm_cmpeq_epi16(current, empty), ExpandPlanBitsSSE2(SC55_PLAN_BITS(plan->force[bank], prog, 8)));
+            need_fallback = _mm_and_si128(need_fallback, ExpandPlanBitsSSE2(SC55_PLAN_BITS(SC55_TONE_FILL, prog, 8)));
+            updated = _mm_or_si128(_mm_and_si128(need_fallback, fallback), _mm_andnot_si128(need_fallback, current));
+
+            if(_mm_movemask_epi8(_mm_cmpeq_epi8(updated, current)) != 0xffff)
+            {
+                _mm_storeu_si128((__m128i*)(row + (prog * 2)), updated);
+                NoteChange(changed, (bank * 256) + (prog * 2), 16);
+            }
+        }
+    }
+}
+#endif
+
+#ifdef SC55_HAVE_AVX2
+__attribute__((target("avx2")))
+static __m256i ExpandPlanBitsAVX2(const unsigned bits)
+{
+    const __m256i lane_bits = _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, (short)0x8000);
+
+    return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16((short)bits), lane_bits), lane_bits);
+}
+
+__attribute__((target("avx2")))
+static void FillToneTableAVX2(uint8_t *tone_table, const SC55TonePlan *plan, SC55ROMRange *changed)
+{
+    const __m256i empty = _mm256_set1_epi8(-1);
+    size_t bank, prog;
+    uint8_t *row;
+    const uint8_t *group_row;
+    __m256i current, group, capital, use_group, fallback, need_fallback, updated;
+
+    for(bank = SC55_TONE_MAP_BANKS; bank-- > 0;)
+    {
+        row = tone_table + (bank * 256);
+        group_row = tone_table + ((bank & 0x78) * 256);
+
+        for(prog = 0; prog < 128; prog += 16)
+        {
+            current = _mm256_loadu_si256((const __m256i*)(row + (prog * 2)));
+            group = _mm256_loadu_si256((const __m256i*)(group_row + (prog * 2)));
+            capital = _mm256_loadu_si256((const __m256i*)(tone_table + (prog * 2)));
+
+            use_group = _mm256_andnot_si256(_mm256_cmpeq_epi16(group, empty), ExpandPlanBitsAVX2(SC55_PLAN_BITS(plan->use_group[bank], prog, 16)));
+            fallback = _mm256_blendv_epi8(capital, group, use_group);
+
+            need_fallback = _mm256_or_si256(_mm256_cmpeq_epi16(current, empty), ExpandPlanBitsAVX2(SC55_PLAN_BITS(plan->force[bank], prog, 16)));
+            need_fallback = _mm256_and_si256(need_fallback, ExpandPlanBitsAVX2(SC55_PLAN_BITS(SC55_TONE_FILL, prog, 16)));
+            updated = _mm256_blendv_epi8(current, fallback, need_fallback);
+
+            if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(updated, current)) != -1)
+            {
+                _mm256_storeu_si256((__m256i*)(row + (prog * 2)), updated);
+                NoteChange(changed, (bank * 256) + (prog * 2), 32);
+            }
+        }
+    }
+}
+#endif
+
+#ifdef SC55_HAVE_NEON
+static uint16x8_t ExpandPlanBitsNEON(const unsigned bits)
+{
+    static const uint16_t lane_bits[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+
+    return vtstq_u16(vdupq_n_u16((uint16_t)bits), vld1q_u16(lane_bits));
+}
+
+static void FillToneTableNEON(uint8_t *tone_table, const SC55TonePlan *plan, SC55ROMRange *changed)
+{
+    const uint16x8_t empty = vdupq_n_u16(0xffff);
+    size_t bank, prog;
+    uint8_t *row;
+    const uint8_t *group_row;
+    uint16x8_t current, group, capital, use_group, fallback, need_fallback, updated;
+
+    for(bank = SC55_TONE_MAP_BANKS; bank-- > 0;)
+    {
+        row = tone_table + (bank * 256);
+        group_row = tone_table + ((bank & 0x78) * 256);
+
+        for(prog = 0; prog < 128; prog += 8)
+        {
+            current = vreinterpretq_u16_u8(vld1q_u8(row + (prog * 2)));
+            group = vreinterpretq_u16_u8(vld1q_u8(group_row + (prog * 2)));
+            capital = vreinterpretq_u16_u8(vld1q_u8(tone_table + (prog * 2)));
+
+            use_group = vbicq_u16(ExpandPlanBitsNEON(SC55_PLAN_BITS(plan->use_group[bank], prog, 8)), vceqq_u16(group, empty));
+            fallback = vbslq_u16(use_group, group, capital);
+
+            need_fallback = vorrq_u16(vceqq_u16(current, empty), ExpandPlanBitsNEON(SC55_PLAN_BITS(plan->force[bank], prog, 8)));
+            need_fallback = vandq_u16(need_fallback, ExpandPlanBitsNEON(SC55_PLAN_BITS(SC55_TONE_FILL, prog, 8)));
+            updated = vbslq_u16(need_fallback, fallback, current);
+
+            if(vmaxvq_u16(veorq_u16(updated, current)) != 0)
+            {
+                vst1q_u8(row + (prog * 2), vreinterpretq_u8_u16(updated));
+                NoteChange(changed, (bank * 256) + (prog * 2), 16);
+            }
+        }
+    }
+}
+#endif
+
+/*
+** Fills empty cells of the tone table in place with capital tone
+** fallbacks following plan, using the widest vector unit available.
+** changed, if not NULL, receives a range covering every byte that was
+** modified (zero length if none).
+*/
+static void FillToneTable(uint8_t *tone_table, const SC55TonePlan *plan, SC55ROMRange *changed)
+{
+    SC55ROMRange tone_changes = {0, 0};
+
+#if defined(SC55_HAVE_AVX2)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        FillToneTableAVX2(tone_table, plan, &tone_changes);
+    }
+    else
+#endif
+#if defined(SC55_HAVE_SSE2)
+    FillToneTableSSE2(tone_table, plan, &tone_changes);
+#elif defined(SC55_HAVE_NEON)
+    FillToneTableNEON(tone_table, plan, &tone_changes);
+#else
+    FillToneTablePortable(tone_table, plan, &tone_changes);
+#endif
+
+    if(changed)
+    {
+        *changed = tone_changes;
+    }
+}
+
+/* Replaces 0xff bytes with the first byte of their group, which leaves a group led by 0xff as it is */
+static void FillGroups(uint8_t *data, const size_t length, const size_t group_size, SC55ROMRange *changed)
+{
+    size_t i;
+    uint8_t group_value = 0;
+
+    for(i = 0; i < length; i++)
+    {
+        if(i % group_size == 0)
+        {
+            group_value = data[i];
+        }
+
+        if(data[i] == 0xff && group_value != 0xff)
+        {
+            data[i] = group_value;
+            NoteChange(changed, i, 1);
+        }
+    }
+}
+
+/* Only write bytes that differ, so a mapped image keeps its untouched pages shared */
+static void CopyPatchBytes(uint8_t *data, const uint8_t *source, const size_t length, SC55ROMRange *changed)
+{
+    size_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        if(data[i] != source[i])
+        {
+            data[i] = source[i];
+            NoteChange(changed, i, 1);
+        }
+    }
+}
+
+/*
+** Runs a compiled patch program over its regions, in place.  Every op
+** only writes bytes whose value changes, and changed[region] is widened
+** to cover them, relative to the start of the region.  Ops on a NULL
+** region (the version bytes of an unknown ROM) are skipped.
+*/
+static void RunPatchProgram(const SC55PatchProgram *program, uint8_t *regions[SC55_PATCH_REGIONS], SC55ROMRange changed[SC55_PATCH_REGIONS])
+{
+    const SC55PatchOp *op;
+    SC55ROMRange op_changes;
+    uint8_t *data;
+    size_t i;
+
+    for(i = 0; i < SC55_PATCH_REGIONS; i++)
+    {
+        changed[i].offset = 0;
+        changed[i].length = 0;
+    }
+
+    for(i = 0; i < program->num_ops; i++)
+    {
+        op = &program->ops[i];
+        if(!regions[op->region])
+        {
+            continue;
+        }
+
+        data = regions[op->region] + op->offset;
+        op_changes.offset = 0;
+        op_changes.length = 0;
+
+        switch(op->op)
+        {
+            case SC55_PATCH_OP_FILL_TONES:
+                FillToneTable(data, &SC55_TONE_PLANS[op->arg], &op_changes);
+                break;
+            case SC55_PATCH_OP_FILL_GROUPS:
+                FillGroups(data, op->length, op->arg, &op_changes);
+                break;
+            default:
+                CopyPatchBytes(data, SC55_PATCH_BYTES + op->arg, op->length, &op_changes);
+                break;
+        }
+
+        if(op_changes.length > 0)
+        {
+            NoteChange(&changed[op->region], op->offset + op_changes.offset, op_changes.length);
+        }
+    }
+}
+
+/*
+** Counts the cells a patch program would change in the unpatched
+** tables, splitting tone fills by the rule that supplies them.  This is
+** a separate scalar pass over the same ops so the fill kernels stay
+** free of bookkeeping; it only runs for ROMs that collect stats.
+*/
+static void CountFills(const SC55PatchProgram *program, const uint8_t *tone_table, const uint8_t *drum_table, SC55ROMPatch *counts)
+{
+    const SC55PatchOp *op;
+    const SC55TonePlan *plan;
+    size_t bank, prog, i, j;
+    const uint8_t *row;
+    const uint8_t *group_row;
+    const uint8_t *data;
+    uint16_t current_tone, group_tone, capital_tone;
+    uint8_t group_value = 0;
+    unsigned use_group;
+
+    counts->sub_capital_fills = 0;
+    counts->capital_fills = 0;
+    counts->drum_fills = 0;
+
+    for(i = 0; i < program->num_ops; i++)
+    {
+        op = &program->ops[i];
+        if(op->op == SC55_PATCH_OP_FILL_TONES)
+        {
+            plan = &SC55_TONE_PLANS[op->arg];
+            data = tone_table + op->offset;
+
+            for(bank = 0; bank < SC55_TONE_MAP_BANKS; bank++)
+            {
+                row = data + (bank * 256);
+                group_row = data + ((bank & 0x78) * 256);
+
+                for(prog = 0; prog < 128; prog++)
+                {
+                    current_tone = (uint16_t)((row[prog * 2] << 8) | row[(prog * 2) + 1]);
+                    if(!SC55_PLAN_BITS(SC55_TONE_FILL, prog, 1) || (current_tone != 0xffff && !SC55_PLAN_BITS(plan->force[bank], prog, 1)))
+                    {
+                        continue;
+                    }
+
+                    group_tone = (uint16_t)((group_row[prog * 2] << 8) | group_row[(prog * 2) + 1]);
+                    capital_tone = (uint16_t)((data[prog * 2] << 8) | data[(prog * 2) + 1]);
+                    use_group = SC55_PLAN_BITS(plan->use_group[bank], prog, 1) & (group_tone != 0xffff);
+
+                    if(use_group && group_tone != current_tone)
+                    {
+                        counts->sub_capital_fills++;
+                    }
+                    else if(!use_group && capital_tone != current_tone)
+                    {
+                        counts->capital_fills++;
+                    }
+                }
+            }
+        }
+        else if(op->op == SC55_PATCH_OP_FILL_GROUPS && op->region == SC55_PATCH_REGION_DRUMS)
+        {
+            data = drum_table + op->offset;
+            for(j = 0; j < op->length; j++)
+            {
+                if(j % op->arg == 0)
+                {
+                    group_value = data[j];
+                }
+
+                if(data[j] == 0xff && group_value != 0xff)
+                {
+                    counts->drum_fills++;
+                }
+            }
+        }
+    }
+}
+
+/* Points regions at the tone table, drum table and patched version bytes of the ROM itself */
+static void GetROMPatchRegions(const SC55ROMData *rom, uint8_t *regions[SC55_PATCH_REGIONS])
+{
+    regions[SC55_PATCH_REGION_TONES] = rom->tone_table;
+    regions[SC55_PATCH_REGION_DRUMS] = rom->drum_table;
+    regions[SC55_PATCH_REGION_VERSION] = PatchedVersionAddress(rom);
+}
+
+/* Only write bytes that changed, so a mapped image keeps its untouched pages shared */
+static void CopyChangedBytes(SC55ROMData *rom, uint8_t *destination, const uint8_t *source, const size_t length)
+{
+    size_t i;
+    size_t dirty_start = 1;
+    size_t dirty_end = 0;
+
+    for(i = 0; i < length; i++)
+    {
+        if(destination[i] != source[i])
+        {
+            destination[i] = source[i];
+            if(dirty_start > dirty_end)
+            {
+                dirty_start = i;
+            }
+            dirty_end = i;
+        }
+    }
+
+    if(dirty_start <= dirty_end)
+    {
+        MarkROMDirty(rom, (size_t)(destination - rom->rom_data) + dirty_start, dirty_end - dirty_start + 1);
+    }
+}
+
+/* BuildROMPatches without the checks, for a ROM the caller knows it can patch */
+static void FillROMPatches(const SC55ROMData *rom, SC55ROMPatch *patches, const size_t num_patches)
+{
+    const SC55PatchProgram *program;
+    uint8_t *regions[SC55_PATCH_REGIONS];
+    SC55ROMRange changed[SC55_PATCH_REGIONS];
+    const uint8_t *version_address = PatchedVersionAddress(rom);
+    size_t i;
+    uint64_t start;
+
+    for(i = 0; i < num_patches; i++)
+    {
+        if(rom->stats)
+        {
+            program = GetPatchProgram(rom, patches[i].compat_mode, patches[i].drum_compat_mode, patches[i].update_version);
+            CountFills(program, rom->tone_table, rom->drum_table, &patches[i]);
+        }
+        else
+        {
+            patches[i].sub_capital_fills = 0;
+            patches[i].capital_fills = 0;
+            patches[i].drum_fills = 0;
+        }
+    }
+
+    start = SC55_STATS_START(rom->stats);
+    for(i = 0; i < num_patches; i++)
+    {
+        memcpy(patches[i].tone_table, rom->tone_table, SC55_TONE_TABLE_SIZE);
+        memcpy(patches[i].drum_table, rom->drum_table, SC55_DRUM_PATCH_SIZE);
+        regions[SC55_PATCH_REGION_TONES] = patches[i].tone_table;
+        regions[SC55_PATCH_REGION_DRUMS] = patches[i].drum_table;
+        regions[SC55_PATCH_REGION_VERSION] = NULL;
+        if(version_address)
+        {
+            memcpy(patches[i].version_bytes, version_address, 2);
+            regions[SC55_PATCH_REGION_VERSION] = patches[i].version_bytes;
+        }
+
+        program = GetPatchProgram(rom, patches[i].compat_mode, patches[i].drum_compat_mode, patches[i].update_version);
+        RunPatchProgram(program, regions, changed);
+    }
+    SC55_STATS_STOP(rom->stats, patch_ns, start);
+}
+
+/*
+** Builds the patched tone table, drum table and version bytes for each
+** requested variant without modifying the ROM.  The caller fills in
+** compat_mode, drum_compat_mode and update_version of every patch.
+** Patches are relative to the ROM as loaded, so it must not have been
+** patched yet.  A ROM parsed with lazy_identify must have been
+** identified with IdentifyROMData first, or this returns 1.
+*/
+int BuildROMPatches(const SC55ROMData *rom, SC55ROMPatch *patches, const size_t num_patches)
+{
+    if(!rom || !rom->rom_data || rom->identify_state != SC55_IDENTIFY_DONE || !patches)
+    {
+        return 1;
+    }
+
+    FillROMPatches(rom, patches, num_patches);
+    return 0;
+}
+
+/*
+** Writes a patch built by BuildROMPatches into the ROM.  Patches built
+** from the same ROM can be applied one after another; each one leaves
+** the image exactly as PatchROM would have on the unpatched ROM, and the
+** dirty ranges cover everything that differs from the original.
+*/
+int ApplyROMPatch(SC55ROMData *rom, const SC55ROMPatch *patch)
+{
+    uint64_t start;
+
+    if(!rom || !rom->rom_data || !patch || IdentifyROMForPatch(rom, patch->update_version) != 0)
+    {
+        return 1;
+    }
+
+    start = SC55_STATS_START(rom->stats);
+    CopyChangedBytes(rom, rom->tone_table, patch->tone_table, SC55_TONE_TABLE_SIZE);
+    CopyChangedBytes(rom, rom->drum_table, patch->drum_table, SC55_DRUM_PATCH_SIZE);
+
+    if(rom->is_known_rom)
+    {
+        CopyChangedBytes(rom, PatchedVersionAddress(rom), patch->version_bytes, 2);
+    }
+
+    SC55_STATS_STOP(rom->stats, patch_ns, start);
+    SC55_STATS_ADD(rom->stats, sub_capital_fills, patch->sub_capital_fills);
+    SC55_STATS_ADD(rom->stats, capital_fills, patch->capital_fills);
+    SC55_STATS_ADD(rom->stats, drum_fills, patch->drum_fills);
+
+    return 0;
+}
+
+int PatchROM(SC55ROMData *rom, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version)
+{
+    const SC55PatchProgram *program;
+    uint8_t *regions[SC55_PATCH_REGIONS];
+    SC55ROMRange changed[SC55_PATCH_REGIONS];
+    SC55ROMPatch counts;
+    uint64_t start;
+    size_t i;
+
+    if(!rom || !rom->rom_data || IdentifyROMForPatch(rom, update_version) != 0)
+    {
+        return 1;
+    }
+
+    program = GetPatchProgram(rom, compat_mode, drum_compat_mode, update_version);
+    GetROMPatchRegions(rom, regions);
+
+    /* Counted before the tables change, and kept out of the patch time */
+    if(rom->stats)
+    {
+        CountFills(program, rom->tone_table, rom->drum_table, &counts);
+        rom->stats->sub_capital_fills += counts.sub_capital_fills;
+        rom->stats->capital_fills += counts.capital_fills;
+        rom->stats->drum_fills += counts.drum_fills;
+    }
+
+    start = SC55_STATS_START(rom->stats);
+    RunPatchProgram(program, regions, changed);
+    for(i = 0; i < SC55_PATCH_REGIONS; i++)
+    {
+        if(regions[i])
+        {
+            MarkROMDirty(rom, (size_t)(regions[i] - rom->rom_data) + changed[i].offset, changed[i].length);
+        }
+    }
+    SC55_STATS_STOP(rom->stats, patch_ns, start);
+
+    return 0;
+}
+
+/* Appends an entry for each byte of patched that differs from the ROM at rom_offset; with entries NULL only counts */
+static size_t JournalRegion(SC55JournalEntry *entries, const SC55ROMData *rom, const uint8_t *patched, const size_t rom_offset, const size_t length)
+{
+    size_t num_entries = 0;
+    size_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        if(rom->rom_data[rom_offset + i] != patched[i])
+        {
+            if(entries)
+            {
+                entries[num_entries].offset = (uint32_t)(rom_offset + i);
+                entries[num_entries].old_value = rom->rom_data[rom_offset + i];
+                entries[num_entries].new_value = patched[i];
+            }
+            num_entries++;
+        }
+    }
+
+    return num_entries;
+}
+
+static void WriteJournalByte(SC55ROMData *rom, const size_t offset, const uint8_t value)
+{
+    if(rom->rom_data[offset] != value)
+    {
+        rom->rom_data[offset] = value;
+        MarkROMDirty(rom, offset, 1);
+    }
+}
+
+/* BuildPatchJournal without the checks, for a ROM the caller knows it can patch */
+static int RecordPatchJournal(const SC55ROMData *rom, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version, SC55PatchJournal *journal)
+{
+    SC55ROMPatch *patch;
+    const uint8_t *region_data[3];
+    size_t region_offset[3];
+    size_t region_length[3];
+    size_t num_regions = 2;
+    size_t order[3] = {0, 1, 2};
+    size_t num_entries = 0;
+    size_t i, j, swap;
+
+    journal->compat_mode = compat_mode;
+    journal->drum_compat_mode = drum_compat_mode;
+    journal->update_version = update_version;
+    journal->entries = NULL;
+    journal->num_entries = 0;
+
+    patch = (SC55ROMPatch*)SC55_MALLOC(sizeof(SC55ROMPatch));
+    if(!patch)
+    {
+        return 1;
+    }
+
+    patch->compat_mode = compat_mode;
+    patch->drum_compat_mode = drum_compat_mode;
+    patch->update_version = update_version;
+    FillROMPatches(rom, patch, 1);
+
+    region_data[0] = patch->tone_table;
+    region_offset[0] = (size_t)(rom->tone_table - rom->rom_data);
+    region_length[0] = SC55_TONE_TABLE_SIZE;
+    region_data[1] = patch->drum_table;
+    region_offset[1] = (size_t)(rom->drum_table - rom->rom_data);
+    region_length[1] = SC55_DRUM_PATCH_SIZE;
+    if(rom->is_known_rom)
+    {
+        region_data[2] = patch->version_bytes;
+        region_offset[2] = (size_t)(PatchedVersionAddress(rom) - rom->rom_data);
+        region_length[2] = 2;
+        num_regions = 3;
+    }
+
+    /* Visit the regions in ROM order so the entries come out sorted */
+    for(i = 1; i < num_regions; i++)
+    {
+        for(j = i; j > 0 && region_offset[order[j]] < region_offset[order[j - 1]]; j--)
+        {
+            swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    for(i = 0; i < num_regions; i++)
+    {
+        num_entries += JournalRegion(NULL, rom, region_data[order[i]], region_offset[order[i]], region_length[order[i]]);
+    }
+
+    journal->entries = (SC55JournalEntry*)SC55_MALLOC((num_entries ? num_entries : 1) * sizeof(SC55JournalEntry));
+    if(!journal->entries)
+    {
+        SC55_FREE(patch);
+        return 1;
+    }
+
+    for(i = 0; i < num_regions; i++)
+    {
+        journal->num_entries += JournalRegion(journal->entries + journal->num_entries, rom, region_data[order[i]], region_offset[order[i]], region_length[order[i]]);
+    }
+
+    SC55_FREE(patch);
+    return 0;
+}
+
+/*
+** Records every byte that patching the ROM in the given modes would
+** change, with its current and patched values, without modifying the
+** ROM.  Like BuildROMPatches, this must be called on an unpatched (or
+** fully reverted) ROM, and a ROM parsed with lazy_identify must have
+** been identified with IdentifyROMData first.  The entries are allocated
+** and sorted by offset; release them with FreePatchJournal.  Returns 0
+** on success.
+*/
+int BuildPatchJournal(const SC55ROMData *rom, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version, SC55PatchJournal *journal)
+{
+    if(!rom || !rom->rom_data || rom->identify_state != SC55_IDENTIFY_DONE || !journal)
+    {
+        return 1;
+    }
+
+    return RecordPatchJournal(rom, compat_mode, drum_compat_mode, update_version, journal);
+}
+
+void FreePatchJournal(SC55PatchJournal *journal)
+{
+    if(!journal)
+    {
+        return;
+    }
+
+    SC55_FREE(journal->entries);
+    journal->entries = NULL;
+    journal->num_entries = 0;
+}
+
+static int JournalFitsROM(const SC55ROMData *rom, const SC55PatchJournal *journal)
+{
+    return journal->num_entries == 0 || journal->entries[journal->num_entries - 1].offset < rom->rom_size;
+}
+
+int ApplyPatchJournal(SC55ROMData *rom, const SC55PatchJournal *journal)
+{
+    size_t i;
+
+    if(!rom || !rom->rom_data || !journal || !JournalFitsROM(rom, journal) || IdentifyROMForPatch(rom, journal->update_version) != 0)
+    {
+        return 1;
+    }
+
+    for(i = 0; i < journal->num_entries; i++)
+    {
+        WriteJournalByte(rom, journal->entries[i].offset, journal->entries[i].new_value);
+    }
+
+    return 0;
+}
+
+int RevertPatchJournal(SC55ROMData *rom, const SC55PatchJournal *journal)
+{
+    size_t i;
+
+    if(!rom || !rom->rom_data || !journal || !JournalFitsROM(rom, journal) || IdentifyROMForPatch(rom, journal->update_version) != 0)
+    {
+        return 1;
+    }
+
+    for(i = 0; i < journal->num_entries; i++)
+    {
+        WriteJournalByte(rom, journal->entries[i].offset, journal->entries[i].old_value);
+    }
+
+    return 0;
+}
+
+/*
+** Moves a ROM patched with from_journal to the state to_journal
+** describes.  Both journals must have been built from the same
+** unpatched ROM.  The sorted entries are walked together, and only
+** bytes whose value differs between the two modes are written.
+*/
+int SwitchPatchJournal(SC55ROMData *rom, const SC55PatchJournal *from_journal, const SC55PatchJournal *to_journal)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    if(!rom || !rom->rom_data || !from_journal || !to_journal || !JournalFitsROM(rom, from_journal) || !JournalFitsROM(rom, to_journal) || IdentifyROMForPatch(rom, from_journal->update_version || to_journal->update_version) != 0)
+    {
+        return 1;
+    }
+
+    while(i < from_journal->num_entries || j < to_journal->num_entries)
+    {
+        if(j == to_journal->num_entries || (i < from_journal->num_entries && from_journal->entries[i].offset < to_journal->entries[j].offset))
+        {
+            /* Only the old mode changed this byte, so put the original back */
+            WriteJournalByte(rom, from_journal->entries[i].offset, from_journal->entries[i].old_value);
+            i++;
+        }
+        else
+        {
+            if(i < from_journal->num_entries && from_journal->entries[i].offset == to_journal->entries[j].offset)
+            {
+                i++;
+            }
+            WriteJournalByte(rom, to_journal->entries[j].offset, to_journal->entries[j].new_value);
+            j++;
+        }
+    }
+
+    return 0;
+}
+
+/* Patches the ROM like PatchROM and, if journal is not NULL, records what changed in it */
+int PatchROMWithJournal(SC55ROMData *rom, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version, SC55PatchJournal *journal)
+{
+    if(!journal)
+    {
+        return PatchROM(rom, compat_mode, drum_compat_mode, update_version);
+    }
+
+    /* BuildPatchJournal only takes an identified ROM, but a lazily parsed one may not need identifying */
+    if(!rom || !rom->rom_data || IdentifyROMForPatch(rom, update_version) != 0 || RecordPatchJournal(rom, compat_mode, drum_compat_mode, update_version, journal) != 0)
+    {
+        return 1;
+    }
+
+    return ApplyPatchJournal(rom, journal);
+}
+
+/*
+** Patches rom_size bytes of ROM data from a read-only source into a
+** caller-provided destination of the same size, which may be the source
+** itself.  The source is identified first, so a rejected ROM leaves the
+** destination untouched.  Nothing is allocated or freed.  Returns 0 on
+** success.
+*/
+int PatchROMBuffer(const uint8_t *source_rom_data, uint8_t *destination_rom_data, const size_t rom_size, const SC55ReadOptions *options, const uint8_t compat_mode, const uint8_t drum_compat_mode, const uint8_t update_version)
+{
+    SC55ROMData rom;
+
+    if(!source_rom_data || !destination_rom_data || !options)
+    {
+        return 1;
+    }
+
+    /* Parsing only reads the data, so the source can be viewed through a non-const pointer */
+    rom = ParseROMWithSHA256((uint8_t*)source_rom_data, rom_size, options, NULL, SC55_ROM_STORAGE_BORROWED);
+    if(rom.rom_data == NULL || IdentifyROMData(&rom) != 0)
+    {
+        return 1;
+    }
+
+    if(destination_rom_data != source_rom_data)
+    {
+        memcpy(destination_rom_data, source_rom_data, rom_size);
+
+        rom.rom_data = destination_rom_data;
+        rom.early_rom_data = destination_rom_data;
+        rom.tone_table = destination_rom_data + (rom.tone_table - source_rom_data);
+        rom.drum_table = destination_rom_data + (rom.drum_table - source_rom_data);
+        rom.late_rom_data = destination_rom_data + (rom.late_rom_data - source_rom_data);
+        if(rom.rom_version_address)
+        {
+            rom.rom_version_address = destination_rom_data + (rom.rom_version_address - source_rom_data);
+        }
+    }
+
+    return PatchROM(&rom, compat_mode, drum_compat_mode, update_version);
+}
+
+/*
+** Patch cache entries are a fixed header followed by a list of runs,
+** each a 32-bit ROM offset, a 16-bit length and that many patched bytes.
+** Integers are little-endian.  The header holds the cache key and a
+** SHA-256 of the runs, so a damaged or mismatched entry is rejected.
+*/
+#define SC55_PATCH_CACHE_MAGIC "CTFPATCH"
+#define SC55_PATCH_CACHE_FORMAT 1
+#define SC55_PATCH_CACHE_HEADER_SIZE 80
+#define SC55_PATCH_CACHE_RUN_HEADER_SIZE 6
+#define SC55_PATCH_CACHE_MAX_RUN 0xffff
+/* Runs closer than this are merged, since a new run costs more than the bytes between them */
+#define SC55_PATCH_CACHE_RUN_GAP SC55_PATCH_CACHE_RUN_HEADER_SIZE
+
+/* Appends runs for every byte that differs between original and patched; returns the bytes needed */
+static size_t EncodePatchRuns(uint8_t *out, const size_t rom_offset, const uint8_t *original, const uint8_t *patched, const size_t length)
+{
+    size_t encoded = 0;
+    size_t run_start;
+    size_t run_end;
+    size_t gap;
+    size_t i = 0;
+
+    while(i < length)
+    {
+        if(original[i] == patched[i])
+        {
+            i++;
+            continue;
+        }
+
+        run_start = i;
+        run_end = i + 1;
+        for(i = run_end; i < length && i - run_start < SC55_PATCH_CACHE_MAX_RUN; i++)
+        {
+            if(original[i] != patched[i])
+            {
+                run_end = i + 1;
+            }
+            else
+            {
+                gap = i - run_end + 1;
+                if(gap > SC55_PATCH_CACHE_RUN_GAP)
+                {
+                    break;
+                }
+            }
+        }
+        i = run_end;
+
+        if(out)
+        {
+            StoreLE32(out + encoded, (uint32_t)(rom_offset + run_start));
+            out[encoded + 4] = (uint8_t)((run_end - run_start) & 0xff);
+            out[encoded + 5] = (uint8_t)((run_end - run_start) >> 8);
+            memcpy(out + encoded + SC55_PATCH_CACHE_RUN_HEADER_SIZE, patched + run_start, run_end - run_start);
+        }
+        encoded += SC55_PATCH_CACHE_RUN_HEADER_SIZE + (run_end - run_start);
+    }
+
+    return encoded;
+}
+
+static void PatchCacheHeader(uint8_t *header, const SC55ROMData *rom, const SC55ROMPatch *patch)
+{
+    memcpy(header, SC55_PATCH_CACHE_MAGIC, 8);
+    header[8] = SC55_PATCH_CACHE_FORMAT;
+    header[9] = patch->compat_mode;
+    header[10] = patch->drum_compat_mode;
+    header[11] = patch->update_version;
+    memcpy(header + 16, rom->rom_sha256, 32);
+}
+
+/*
+** Stores the difference between an unpatched ROM and a patch built from
+** it in cache_path.  The entry is written to a temporary file first and
+** renamed into place, so readers never see a partial entry.  The entry
+** is keyed by the ROM's SHA-256, so a ROM parsed with lazy_identify must
+** have been identified with IdentifyROMData first, or this returns 1.
+*/
+int SaveROMPatch(const SC55ROMData *rom, const SC55ROMPatch *patch, const char *cache_path)
+{
+    uint8_t *entry;
+    char *temp_path;
+    size_t payload_size;
+    size_t tone_offset;
+    size_t drum_offset;
+    size_t version_offset = 0;
+    FILE *fp;
+    int result = 1;
+
+    if(!rom || !rom->rom_data || rom->identify_state != SC55_IDENTIFY_DONE || !patch || !cache_path)
+    {
+        return 1;
+    }
+
+    tone_offset = (size_t)(rom->tone_table - rom->rom_data);
+    drum_offset = (size_t)(rom->drum_table - rom->rom_data);
+
+    payload_size = EncodePatchRuns(NULL, tone_offset, rom->tone_table, patch->tone_table, SC55_TONE_TABLE_SIZE);
+    payload_size += EncodePatchRuns(NULL, drum_offset, rom->drum_table, patch->drum_table, SC55_DRUM_PATCH_SIZE);
+    if(rom->is_known_rom)
+    {
+        version_offset = (size_t)(PatchedVersionAddress(rom) - rom->rom_data);
+        payload_size += EncodePatchRuns(NULL, version_offset, PatchedVersionAddress(rom), patch->version_bytes, 2);
+    }
+
+    entry = (uint8_t*)SC55_CALLOC(1, SC55_PATCH_CACHE_HEADER_SIZE + payload_size);
+    temp_path = (char*)SC55_MALLOC(strlen(cache_path) + 16);
+    if(!entry || !temp_path)
+    {
+        SC55_FREE(entry);
+        SC55_FREE(temp_path);
+        return 1;
+    }
+
+    PatchCacheHeader(entry, rom, patch);
+    StoreLE32(entry + 12, (uint32_t)payload_size);
+
+    payload_size = EncodePatchRuns(entry + SC55_PATCH_CACHE_HEADER_SIZE, tone_offset, rom->tone_table, patch->tone_table, SC55_TONE_TABLE_SIZE);
+    payload_size += EncodePatchRuns(entry + SC55_PATCH_CACHE_HEADER_SIZE + payload_size, drum_offset, rom->drum_table, patch->drum_table, SC55_DRUM_PATCH_SIZE);
+    if(rom->is_known_rom)
+    {
+        payload_size += EncodePatchRuns(entry + SC55_PATCH_CACHE_HEADER_SIZE + payload_size, version_offset, PatchedVersionAddress(rom), patch->version_bytes, 2);
+    }
+
+    lonesha256(entry + 48, entry + SC55_PATCH_CACHE_HEADER_SIZE, payload_size);
+
+#ifdef SC55_HAVE_MMAP
+    {
+        int fd;
+
+        sprintf(temp_path, "%s.XXXXXX", cache_path);
+        fd = mkstemp(temp_path);
+        fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if(fd >= 0 && !fp)
+        {
+            close(fd);
+            remove(temp_path);
+        }
+    }
+#else
+    sprintf(temp_path, "%s.tmp", cache_path);
+    fp = fopen(temp_path, "wb");
+#endif
+
+    if(fp)
+    {
+        if(fwrite(entry, 1, SC55_PATCH_CACHE_HEADER_SIZE + payload_size, fp) == SC55_PATCH_CACHE_HEADER_SIZE + payload_size)
+        {
+            result = 0;
+        }
+
+        if(fclose(fp) != 0)
+        {
+            result = 1;
+        }
+
+        if(result == 0 && rename(temp_path, cache_path) != 0)
+        {
+            result = 1;
+        }
+
+        if(result != 0)
+        {
+            remove(temp_path);
+        }
+    }
+
+    SC55_FREE(temp_path);
+    SC55_FREE(entry);
+    return result;
+}
+
+/* Returns the patch buffer a run at rom_offset belongs to, or NULL if it strays outside the patched tables */
+static uint8_t *PatchRunTarget(const SC55ROMData *rom, SC55ROMPatch *patch, const size_t rom_offset, const size_t length)
+{
+    size_t tone_offset = (size_t)(rom->tone_table - rom->rom_data);
+    size_t drum_offset = (size_t)(rom->drum_table - rom->rom_data);
+    size_t version_offset;
+
+    if(rom_offset >= tone_offset && rom_offset + length <= tone_offset + SC55_TONE_TABLE_SIZE)
+    {
+        return patch->tone_table + (rom_offset - tone_offset);
+    }
+
+    if(rom_offset >= drum_offset && rom_offset + length <= drum_offset + SC55_DRUM_PATCH_SIZE)
+    {
+        return patch->drum_table + (rom_offset - drum_offset);
+    }
+
+    if(rom->is_known_rom)
+    {
+        version_offset = (size_t)(PatchedVersionAddress(rom) - rom->rom_data);
+        if(rom_offset >= version_offset && rom_offset + length <= version_offset + 2)
+        {
+            return patch->version_bytes + (rom_offset - version_offset);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+** Fills patch from the cache entry at cache_path.  The caller sets
+** compat_mode, drum_compat_mode and update_version, which together with
+** the ROM's SHA-256 must match the entry.  As with BuildROMPatches, the
+** ROM must not have been patched yet, and a ROM parsed with
+** lazy_identify must have been identified with IdentifyROMData first;
+** otherwise this always misses.  Returns 0 on a verified hit and
+** non-zero if the entry is missing, stale or damaged, in which case the
+** caller should build the patch normally.
+*/
+int LoadROMPatch(const SC55ROMData *rom, SC55ROMPatch *patch, const char *cache_path)
+{
+    uint8_t header[SC55_PATCH_CACHE_HEADER_SIZE];
+    uint8_t expected_header[SC55_PATCH_CACHE_HEADER_SIZE];
+    uint8_t payload_sha256[32];
+    uint8_t *payload;
+    uint8_t *target;
+    size_t payload_size;
+    size_t run_length;
+    size_t i;
+    FILE *fp;
+    int result = 0;
+
+    if(!rom || !rom->rom_data || rom->identify_state != SC55_IDENTIFY_DONE || !patch || !cache_path)
+    {
+        return 1;
+    }
+
+    fp = fopen(cache_path, "rb");
+    if(!fp)
+    {
+        return 1;
+    }
+
+    memset(expected_header, 0, sizeof(expected_header));
+    PatchCacheHeader(expected_header, rom, patch);
+
+    if(fread(header, 1, SC55_PATCH_CACHE_HEADER_SIZE, fp) != SC55_PATCH_CACHE_HEADER_SIZE || memcmp(header, expected_header, 12) != 0 || memcmp(header + 16, expected_header + 16, 32) != 0)
+    {
+        fclose(fp);
+        return 1;
+    }
+
+    /* No valid entry holds more than every table byte plus a run header per byte */
+    payload_size = LoadLE32(header + 12);
+    if(payload_size > (SC55_TONE_TABLE_SIZE + SC55_DRUM_PATCH_SIZE + 2) * (SC55_PATCH_CACHE_RUN_HEADER_SIZE + 1))
+    {
+        fclose(fp);
+        return 1;
+    }
+
+    payload = (uint8_t*)SC55_MALLOC(payload_size + 1);
+    if(!payload)
+    {
+        fclose(fp);
+        return 1;
+    }
+
+    /* Reading one byte past the payload catches trailing data */
+    if(fread(payload, 1, payload_size + 1, fp) != payload_size)
+    {
+        result = 1;
+    }
+    fclose(fp);
+
+    if(result == 0)
+    {
+        lonesha256(payload_sha256, payload, payload_size);
+        if(memcmp(payload_sha256, header + 48, 32) != 0)
+        {
+            result = 1;
+        }
+    }
+
+    /* Check every run before touching the patch, so a bad entry leaves it as it was */
+    for(i = 0; result == 0 && i < payload_size; i += SC55_PATCH_CACHE_RUN_HEADER_SIZE + run_length)
+    {
+        run_length = 0;
+        if(payload_size - i < SC55_PATCH_CACHE_RUN_HEADER_SIZE)
+        {
+            result = 1;
+            break;
+        }
+
+        run_length = (size_t)payload[i + 4] | ((size_t)payload[i + 5] << 8);
+        if(run_length == 0 || payload_size - i - SC55_PATCH_CACHE_RUN_HEADER_SIZE < run_length || !PatchRunTarget(rom, patch, LoadLE32(payload + i), run_length))
+        {
+            result = 1;
+        }
+    }
+
+    if(result == 0)
+    {
+        memcpy(patch->tone_table, rom->tone_table, SC55_TONE_TABLE_SIZE);
+        memcpy(patch->drum_table, rom->drum_table, SC55_DRUM_PATCH_SIZE);
+        if(rom->is_known_rom)
+        {
+            memcpy(patch->version_bytes, PatchedVersionAddress(rom), 2);
+        }
+
+        for(i = 0; i < payload_size; i += SC55_PATCH_CACHE_RUN_HEADER_SIZE + run_length)
+        {
+            run_length = (size_t)payload[i + 4] | ((size_t)payload[i + 5] << 8);
+            target = PatchRunTarget(rom, patch, LoadLE32(payload + i), run_length);
+            memcpy(target, payload + i + SC55_PATCH_CACHE_RUN_HEADER_SIZE, run_length);
+        }
+
+        if(rom->stats)
+        {
+            CountFills(GetPatchProgram(rom, patch->compat_mode, patch->drum_compat_mode, patch->update_version), rom->tone_table, rom->drum_table, patch);
+        }
+        else
+        {
+            patch->sub_capital_fills = 0;
+            patch->capital_fills = 0;
+            patch->drum_fills = 0;
+        }
+    }
+
+    SC55_FREE(payload);
+    return result;
+}
+
+int GetSHA256Backend(void)
+{
+    return lonesha256_select_backend();
+}
+
+uint8_t SHA256BackendAvailable(const int backend)
+{
+    return lonesha256_backend_available(backend) ? 1 : 0;
+}
+
+const char *GetSHA256BackendName(const int backend)
+{
+    return lonesha256_backend_name(backend);
+}
+
+/* Hashes data with the given backend, or the selected one if backend is negative; returns 0 on success */
+int ComputeSHA256(const int backend, const uint8_t *data, const size_t size, uint8_t sha256[32])
+{
+    if(!data || !sha256)
+    {
+        return 1;
+    }
+
+    if(backend < 0)
+    {
+        return lonesha256(sha256, data, size) == 0 ? 0 : 1;
+    }
+
+    return lonesha256_with_backend(backend, sha256, data, size) == 0 ? 0 : 1;
+}
+
+/* Returns how many equal-sized buffers ComputeSHA256Multi hashes at once by default, or 1 if it hashes them one by one */
+int GetSHA256Lanes(void)
+{
+    return lonesha256_multi_lanes();
+}
+
+uint8_t SHA256LanesAvailable(const int lanes)
+{
+    return lonesha256_multi_with_lanes(lanes, NULL, NULL, 0, 0) == 0 ? 1 : 0;
+}
+
+/*
+** Hashes count buffers of size bytes each into sha256, in groups of
+** lanes (1, 8 or 16) or of GetSHA256Lanes() if lanes is negative.
+** Returns 0 on success, or 1 if that many lanes are not available.
+*/
+int ComputeSHA256Multi(const int lanes, const uint8_t *const *data, const size_t count, const size_t size, uint8_t (*sha256)[32])
+{
+    size_t i;
+
+    if((!data || !sha256) && count > 0)
+    {
+        return 1;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(!data[i])
+        {
+            return 1;
+        }
+    }
+
+    if(lanes < 0)
+    {
+        return lonesha256_multi(sha256, data, count, size) == 0 ? 0 : 1;
+    }
+
+    return lonesha256_multi_with_lanes(lanes, sha256, data, count, size) == 0 ? 0 : 1;
 }
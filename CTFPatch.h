@@ -25,6 +25,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdio.h>
 
 #include "SC55Hashes.h"
 
@@ -38,6 +39,82 @@ extern "C" {
 #define SC55_VERIFY_SHA256_CHECKSUM 1
 #define SC55_SKIP_VERIFY_SHA256_CHECKSUM 2
 
+#define SC55_ROM_STORAGE_HEAP 0
+#define SC55_ROM_STORAGE_MAPPED 1
+#define SC55_ROM_STORAGE_BORROWED 2
+#define SC55_ROM_STORAGE_POOLED 3
+
+#define SC55_IDENTIFY_DONE 0
+#define SC55_IDENTIFY_PENDING 1
+#define SC55_IDENTIFY_REJECTED 2
+#define SC55_IDENTIFY_SKIPPED 3
+
+#define SC55_PATCHED_DIGEST_UNKNOWN 0
+#define SC55_PATCHED_DIGEST_MATCH 1
+#define SC55_PATCHED_DIGEST_MISMATCH 2
+
+#define SC55_MAX_DIRTY_RANGES 4
+
+#define SC55_TONE_TABLE_SIZE 0x8000
+#define SC55_DRUM_PATCH_SIZE 0x40
+
+#define SC55_SHA256_BACKEND_PORTABLE 0
+#define SC55_SHA256_BACKEND_SHA_NI 1
+#define SC55_SHA256_BACKEND_AVX2 2
+#define SC55_SHA256_BACKEND_ARMV8 3
+#define SC55_SHA256_BACKEND_COUNT 4
+
+typedef struct
+{
+    size_t offset;
+    size_t length;
+} SC55ROMRange;
+
+/* The file a ROM was read from, as it was when the read started; size is 0 for a ROM not read from a file */
+typedef struct
+{
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t modified_ns;
+    int64_t changed_ns;
+} SC55ROMSource;
+
+/*
+** Counters and timings collected while a ROM is read, parsed, patched
+** and written, for callers that pass one in SC55ReadOptions.  Every
+** call adds to the fields, so one struct can cover several ROMs; zero
+** it with InitROMStats first.
+*/
+typedef struct
+{
+    uint64_t read_ns;
+    uint64_t hash_ns;
+    uint64_t identify_ns;
+    uint64_t patch_ns;
+    uint64_t write_ns;
+    uint64_t bytes_read;
+    uint64_t bytes_hashed;
+    /* WriteROMDelta only counts the ranges it writes over the clone */
+    uint64_t bytes_written;
+    /* Empty tone cells filled from the capital tone of their bank group */
+    uint32_t sub_capital_fills;
+    /* Empty tone cells filled from the bank 0 capital tone */
+    uint32_t capital_fills;
+    uint32_t drum_fills;
+    /* ROMs recognised by checksum, so 0 or 1 for a single ROM */
+    uint32_t identified;
+} SC55ROMStats;
+
+/* Reusable ROM buffers created with CreateBufferPool */
+typedef struct SC55BufferPool SC55BufferPool;
+
+/* An external hash database opened with OpenHashDatabase */
+typedef struct SC55HashDatabase SC55HashDatabase;
+
+/* A background identification started with StartROMIdentification */
+typedef struct SC55Identification SC55Identification;
+
 typedef struct
 {
     size_t rom_size;
@@ -50,163 +127,178 @@ typedef struct
     uint8_t is_known_rom;
     char *rom_name;
     uint8_t *rom_version_address;
+    /* Index of the table layout the ROM was parsed with */
+    uint8_t rom_model;
+    uint8_t rom_storage;
+    /* Where a pooled buffer goes back to in DestroyROM */
+    SC55BufferPool *buffer_pool;
+    SC55ROMRange dirty_ranges[SC55_MAX_DIRTY_RANGES];
+    size_t num_dirty_ranges;
+    /* Checked by WriteROMDelta before it clones the file instead of writing the image */
+    SC55ROMSource source;
+    SC55ROMStats *stats;
+    /*
+    ** SC55_IDENTIFY_PENDING after a lazy parse until IdentifyROMData has
+    ** filled in rom_sha256, is_known_rom, rom_name and rom_version_address,
+    ** or SC55_IDENTIFY_SKIPPED if the ROM was changed before that happened
+    */
+    uint8_t identify_state;
+    /* What a pending identification looks the ROM up with */
+    uint8_t ignore_sha256_failures;
+    const SC55HashDatabase *hash_database;
+    SC55Identification *identification;
 } SC55ROMData;
 
 typedef struct
 {
-    const uint8_t tone_id;
-    const char *tone_name;
-} SC55TonePair;
+    uint8_t compat_mode;
+    uint8_t drum_compat_mode;
+    uint8_t update_version;
+    uint8_t tone_table[SC55_TONE_TABLE_SIZE];
+    uint8_t drum_table[SC55_DRUM_PATCH_SIZE];
+    uint8_t version_bytes[2];
+    /* Cells the patch fills, counted only when the ROM collects stats */
+    uint32_t sub_capital_fills;
+    uint32_t capital_fills;
+    uint32_t drum_fills;
+} SC55ROMPatch;
+
+/* One byte changed by a patch, as an offset from the start of the ROM */
+typedef struct
+{
+    uint32_t offset;
+    uint8_t old_value;
+    uint8_t new_value;
+} SC55JournalEntry;
+
+/* Every byte a patch changes, sorted by offset; see BuildPatchJournal */
+typedef struct
+{
+    uint8_t compat_mode;
+    uint8_t drum_compat_mode;
+    uint8_t update_version;
+    SC55JournalEntry *entries;
+    size_t num_entries;
+} SC55PatchJournal;
+
+typedef struct
+{
+    uint8_t ignore_sha256_failures;
+    /* Map the file copy-on-write instead of reading it, as ReadROMMapped does */
+    uint8_t use_mmap;
+    /* Checked after the built-in hashes; must stay open while the ROM is in use */
+    const SC55HashDatabase *hash_database;
+    /* Receives timings and counters for the ROM, or NULL; see SC55ROMStats */
+    SC55ROMStats *stats;
+    /* Take read buffers from this pool instead of the heap; must outlive the ROM */
+    SC55BufferPool *buffer_pool;
+    /* Have ParseROM and ReadROMMapped leave hashing and identification until needed; see IdentifyROMData, which must be called before BuildROMPatches, BuildPatchJournal, SaveROMPatch or LoadROMPatch */
+    uint8_t lazy_identify;
+} SC55ReadOptions;
 
 typedef struct
 {
-    const size_t num_tones;
-    const SC55TonePair tones[11];
-} SC55ToneGroup;
-
-static const SC55ToneGroup SC55_TONES[128] = {
-    {3, {{0, "Piano 1"}, {126, "Piano 2"}, {127, "Acou Piano 1"}}},
-    {3, {{0, "Piano 2"}, {126, "Piano 2"}, {127, "Acou Piano 2"}}},
-    {3, {{0, "Piano 3"}, {126, "Piano 2"}, {127, "Acou Piano 3"}}},
-    {3, {{0, "Honky-tonk"}, {126, "Honky-tonk"}, {127, "Elec Piano 1"}}},
-    {4, {{0, "E.Piano 1"}, {8, "Detuned EP 1"}, {126, "Piano 1"}, {127, "Elec Piano 2"}}},
-    {4, {{0, "E.Piano 2"}, {8, "Detuned EP 2"}, {126, "Piano 2"}, {127, "Elec Piano 3"}}},
-    {4, {{0, "Harpsichord"}, {8, "Coupled Hps."}, {126, "Piano 2"}, {127, "Elec Piano 4"}}},
-    {3, {{0, "Clav."}, {126, "E.Piano 1"}, {127, "Honkytonk"}}},
-    {3, {{0, "Celesta"}, {126, "Detuned EP 1"}, {127, "Elec Org 1"}}},
-    {3, {{0, "Glockenspiel"}, {126, "E.Piano 2"}, {127, "Elec Org 2"}}},
-    {3, {{0, "Music Box"}, {126, "Steel-str.Gt"}, {127, "Elec Org 3"}}},
-    {3, {{0, "Vibraphone"}, {126, "Steel-str.Gt"}, {127, "Elec Org 4"}}},
-    {3, {{0, "Marimba"}, {126, "12-str.Gt"}, {127, "Pipe Org 1"}}},
-    {3, {{0, "Xylophone"}, {126, "Funk Gt."}, {127, "Pipe Org 2"}}},
-    {4, {{0, "Tubular-bell"}, {8, "Church Bell"}, {126, "Muted Gt."}, {127, "Pipe Org 3"}}},
-    {3, {{0, "Santur"}, {126, "Slap Bass 1"}, {127, "Accordion"}}},
-    {4, {{0, "Organ 1"}, {8, "Detuned Or.1"}, {126, "Slap Bass 1"}, {127, "Harpsi 1"}}},
-    {4, {{0, "Organ 2"}, {8, "Detuned Or.2"}, {126, "Slap Bass 1"}, {127, "Harpsi 2"}}},
-    {3, {{0, "Organ 3"}, {126, "Slap Bass 1"}, {127, "Harpsi 3"}}},
-    {4, {{0, "Church Org.1"}, {8, "Church Org.2"}, {126, "Slap Bass 2"}, {127, "Clavi 1"}}},
-    {3, {{0, "Reed Organ"}, {126, "Slap Bass 2"}, {127, "Clavi 2"}}},
-    {4, {{0, "Accordion Fr"}, {8, "Accordion It"}, {126, "Slap Bass 2"}, {127, "Clavi 3"}}},
-    {3, {{0, "Harmonica"}, {126, "Slap Bass 2"}, {127, "Celesta 1"}}},
-    {3, {{0, "Bandneon"}, {126, "Fingered Bs."}, {127, "Celesta 2"}}},
-    {4, {{0, "Nylon-str.Gt"}, {8, "Ukulele"}, {126, "Fingered Bs."}, {127, "Syn Brass 1"}}},
-    {5, {{0, "Steel-str.Gt"}, {8, "12-str.Gt"}, {16, "Mandolin"}, {126, "Picked Bs."}, {127, "Syn Brass 2"}}},
-    {4, {{0, "Jazz Gt."}, {8, "Hawaiian Gt."}, {126, "Picked Bs."}, {127, "Syn Brass 3"}}},
-    {4, {{0, "Clean Gt."}, {8, "Chorus Gt."}, {126, "Fretless Bs."}, {127, "Syn Brass 4"}}},
-    {4, {{0, "Muted Gt."}, {8, "Funk Gt."}, {126, "Acoustic Bs."}, {127, "Syn Bass 1"}}},
-    {3, {{0, "Overdrive Gt"}, {126, "Choir Aahs"}, {127, "Syn Bass 2"}}},
-    {4, {{0, "DistortionGt"}, {8, "Feedback Gt."}, {126, "Choir Aahs"}, {127, "Syn Bass 3"}}},
-    {4, {{0, "Gt.Harmonics"}, {8, "Gt. Feedback"}, {126, "Choir Aahs"}, {127, "Syn Bass 4"}}},
-    {3, {{0, "Acoustic Bs."}, {126, "Choir Aahs"}, {127, "Fantasy"}}},
-    {3, {{0, "Fingered Bs."}, {126, "Slow Strings"}, {127, "Harmo Pan"}}},
-    {3, {{0, "Picked Bs."}, {126, "Strings"}, {127, "Chorale"}}},
-    {3, {{0, "Fretless Bs."}, {126, "Syn.Strings3"}, {127, "Glasses"}}},
-    {3, {{0, "Slap Bass 1"}, {126, "Syn.Strings3"}, {127, "Soundtrack"}}},
-    {3, {{0, "Slap Bass 2"}, {126, "Organ 1"}, {127, "Atmosphere"}}},
-    {4, {{0, "Synth Bass 1"}, {8, "Synth Bass 3"}, {126, "Organ 1"}, {127, "Warm Bell"}}},
-    {4, {{0, "Synth Bass 2"}, {8, "Synth Bass 4"}, {126, "Organ 1"}, {127, "Funny Vox"}}},
-    {3, {{0, "Violin"}, {126, "Organ 2"}, {127, "Echo Bell"}}},
-    {3, {{0, "Viola"}, {126, "Organ 1"}, {127, "Ice Rain"}}},
-    {3, {{0, "Cello"}, {126, "Organ 1"}, {127, "Oboe 2001"}}},
-    {3, {{0, "Contrabass"}, {126, "Organ 2"}, {127, "Echo Pan"}}},
-    {3, {{0, "Tremolo Str"}, {126, "Organ 2"}, {127, "Doctor Solo"}}},
-    {3, {{0, "PizzicatoStr"}, {126, "Organ 2"}, {127, "School Daze"}}},
-    {3, {{0, "Harp"}, {126, "Trumpet"}, {127, "Bellsinger"}}},
-    {3, {{0, "Timpani"}, {126, "Trumpet"}, {127, "Square Wave"}}},
-    {4, {{0, "Strings"}, {8, "Orchestra"}, {126, "Trombone"}, {127, "Str Sect 1"}}},
-    {3, {{0, "Slow Strings"}, {126, "Trombone"}, {127, "Str Sect 2"}}},
-    {4, {{0, "Syn.Strings1"}, {8, "Syn.Strings3"}, {126, "Trombone"}, {127, "Str Sect 3"}}},
-    {3, {{0, "Syn.Strings2"}, {126, "Trombone"}, {127, "Pizzicato"}}},
-    {3, {{0, "Choir Aahs"}, {126, "Trombone"}, {127, "Violin 1"}}},
-    {3, {{0, "Voice Oohs"}, {126, "Trombone"}, {127, "Violin 2"}}},
-    {3, {{0, "SynVox"}, {126, "Alto Sax"}, {127, "Cello 1"}}},
-    {3, {{0, "OrchestraHit"}, {126, "Tenor Sax"}, {127, "Cello 2"}}},
-    {3, {{0, "Trumpet"}, {126, "Baritone Sax"}, {127, "Contrabass"}}},
-    {3, {{0, "Trombone"}, {126, "Alto Sax"}, {127, "Harp 1"}}},
-    {3, {{0, "Tuba"}, {126, "Brass 1"}, {127, "Harp 2"}}},
-    {3, {{0, "MutedTrumpet"}, {126, "Brass 1"}, {127, "Guitar 1"}}},
-    {3, {{0, "French Horn"}, {126, "Brass 2"}, {127, "Guitar 2"}}},
-    {4, {{0, "Brass 1"}, {8, "Brass 2"}, {126, "Brass 2"}, {127, "Elec Gtr 1"}}},
-    {4, {{0, "Synth Brass1"}, {8, "Synth Brass3"}, {126, "Brass 1"}, {127, "Elec Gtr 2"}}},
-    {4, {{0, "Synth Brass2"}, {8, "Synth Brass4"}, {126, "OrchestraHit"}, {127, "Sitar"}}},
-    {2, {{0, "Soprano Sax"}, {127, "Acou Bass 1"}}},
-    {2, {{0, "Alto Sax"}, {127, "Acou Bass 2"}}},
-    {2, {{0, "Tenor Sax"}, {127, "Elec Bass 1"}}},
-    {2, {{0, "Baritone Sax"}, {127, "Elec Bass 2"}}},
-    {2, {{0, "Oboe"}, {127, "Slap Bass 1"}}},
-    {2, {{0, "English Horn"}, {127, "Slap Bass 2"}}},
-    {2, {{0, "Bassoon"}, {127, "Fretless 1"}}},
-    {2, {{0, "Clarinet"}, {127, "Fretless 2"}}},
-    {2, {{0, "Piccolo"}, {127, "Flute 1"}}},
-    {2, {{0, "Flute"}, {127, "Flute 2"}}},
-    {2, {{0, "Recorder"}, {127, "Piccolo 1"}}},
-    {2, {{0, "Pan Flute"}, {127, "Piccolo 2"}}},
-    {2, {{0, "Bottle Blow"}, {127, "Recorder"}}},
-    {2, {{0, "Shakuhachi"}, {127, "Pan Pipes"}}},
-    {2, {{0, "Whistle"}, {127, "Sax 1"}}},
-    {2, {{0, "Ocarina"}, {127, "Sax 2"}}},
-    {3, {{0, "Square Wave"}, {8, "Sine Wave"}, {127, "Sax 3"}}},
-    {2, {{0, "Saw Wave"}, {127, "Sax 4"}}},
-    {2, {{0, "Syn.Calliope"}, {127, "Clarinet 1"}}},
-    {2, {{0, "Chiffer Lead"}, {127, "Clarinet 2"}}},
-    {2, {{0, "Charang"}, {127, "Oboe"}}},
-    {2, {{0, "Solo Vox"}, {127, "Engl Horn"}}},
-    {2, {{0, "5th Saw Wave"}, {127, "Bassoon"}}},
-    {2, {{0, "Bass & Lead"}, {127, "Harmonica"}}},
-    {2, {{0, "Fantasia"}, {127, "Trumpet 1"}}},
-    {2, {{0, "Warm Pad"}, {127, "Trumpet 2"}}},
-    {2, {{0, "Polysynth"}, {127, "Trombone 1"}}},
-    {2, {{0, "Space Voice"}, {127, "Trombone 2"}}},
-    {2, {{0, "Bowed Glass"}, {127, "Fr Horn 1"}}},
-    {2, {{0, "Metal Pad"}, {127, "Fr Horn 2"}}},
-    {2, {{0, "Halo Pad"}, {127, "Tuba"}}},
-    {2, {{0, "Sweep Pad"}, {127, "Brs Sect 1"}}},
-    {2, {{0, "Ice Rain"}, {127, "Brs Sect 2"}}},
-    {2, {{0, "Soundtrack"}, {127, "Vibe 1"}}},
-    {2, {{0, "Crystal"}, {127, "Vibe 2"}}},
-    {2, {{0, "Atmosphere"}, {127, "Syn Mallet"}}},
-    {2, {{0, "Brightness"}, {127, "Windbell"}}},
-    {2, {{0, "Goblin"}, {127, "Glock"}}},
-    {2, {{0, "Echo Drops"}, {127, "Tube Bell"}}},
-    {2, {{0, "Star Theme"}, {127, "Xylophone"}}},
-    {2, {{0, "Sitar"}, {127, "Marimba"}}},
-    {2, {{0, "Banjo"}, {127, "Koto"}}},
-    {2, {{0, "Shamisen"}, {127, "Sho"}}},
-    {3, {{0, "Koto"}, {8, "Taisho Koto"}, {127, "Shakuhachi"}}},
-    {2, {{0, "Kalimba"}, {127, "Whistle 1"}}},
-    {2, {{0, "Bag Pipe"}, {127, "Whistle 2"}}},
-    {2, {{0, "Fiddle"}, {127, "Bottleblow"}}},
-    {2, {{0, "Shanai"}, {127, "Breathpipe"}}},
-    {2, {{0, "Tinkle Bell"}, {127, "Timpani"}}},
-    {2, {{0, "Agogo"}, {127, "Melodic Tom"}}},
-    {2, {{0, "Steel Drums"}, {127, "Deep Snare"}}},
-    {3, {{0, "Woodblock"}, {8, "Castanets"}, {127, "Elec Perc 1"}}},
-    {3, {{0, "Taiko"}, {8, "Concert BD"}, {127, "Elec Perc 2"}}},
-    {3, {{0, "Melo. Tom 1"}, {8, "Melo. Tom 2"}, {127, "Taiko"}}},
-    {3, {{0, "Synth Drum"}, {8, "808 Tom"}, {127, "Taiko Rim"}}},
-    {2, {{0, "Reverse Cym."}, {127, "Cymbal"}}},
-    {4, {{0, "Gt.FretNoise"}, {1, "Gt.Cut Noise"}, {2, "String Slap"}, {127, "Castanets"}}},
-    {3, {{0, "Breath Noise"}, {1, "Fl.Key Click"}, {127, "Triangle"}}},
-    {7, {{0, "Seashore"}, {1, "Rain"}, {2, "Thunder"}, {3, "Wind"}, {4, "Stream"}, {5, "Bubble"}, {127, "Orche Hit"}}},
-    {4, {{0, "Bird"}, {1, "Dog"}, {2, "Horse-Gallop"}, {127, "Telephone"}}},
-    {7, {{0, "Telephone 1"}, {1, "Telephone 2"}, {2, "DoorCreaking"}, {3, "Door"}, {4, "Scratch"}, {5, "Windchime"}, {127, "Bird Tweet"}}},
-    {11,{{0, "Helicopter"}, {1, "Car-Engine"}, {2, "Car-Stop"}, {3, "Car-Pass"}, {4, "Car-Crash"}, {5, "Siren"}, {6, "Train"}, {7, "Jetplane"}, {8, "Starship"}, {9, "Burst Noise"}, {127, "One Note Jam"}}},
-    {7, {{0, "Applause"}, {1, "Laughing"}, {2, "Screaming"}, {3, "Punch"}, {4, "Heart Beat"}, {5, "Footsteps"}, {127, "Water Bell"}}},
-    {5, {{0, "Gun Shot"}, {1, "Machine Gun"}, {2, "Lasergun"}, {3, "Explosion"}, {127, "Jungle Tune"}}}
-};
+    size_t file_size;
+    const char *rom_name;
+    size_t version_address;
+} SC55ROMIdentity;
+
+void InitReadOptions(SC55ReadOptions *options);
+
+void InitROMStats(SC55ROMStats *stats);
 
 SC55ROMData ParseROM(uint8_t *rom_data, size_t rom_size, uint8_t ignore_sha256_failures);
 
+SC55ROMData ParseROMWithOptions(uint8_t *rom_data, size_t rom_size, const SC55ReadOptions *options);
+
+SC55ROMData ParseROMBorrowed(uint8_t *rom_data, size_t rom_size, const SC55ReadOptions *options);
+
+int PatchROMBuffer(const uint8_t *source_rom_data, uint8_t *destination_rom_data, size_t rom_size, const SC55ReadOptions *options, uint8_t compat_mode, uint8_t drum_compat_mode, uint8_t update_version);
+
 void DestroyROM(SC55ROMData *rom);
 
+int IdentifyROMData(SC55ROMData *rom);
+
+int StartROMIdentification(SC55ROMData *rom);
+
 SC55ROMData ReadROM(const char *rom_file_path, uint8_t ignore_sha256_failures);
 
+SC55ROMData ReadROMMapped(const char *rom_file_path, uint8_t ignore_sha256_failures);
+
+SC55ROMData ReadROMWithOptions(const char *rom_file_path, const SC55ReadOptions *options);
+
+SC55ROMData ReadROMStream(FILE *fp, const SC55ReadOptions *options);
+
 int WriteROM(const SC55ROMData *rom, const char *rom_file_path);
 
+int WriteROMStream(const SC55ROMData *rom, FILE *fp);
+
+int WriteROMDelta(const SC55ROMData *rom, const char *source_rom_path, const char *rom_file_path);
+
+int WriteROMWithDigest(const SC55ROMData *rom, const char *rom_file_path, uint8_t output_sha256[32]);
+
+int WriteROMStreamWithDigest(const SC55ROMData *rom, FILE *fp, uint8_t output_sha256[32]);
+
+int WriteROMDeltaWithDigest(const SC55ROMData *rom, const char *source_rom_path, const char *rom_file_path, uint8_t output_sha256[32]);
+
+int CheckPatchedDigest(const uint8_t rom_sha256[32], uint8_t compat_mode, uint8_t drum_compat_mode, uint8_t update_version, const uint8_t output_sha256[32]);
+
 SC55Hash IdentifyROM(const uint8_t rom_sha256[32], size_t rom_size);
 
+int IdentifyROMs(const SC55HashDatabase *hash_database, const uint8_t *const *rom_data, size_t num_roms, size_t rom_size, uint8_t (*rom_sha256)[32], SC55ROMIdentity *identities);
+
+uint8_t IsKnownROMSize(size_t rom_size, const SC55HashDatabase *hash_database);
+
+uint8_t LookupROM(const SC55HashDatabase *hash_database, const uint8_t rom_sha256[32], size_t rom_size, SC55ROMIdentity *identity);
+
+SC55HashDatabase *OpenHashDatabase(const char *database_path);
+
+void CloseHashDatabase(SC55HashDatabase *hash_database);
+
+SC55BufferPool *CreateBufferPool(size_t buffer_size, size_t max_free_buffers, uint8_t use_huge_pages);
+
+void DestroyBufferPool(SC55BufferPool *buffer_pool);
+
+int BuildHashDatabase(const char *listing_path, const char *database_path);
+
 int PatchROM(SC55ROMData *rom, uint8_t compat_mode, uint8_t drum_compat_mode, uint8_t update_version);
 
+int BuildROMPatches(const SC55ROMData *rom, SC55ROMPatch *patches, size_t num_patches);
+
+int ApplyROMPatch(SC55ROMData *rom, const SC55ROMPatch *patch);
+
+uint8_t *PatchedVersionAddress(const SC55ROMData *rom);
+
+int BuildPatchJournal(const SC55ROMData *rom, uint8_t compat_mode, uint8_t drum_compat_mode, uint8_t update_version, SC55PatchJournal *journal);
+
+void FreePatchJournal(SC55PatchJournal *journal);
+
+int ApplyPatchJournal(SC55ROMData *rom, const SC55PatchJournal *journal);
+
+int RevertPatchJournal(SC55ROMData *rom, const SC55PatchJournal *journal);
+
+int SwitchPatchJournal(SC55ROMData *rom, const SC55PatchJournal *from_journal, const SC55PatchJournal *to_journal);
+
+int PatchROMWithJournal(SC55ROMData *rom, uint8_t compat_mode, uint8_t drum_compat_mode, uint8_t update_version, SC55PatchJournal *journal);
+
+int SaveROMPatch(const SC55ROMData *rom, const SC55ROMPatch *patch, const char *cache_path);
+
+int LoadROMPatch(const SC55ROMData *rom, SC55ROMPatch *patch, const char *cache_path);
+
+int GetSHA256Backend(void);
+
+uint8_t SHA256BackendAvailable(int backend);
+
+const char *GetSHA256BackendName(int backend);
+
+int ComputeSHA256(int backend, const uint8_t *data, size_t size, uint8_t sha256[32]);
+
+int GetSHA256Lanes(void);
+
+uint8_t SHA256LanesAvailable(int lanes);
+
+int ComputeSHA256Multi(int lanes, const uint8_t *const *data, size_t count, size_t size, uint8_t (*sha256)[32]);
+
 #ifdef __cplusplus
 }
 #endif
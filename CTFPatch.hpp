@@ -0,0 +1,313 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_PATCH_HPP
+#define CTF_PATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
+#include <span>
+#include <utility>
+
+#include "CTFPatch.h"
+
+/*
+** A move-only C++20 owner for an SC55ROMData, for hosts that embed the
+** library.  The ROM is always parsed with ParseROMBorrowed, so the C
+** side never allocates or frees the image: either the caller keeps the
+** buffer (Borrow), or the wrapper takes it from a memory resource and
+** gives it back when the ROM is reset, moved over or destroyed (Copy and
+** Read).  A ROM that failed to parse is empty and converts to false.
+*/
+class SC55ROM
+{
+public:
+    /* Alignment of buffers taken from a memory resource */
+    static constexpr std::size_t BufferAlignment = 64;
+
+    SC55ROM() noexcept
+        : rom_(), resource_(nullptr), buffer_(nullptr), buffer_size_(0)
+    {
+    }
+
+    SC55ROM(const SC55ROM &) = delete;
+    SC55ROM &operator=(const SC55ROM &) = delete;
+
+    SC55ROM(SC55ROM &&other) noexcept
+        : rom_(other.rom_), resource_(other.resource_), buffer_(other.buffer_), buffer_size_(other.buffer_size_)
+    {
+        other.Release();
+    }
+
+    SC55ROM &operator=(SC55ROM &&other) noexcept
+    {
+        if(this != &other)
+        {
+            Reset();
+            rom_ = other.rom_;
+            resource_ = other.resource_;
+            buffer_ = other.buffer_;
+            buffer_size_ = other.buffer_size_;
+            other.Release();
+        }
+
+        return *this;
+    }
+
+    ~SC55ROM()
+    {
+        Reset();
+    }
+
+    /* Parses data in place; the caller keeps ownership and must keep it alive while the ROM is in use */
+    static SC55ROM Borrow(std::span<std::uint8_t> data, const SC55ReadOptions &options)
+    {
+        SC55ROM rom;
+
+        rom.rom_ = ParseROMBorrowed(data.data(), data.size(), &options);
+        return rom;
+    }
+
+    /* Copies data once into a buffer from resource and parses the copy */
+    static SC55ROM Copy(std::span<const std::uint8_t> data, const SC55ReadOptions &options, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    {
+        SC55ROM rom;
+
+        if(!rom.Allocate(resource, data.size()))
+        {
+            return rom;
+        }
+
+        std::memcpy(rom.buffer_, data.data(), data.size());
+        rom.Parse(options);
+        return rom;
+    }
+
+    /*
+    ** Reads a ROM file straight into a buffer from resource.  As with
+    ** ReadROM, a file whose size cannot match a known ROM is rejected
+    ** before anything is allocated, unless checksum failures are ignored.
+    */
+    static SC55ROM Read(const char *rom_file_path, const SC55ReadOptions &options, std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    {
+        SC55ROM rom;
+        std::FILE *fp;
+        long file_size;
+        bool read_ok;
+
+        fp = std::fopen(rom_file_path, "rb");
+        if(!fp)
+        {
+            return rom;
+        }
+
+        if(std::fseek(fp, 0, SEEK_END) != 0 || (file_size = std::ftell(fp)) <= 0 || std::fseek(fp, 0, SEEK_SET) != 0)
+        {
+            std::fclose(fp);
+            return rom;
+        }
+
+        if(options.ignore_sha256_failures == 0 && !IsKnownROMSize(static_cast<std::size_t>(file_size), options.hash_database))
+        {
+            std::fclose(fp);
+            return rom;
+        }
+
+        if(!rom.Allocate(resource, static_cast<std::size_t>(file_size)))
+        {
+            std::fclose(fp);
+            return rom;
+        }
+
+        read_ok = std::fread(rom.buffer_, 1, rom.buffer_size_, fp) == rom.buffer_size_;
+        std::fclose(fp);
+
+        if(read_ok)
+        {
+            rom.Parse(options);
+        }
+        else
+        {
+            rom.Reset();
+        }
+
+        return rom;
+    }
+
+    /* Clears the ROM and returns its buffer to the memory resource it came from */
+    void Reset() noexcept
+    {
+        DestroyROM(&rom_);
+        if(buffer_)
+        {
+            resource_->deallocate(buffer_, buffer_size_, BufferAlignment);
+        }
+        Release();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return rom_.rom_data != nullptr;
+    }
+
+    /* The views below are only meaningful on a ROM that parsed */
+    std::span<std::uint8_t> Data() noexcept
+    {
+        return std::span<std::uint8_t>(rom_.rom_data, rom_.rom_size);
+    }
+
+    std::span<const std::uint8_t> Data() const noexcept
+    {
+        return std::span<const std::uint8_t>(rom_.rom_data, rom_.rom_size);
+    }
+
+    std::span<std::uint8_t, SC55_TONE_TABLE_SIZE> ToneTable() noexcept
+    {
+        return std::span<std::uint8_t, SC55_TONE_TABLE_SIZE>(rom_.tone_table, SC55_TONE_TABLE_SIZE);
+    }
+
+    std::span<const std::uint8_t, SC55_TONE_TABLE_SIZE> ToneTable() const noexcept
+    {
+        return std::span<const std::uint8_t, SC55_TONE_TABLE_SIZE>(rom_.tone_table, SC55_TONE_TABLE_SIZE);
+    }
+
+    /* The drum slots the patch rewrites */
+    std::span<std::uint8_t, SC55_DRUM_PATCH_SIZE> DrumTable() noexcept
+    {
+        return std::span<std::uint8_t, SC55_DRUM_PATCH_SIZE>(rom_.drum_table, SC55_DRUM_PATCH_SIZE);
+    }
+
+    std::span<const std::uint8_t, SC55_DRUM_PATCH_SIZE> DrumTable() const noexcept
+    {
+        return std::span<const std::uint8_t, SC55_DRUM_PATCH_SIZE>(rom_.drum_table, SC55_DRUM_PATCH_SIZE);
+    }
+
+    /* The two version string bytes a patch with update_version rewrites, or an empty span for an unknown ROM */
+    std::span<std::uint8_t> VersionBytes() noexcept
+    {
+        std::uint8_t *version = PatchedVersionAddress(&rom_);
+
+        return version ? std::span<std::uint8_t>(version, 2) : std::span<std::uint8_t>();
+    }
+
+    std::span<const std::uint8_t> VersionBytes() const noexcept
+    {
+        const std::uint8_t *version = PatchedVersionAddress(&rom_);
+
+        return version ? std::span<const std::uint8_t>(version, 2) : std::span<const std::uint8_t>();
+    }
+
+    /* With lazy_identify, hashes and identifies the ROM; until then SHA256, IsKnown, Name and VersionBytes are not filled in */
+    int Identify() noexcept
+    {
+        return IdentifyROMData(&rom_);
+    }
+
+    /* Identifies a lazily parsed ROM on another thread; Identify waits for it */
+    int StartIdentify() noexcept
+    {
+        return StartROMIdentification(&rom_);
+    }
+
+    std::span<const std::uint8_t, 32> SHA256() const noexcept
+    {
+        return std::span<const std::uint8_t, 32>(rom_.rom_sha256, 32);
+    }
+
+    bool IsKnown() const noexcept
+    {
+        return rom_.is_known_rom != 0;
+    }
+
+    /* The known ROM's name, or nullptr */
+    const char *Name() const noexcept
+    {
+        return rom_.rom_name;
+    }
+
+    int Patch(std::uint8_t compat_mode, std::uint8_t drum_compat_mode, std::uint8_t update_version) noexcept
+    {
+        return PatchROM(&rom_, compat_mode, drum_compat_mode, update_version);
+    }
+
+    int Write(const char *rom_file_path) const noexcept
+    {
+        return WriteROM(&rom_, rom_file_path);
+    }
+
+    /* For the rest of the C API; the struct stays owned by the wrapper and must not be passed to DestroyROM */
+    SC55ROMData *Get() noexcept
+    {
+        return &rom_;
+    }
+
+    const SC55ROMData *Get() const noexcept
+    {
+        return &rom_;
+    }
+
+    /* The resource the buffer came from, or nullptr for a borrowed or empty ROM */
+    std::pmr::memory_resource *Resource() const noexcept
+    {
+        return resource_;
+    }
+
+private:
+    SC55ROMData rom_;
+    std::pmr::memory_resource *resource_;
+    std::uint8_t *buffer_;
+    std::size_t buffer_size_;
+
+    bool Allocate(std::pmr::memory_resource *resource, std::size_t size)
+    {
+        if(size == 0)
+        {
+            return false;
+        }
+
+        buffer_ = static_cast<std::uint8_t*>(resource->allocate(size, BufferAlignment));
+        resource_ = resource;
+        buffer_size_ = size;
+        return true;
+    }
+
+    /* A rejected buffer goes straight back to the resource */
+    void Parse(const SC55ReadOptions &options)
+    {
+        rom_ = ParseROMBorrowed(buffer_, buffer_size_, &options);
+        if(rom_.rom_data == nullptr)
+        {
+            Reset();
+        }
+    }
+
+    /* Forgets the ROM and buffer without freeing them, once they have moved elsewhere */
+    void Release() noexcept
+    {
+        rom_ = SC55ROMData();
+        resource_ = nullptr;
+        buffer_ = nullptr;
+        buffer_size_ = 0;
+    }
+};
+
+#endif /* CTF_PATCH_HPP */
@@ -0,0 +1,493 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "CTFBatch.h"
+#include "CTFPatch.h"
+#include "CTFScan.h"
+
+#ifdef CTF_HAVE_POSIX
+#include <dirent.h>
+#include <pthread.h>
+
+#include "CTFWorkPool.h"
+
+/* Groups never hold more files than the widest multi-buffer hash */
+#define SCAN_MAX_GROUP 16
+
+/* Distinct known ROM sizes with a group being filled at once; more sizes are hashed one file at a time */
+#define SCAN_MAX_SIZES 32
+
+typedef struct
+{
+	size_t size;
+	size_t num_paths;
+	char *paths[SCAN_MAX_GROUP];
+} scan_group;
+
+typedef struct
+{
+	work_pool *pool;
+	const SC55HashDatabase *hash_database;
+	FILE *manifest;
+	size_t group_size;
+	pthread_mutex_t lock;
+	/* Candidates waiting for a full group of their size, protected by lock */
+	scan_group pending[SCAN_MAX_SIZES];
+	size_t num_pending;
+	/* Counters and the manifest are protected by lock as well */
+	size_t num_files;
+	size_t num_candidates;
+	size_t num_known;
+	size_t num_errors;
+} scan_state;
+
+typedef struct
+{
+	scan_state *state;
+	char *path;
+} scan_directory_task;
+
+typedef struct
+{
+	scan_state *state;
+	scan_group group;
+} scan_group_task;
+
+/* JSON text is UTF-8, so bytes from 0x80 up (such as UTF-8 file names) are written as they are */
+static void print_json_string(FILE *fp, const char *text, size_t length)
+{
+	size_t i;
+	unsigned char c;
+
+	fputc('"', fp);
+	for(i = 0; i < length; i++)
+	{
+		c = (unsigned char)text[i];
+		if(c == '"' || c == '\\')
+		{
+			fputc('\\', fp);
+			fputc(c, fp);
+		}
+		else if(c < 0x20 || c == 0x7f)
+		{
+			fprintf(fp, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+/* Called with state->lock held */
+static void print_scan_error(scan_state *state, const char *path, size_t size, const char *error)
+{
+	fputs("{\"path\": ", state->manifest);
+	print_json_string(state->manifest, path, strlen(path));
+	fprintf(state->manifest, ", \"size\": %lu, \"error\": ", (unsigned long)size);
+	print_json_string(state->manifest, error, strlen(error));
+	fputs("}\n", state->manifest);
+	state->num_errors++;
+}
+
+/* Called with state->lock held */
+static void print_scan_result(scan_state *state, const char *path, const uint8_t *rom_data, size_t size, const uint8_t rom_sha256[32], const SC55ROMIdentity *identity)
+{
+	size_t i;
+
+	fputs("{\"path\": ", state->manifest);
+	print_json_string(state->manifest, path, strlen(path));
+	fprintf(state->manifest, ", \"size\": %lu, \"sha256\": \"", (unsigned long)size);
+	for(i = 0; i < 32; i++)
+	{
+		fprintf(state->manifest, "%02x", rom_sha256[i]);
+	}
+	fputs("\", \"rom_name\": ", state->manifest);
+
+	if(identity->rom_name)
+	{
+		print_json_string(state->manifest, identity->rom_name, strlen(identity->rom_name));
+		fputs(", \"version\": ", state->manifest);
+		print_json_string(state->manifest, (const char*)rom_data + identity->version_address, 4);
+		state->num_known++;
+	}
+	else
+	{
+		fputs("null, \"version\": null", state->manifest);
+	}
+	fputs("}\n", state->manifest);
+}
+
+/* Reads exactly size bytes from path, failing if the file has changed size since it was listed */
+static uint8_t *read_candidate(const char *path, size_t size)
+{
+	FILE *fp;
+	uint8_t *data;
+	int extra;
+
+	data = (uint8_t*)malloc(size);
+	if(data == NULL)
+	{
+		return NULL;
+	}
+
+	fp = fopen(path, "rb");
+	if(fp == NULL)
+	{
+		free(data);
+		return NULL;
+	}
+
+	if(fread(data, 1, size, fp) != size)
+	{
+		free(data);
+		data = NULL;
+	}
+	else
+	{
+		extra = fgetc(fp);
+		if(extra != EOF)
+		{
+			free(data);
+			data = NULL;
+		}
+	}
+
+	fclose(fp);
+	return data;
+}
+
+/* Reads, hashes and reports one group of same-sized candidates */
+static void scan_group_run(void *argument, size_t worker_index)
+{
+	scan_group_task *task = (scan_group_task*)argument;
+	scan_state *state = task->state;
+	scan_group *group = &task->group;
+	const uint8_t *rom_data[SCAN_MAX_GROUP];
+	const char *paths[SCAN_MAX_GROUP];
+	uint8_t rom_sha256[SCAN_MAX_GROUP][32];
+	SC55ROMIdentity identities[SCAN_MAX_GROUP];
+	size_t num_read = 0;
+	size_t i;
+	int result = 1;
+
+	(void)worker_index;
+
+	for(i = 0; i < group->num_paths; i++)
+	{
+		rom_data[num_read] = read_candidate(group->paths[i], group->size);
+		if(rom_data[num_read] == NULL)
+		{
+			pthread_mutex_lock(&state->lock);
+			print_scan_error(state, group->paths[i], group->size, "unable to read file");
+			fflush(state->manifest);
+			pthread_mutex_unlock(&state->lock);
+			continue;
+		}
+		paths[num_read++] = group->paths[i];
+	}
+
+	if(num_read > 0)
+	{
+		result = IdentifyROMs(state->hash_database, rom_data, num_read, group->size, rom_sha256, identities);
+	}
+
+	pthread_mutex_lock(&state->lock);
+	for(i = 0; i < num_read; i++)
+	{
+		if(result != 0)
+		{
+			print_scan_error(state, paths[i], group->size, "unable to hash file");
+			continue;
+		}
+		print_scan_result(state, paths[i], rom_data[i], group->size, rom_sha256[i], &identities[i]);
+	}
+	fflush(state->manifest);
+	pthread_mutex_unlock(&state->lock);
+
+	for(i = 0; i < num_read; i++)
+	{
+		free((void*)rom_data[i]);
+	}
+	for(i = 0; i < group->num_paths; i++)
+	{
+		free(group->paths[i]);
+	}
+	free(task);
+}
+
+/* Queues a group for hashing, or runs it here if it cannot be queued; takes ownership of its paths */
+static void submit_group(scan_state *state, const scan_group *group, size_t worker_index, int from_worker)
+{
+	scan_group_task *task;
+	size_t i;
+
+	task = (scan_group_task*)malloc(sizeof(scan_group_task));
+	if(task == NULL)
+	{
+		pthread_mutex_lock(&state->lock);
+		for(i = 0; i < group->num_paths; i++)
+		{
+			print_scan_error(state, group->paths[i], group->size, "out of memory");
+			free(group->paths[i]);
+		}
+		pthread_mutex_unlock(&state->lock);
+		return;
+	}
+
+	task->state = state;
+	task->group = *group;
+
+	if((from_worker ? work_pool_submit_to(state->pool, worker_index, scan_group_run, task) : work_pool_submit(state->pool, scan_group_run, task)) != 0)
+	{
+		scan_group_run(task, worker_index);
+	}
+}
+
+/* Adds a candidate to the pending group of its size, submitting the group once it is full; takes ownership of path */
+static void add_candidate(scan_state *state, char *path, size_t size, size_t worker_index)
+{
+	scan_group full;
+	scan_group *group = NULL;
+	size_t i;
+	int submit = 0;
+
+	pthread_mutex_lock(&state->lock);
+	state->num_candidates++;
+
+	for(i = 0; i < state->num_pending; i++)
+	{
+		if(state->pending[i].size == size)
+		{
+			group = &state->pending[i];
+			break;
+		}
+	}
+
+	if(group == NULL && state->num_pending < SCAN_MAX_SIZES)
+	{
+		group = &state->pending[state->num_pending++];
+		group->size = size;
+		group->num_paths = 0;
+	}
+
+	if(group == NULL)
+	{
+		full.size = size;
+		full.num_paths = 1;
+		full.paths[0] = path;
+		submit = 1;
+	}
+	else
+	{
+		group->paths[group->num_paths++] = path;
+		if(group->num_paths == state->group_size)
+		{
+			full = *group;
+			group->num_paths = 0;
+			submit = 1;
+		}
+	}
+	pthread_mutex_unlock(&state->lock);
+
+	if(submit)
+	{
+		submit_group(state, &full, worker_index, 1);
+	}
+}
+
+static void scan_directory(void *argument, size_t worker_index);
+
+static void submit_directory(scan_state *state, char *path, size_t worker_index, int from_worker)
+{
+	scan_directory_task *task;
+	int result = 1;
+
+	task = (scan_directory_task*)malloc(sizeof(scan_directory_task));
+	if(task != NULL)
+	{
+		task->state = state;
+		task->path = path;
+		result = from_worker ? work_pool_submit_to(state->pool, worker_index, scan_directory, task) : work_pool_submit(state->pool, scan_directory, task);
+	}
+
+	if(result != 0)
+	{
+		pthread_mutex_lock(&state->lock);
+		fprintf(stderr, "Unable to scan directory %s\n", path);
+		state->num_errors++;
+		pthread_mutex_unlock(&state->lock);
+		free(path);
+		free(task);
+	}
+}
+
+/* Lists one directory, queueing its subdirectories as tasks of their own */
+static void scan_directory(void *argument, size_t worker_index)
+{
+	scan_directory_task *task = (scan_directory_task*)argument;
+	scan_state *state = task->state;
+	DIR *dir;
+	struct dirent *entry;
+	struct stat st;
+	char *entry_path;
+
+	dir = opendir(task->path);
+	if(dir == NULL)
+	{
+		pthread_mutex_lock(&state->lock);
+		fprintf(stderr, "Unable to open directory %s\n", task->path);
+		state->num_errors++;
+		pthread_mutex_unlock(&state->lock);
+		free(task->path);
+		free(task);
+		return;
+	}
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+		{
+			continue;
+		}
+
+		entry_path = (char*)malloc(strlen(task->path) + strlen(entry->d_name) + 2);
+		if(entry_path == NULL)
+		{
+			pthread_mutex_lock(&state->lock);
+			state->num_errors++;
+			pthread_mutex_unlock(&state->lock);
+			break;
+		}
+		sprintf(entry_path, "%s/%s", task->path, entry->d_name);
+
+		if(lstat(entry_path, &st) != 0 || (S_ISLNK(st.st_mode) && (stat(entry_path, &st) != 0 || S_ISDIR(st.st_mode))))
+		{
+			free(entry_path);
+			continue;
+		}
+
+		if(S_ISDIR(st.st_mode))
+		{
+			submit_directory(state, entry_path, worker_index, 1);
+			continue;
+		}
+
+		if(!S_ISREG(st.st_mode))
+		{
+			free(entry_path);
+			continue;
+		}
+
+		pthread_mutex_lock(&state->lock);
+		state->num_files++;
+		pthread_mutex_unlock(&state->lock);
+
+		/* Rejected on size alone, so most of an archive is never opened */
+		if(!IsKnownROMSize((size_t)st.st_size, state->hash_database))
+		{
+			free(entry_path);
+			continue;
+		}
+
+		add_candidate(state, entry_path, (size_t)st.st_size, worker_index);
+	}
+
+	closedir(dir);
+	free(task->path);
+	free(task);
+}
+
+int run_scan(const char *root, const SC55HashDatabase *hash_database, FILE *manifest, size_t num_threads)
+{
+	scan_state state;
+	char *root_path;
+	size_t length;
+	size_t i;
+
+	memset(&state, 0, sizeof(state));
+	state.hash_database = hash_database;
+	state.manifest = manifest;
+	state.group_size = (size_t)GetSHA256Lanes();
+	if(state.group_size > SCAN_MAX_GROUP)
+	{
+		state.group_size = SCAN_MAX_GROUP;
+	}
+
+	/* Trailing separators would otherwise be doubled in every path */
+	length = strlen(root);
+	while(length > 1 && root[length - 1] == '/')
+	{
+		length--;
+	}
+
+	root_path = (char*)malloc(length + 1);
+	state.pool = work_pool_create(num_threads);
+	if(root_path == NULL || state.pool == NULL)
+	{
+		fprintf(stderr, "Unable to start scan workers\n");
+		free(root_path);
+		work_pool_destroy(state.pool);
+		return 1;
+	}
+	memcpy(root_path, root, length);
+	root_path[length] = 0;
+
+	pthread_mutex_init(&state.lock, NULL);
+
+	submit_directory(&state, root_path, 0, 0);
+	work_pool_wait(state.pool);
+
+	/* The walk is over, so whatever is left in a group will not be joined by anything else */
+	for(i = 0; i < state.num_pending; i++)
+	{
+		if(state.pending[i].num_paths > 0)
+		{
+			submit_group(&state, &state.pending[i], 0, 0);
+		}
+	}
+	work_pool_wait(state.pool);
+
+	work_pool_destroy(state.pool);
+	pthread_mutex_destroy(&state.lock);
+
+	fprintf(stderr, "%lu files scanned, %lu candidates, %lu known ROMs\n", (unsigned long)state.num_files, (unsigned long)state.num_candidates, (unsigned long)state.num_known);
+
+	return state.num_errors > 0 ? 1 : 0;
+}
+#else
+int run_scan(const char *root, const SC55HashDatabase *hash_database, FILE *manifest, size_t num_threads)
+{
+	(void)root;
+	(void)hash_database;
+	(void)manifest;
+	(void)num_threads;
+	fprintf(stderr, "Library scans are not supported on this platform.\n");
+	return 1;
+}
+#endif
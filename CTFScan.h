@@ -0,0 +1,54 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_SCAN_H
+#define CTF_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "CTFPatch.h"
+
+/*
+** Inventories every regular file under root without patching anything.
+** Directories are walked in parallel on num_threads workers (0 for one
+** per core), and symbolic links to directories are not followed.  Files
+** whose size matches no known ROM, built in or in hash_database, are
+** skipped without being opened.  The rest are read, hashed several at a
+** time where the CPU supports it, and identified.
+**
+** Each candidate is written to manifest as one JSON object per line as
+** soon as its group is hashed, so lines are not in walk order:
+**   {"path": ..., "size": ..., "sha256": ..., "rom_name": ..., "version": ...}
+** where rom_name and version (the four characters at the ROM's version
+** address) are null for unrecognised files.  A candidate that cannot be
+** read gets {"path": ..., "size": ..., "error": ...} instead.  Returns 0
+** if the whole tree was walked and every candidate was read.
+*/
+int run_scan(const char *root, const SC55HashDatabase *hash_database, FILE *manifest, size_t num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTF_SCAN_H */
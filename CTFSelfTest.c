@@ -0,0 +1,544 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+** Self-tests of the library internals, for CTFPatch -t and make test.
+** They need the library's static kernels and tables, so this file
+** builds CTFPatch.c into the same translation unit and is linked into
+** the program in place of CTFPatch.o; the shipped libraries are built
+** from CTFPatch.o alone and do not carry the tests.
+*/
+#define SC55_SELF_TEST
+#include "CTFPatch.c"
+
+#include "CTFSelfTest.h"
+
+/*
+** Checks every available SHA-256 backend against the FIPS 180-2 test
+** vectors, against the portable backend for every padding boundary,
+** and against the portable backend over synthetic images of each size
+** listed in SC55_HASHES, hashed both in one call and streamed in uneven
+** chunks.  Returns 0 on success, or a bitmask with bit
+** (1 << backend) set for each backend which produced a wrong digest.
+*/
+int SelfTestSHA256(void)
+{
+    static const char *vector_inputs[3] = {
+        "",
+        "abc",
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+    };
+    static const uint8_t vector_digests[3][32] = {
+        {0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+         0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55},
+        {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+         0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+        {0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+         0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1}
+    };
+    uint8_t expected[32];
+    uint8_t actual[32];
+    uint8_t *buffer;
+    size_t buffer_size = 256;
+    size_t sc55_num_hashes = sizeof(SC55_HASHES)/sizeof(SC55Hash);
+    size_t i, len, chunk_size;
+    lonesha256_ctx sha256_ctx;
+    uint32_t seed = 0x55aa55aaU;
+    int backend;
+    int failures = 0;
+
+    for(i = 0; i < sc55_num_hashes; i++)
+    {
+        if(SC55_HASHES[i].file_size > buffer_size)
+        {
+            buffer_size = SC55_HASHES[i].file_size;
+        }
+    }
+
+    buffer = (uint8_t*)SC55_MALLOC(buffer_size);
+    if(buffer == NULL)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < buffer_size; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        buffer[i] = (uint8_t)seed;
+    }
+
+    for(backend = 0; backend < SC55_SHA256_BACKEND_COUNT; backend++)
+    {
+        if(!lonesha256_backend_available(backend))
+        {
+            continue;
+        }
+
+        for(i = 0; i < 3; i++)
+        {
+            lonesha256_with_backend(backend, actual, (const unsigned char*)vector_inputs[i], strlen(vector_inputs[i]));
+            if(memcmp(actual, vector_digests[i], 32) != 0)
+            {
+                failures |= 1 << backend;
+            }
+        }
+
+        for(len = 0; len <= 256; len++)
+        {
+            lonesha256_with_backend(SC55_SHA256_BACKEND_PORTABLE, expected, buffer, len);
+            lonesha256_with_backend(backend, actual, buffer, len);
+            if(memcmp(actual, expected, 32) != 0)
+            {
+                failures |= 1 << backend;
+            }
+        }
+
+        for(i = 0; i < sc55_num_hashes; i++)
+        {
+            lonesha256_with_backend(SC55_SHA256_BACKEND_PORTABLE, expected, buffer, SC55_HASHES[i].file_size);
+            lonesha256_with_backend(backend, actual, buffer, SC55_HASHES[i].file_size);
+            if(memcmp(actual, expected, 32) != 0)
+            {
+                failures |= 1 << backend;
+            }
+
+            /* The same image fed through the streaming API in uneven chunks */
+            lonesha256_init_backend(&sha256_ctx, backend);
+            for(len = 0, chunk_size = 1; len < SC55_HASHES[i].file_size; len += chunk_size, chunk_size = (chunk_size * 7 + 3) % 8191 + 1)
+            {
+                if(chunk_size > SC55_HASHES[i].file_size - len)
+                {
+                    chunk_size = SC55_HASHES[i].file_size - len;
+                }
+                lonesha256_update(&sha256_ctx, buffer + len, chunk_size);
+            }
+            lonesha256_final(&sha256_ctx, actual);
+            if(memcmp(actual, expected, 32) != 0)
+            {
+                failures |= 1 << backend;
+            }
+        }
+    }
+
+    SC55_FREE(buffer);
+    return failures;
+}
+
+/*
+** Checks the multi-buffer hashing of every lane count the CPU supports
+** against the portable backend, for group sizes that leave partial
+** groups and for lengths around each padding boundary and of each size
+** listed in SC55_HASHES.  Returns 0 on success, a bitmask with bit 0
+** set if eight lanes failed and bit 1 if sixteen lanes failed, or -1
+** if the test buffers could not be allocated.
+*/
+int SelfTestSHA256Multi(void)
+{
+    static const int lane_counts[2] = {8, 16};
+    static const size_t short_lengths[6] = {0, 55, 56, 64, 119, 1000};
+    const uint8_t *buffers[37];
+    uint8_t (*digests)[32];
+    uint8_t (*expected)[32];
+    uint8_t *buffer;
+    size_t buffer_size = 0x400;
+    size_t sc55_num_hashes = sizeof(SC55_HASHES)/sizeof(SC55Hash);
+    size_t num_lengths = 6 + sc55_num_hashes;
+    size_t i, j, len, count;
+    uint32_t seed = 0xaa55aa55U;
+    int lanes;
+    int failures = 0;
+
+    for(i = 0; i < sc55_num_hashes; i++)
+    {
+        if(SC55_HASHES[i].file_size > buffer_size)
+        {
+            buffer_size = SC55_HASHES[i].file_size;
+        }
+    }
+
+    /* Each buffer starts a little further into one random block, so no two lanes hash the same bytes */
+    buffer = (uint8_t*)SC55_MALLOC(buffer_size + 37);
+    digests = (uint8_t(*)[32])SC55_MALLOC(37 * 32);
+    expected = (uint8_t(*)[32])SC55_MALLOC(37 * 32);
+    if(buffer == NULL || digests == NULL || expected == NULL)
+    {
+        SC55_FREE(buffer);
+        SC55_FREE(digests);
+        SC55_FREE(expected);
+        return -1;
+    }
+
+    for(i = 0; i < buffer_size + 37; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        buffer[i] = (uint8_t)seed;
+    }
+
+    for(i = 0; i < 37; i++)
+    {
+        buffers[i] = buffer + i;
+    }
+
+    for(i = 0; i < num_lengths; i++)
+    {
+        len = i < 6 ? short_lengths[i] : SC55_HASHES[i - 6].file_size;
+        for(j = 0; j < 37; j++)
+        {
+            lonesha256_with_backend(SC55_SHA256_BACKEND_PORTABLE, expected[j], buffers[j], len);
+        }
+
+        for(lanes = 0; lanes < 2; lanes++)
+        {
+            for(count = 1; count <= 37; count += (i < 6 || count < 3) ? 1 : 17)
+            {
+                if(lonesha256_multi_with_lanes(lane_counts[lanes], digests, buffers, count, len) != 0)
+                {
+                    break;
+                }
+
+                for(j = 0; j < count; j++)
+                {
+                    if(memcmp(digests[j], expected[j], 32) != 0)
+                    {
+                        failures |= 1 << lanes;
+                    }
+                }
+            }
+        }
+    }
+
+    SC55_FREE(expected);
+    SC55_FREE(digests);
+    SC55_FREE(buffer);
+    return failures;
+}
+
+/*
+** Checks that SC55_HASH_INDEX is sorted and holds the binary form of
+** every SC55_HASHES digest exactly once.  Returns 0 if it does.
+*/
+int SelfTestHashIndex(void)
+{
+    size_t sc55_num_hashes = sizeof(SC55_HASHES)/sizeof(SC55Hash);
+    size_t num_index_entries = sizeof(SC55_HASH_INDEX)/sizeof(SC55HashIndexEntry);
+    uint8_t digest[32];
+    size_t i;
+
+    if(num_index_entries != sc55_num_hashes)
+    {
+        return 1;
+    }
+
+    for(i = 0; i < num_index_entries; i++)
+    {
+        if(i > 0 && memcmp(SC55_HASH_INDEX[i - 1].sha256, SC55_HASH_INDEX[i].sha256, 32) >= 0)
+        {
+            return 1;
+        }
+
+        if(SC55_HASH_INDEX[i].hash_index >= sc55_num_hashes || ParseHexDigest(SC55_HASHES[SC55_HASH_INDEX[i].hash_index].sha256hash, digest) != 0 || memcmp(digest, SC55_HASH_INDEX[i].sha256, 32) != 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Checks that changed covers every byte where table differs from original */
+static int ToneChangesCovered(const uint8_t *original, const uint8_t *table, const SC55ROMRange *changed)
+{
+    size_t i;
+
+    for(i = 0; i < SC55_TONE_TABLE_SIZE; i++)
+    {
+        if(original[i] != table[i] && (i < changed->offset || i >= changed->offset + changed->length))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+** Runs every tone fill kernel this build and CPU can use on random
+** tables, with each built-in plan and with random plans, and compares
+** the results with the portable kernel.  Returns 0 on success, a
+** bitmask with bit 0 set if SSE2 failed, bit 1 if AVX2 failed, bit 2
+** if NEON failed and bit 3 if the portable kernel misreported what it
+** changed, or -1 if the test tables could not be allocated.
+*/
+int SelfTestFillKernels(void)
+{
+    SC55TonePlan random_plan;
+    const SC55TonePlan *plan;
+    SC55ROMRange expected_changes;
+    SC55ROMRange changes;
+    uint8_t *original;
+    uint8_t *expected;
+    uint8_t *table;
+    size_t num_plans = sizeof(SC55_TONE_PLANS)/sizeof(SC55TonePlan);
+    size_t round, plan_index, i, bank;
+    uint32_t seed = 0x5a5a1234U;
+    int kernel;
+    int failures = 0;
+
+    original = (uint8_t*)SC55_MALLOC(SC55_TONE_TABLE_SIZE);
+    expected = (uint8_t*)SC55_MALLOC(SC55_TONE_TABLE_SIZE);
+    table = (uint8_t*)SC55_MALLOC(SC55_TONE_TABLE_SIZE);
+    if(original == NULL || expected == NULL || table == NULL)
+    {
+        SC55_FREE(original);
+        SC55_FREE(expected);
+        SC55_FREE(table);
+        return -1;
+    }
+
+    for(round = 0; round < 16; round++)
+    {
+        /* About a quarter of the cells are empty, with more in later rounds */
+        for(i = 0; i < SC55_TONE_TABLE_SIZE; i += 2)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            if((seed >> 24) < 64 + (round * 8))
+            {
+                original[i] = 0xff;
+                original[i + 1] = 0xff;
+            }
+            else
+            {
+                original[i] = (uint8_t)seed;
+                original[i + 1] = (uint8_t)(seed >> 8);
+            }
+        }
+
+        for(bank = 0; bank < SC55_TONE_MAP_BANKS; bank++)
+        {
+            for(i = 0; i < 2; i++)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                random_plan.use_group[bank][i] = ((uint64_t)seed << 32) | (seed * 0x9e3779b9U);
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                random_plan.force[bank][i] = ((uint64_t)(seed & (seed >> 7)) << 32) | (seed & (seed >> 3));
+            }
+        }
+
+        for(plan_index = 0; plan_index <= num_plans; plan_index++)
+        {
+            plan = plan_index < num_plans ? &SC55_TONE_PLANS[plan_index] : &random_plan;
+
+            memcpy(expected, original, SC55_TONE_TABLE_SIZE);
+            expected_changes.offset = 0;
+            expected_changes.length = 0;
+            FillToneTablePortable(expected, plan, &expected_changes);
+            if(!ToneChangesCovered(original, expected, &expected_changes))
+            {
+                failures |= 1 << 3;
+            }
+
+            for(kernel = 0; kernel < 3; kernel++)
+            {
+                memcpy(table, original, SC55_TONE_TABLE_SIZE);
+                changes.offset = 0;
+                changes.length = 0;
+
+                if(kernel == 0)
+                {
+#ifdef SC55_HAVE_SSE2
+                    FillToneTableSSE2(table, plan, &changes);
+#else
+                    continue;
+#endif
+                }
+                else if(kernel == 1)
+                {
+#ifdef SC55_HAVE_AVX2
+                    if(!__builtin_cpu_supports("avx2"))
+                    {
+                        continue;
+                    }
+                    FillToneTableAVX2(table, plan, &changes);
+#else
+                    continue;
+#endif
+                }
+                else
+                {
+#ifdef SC55_HAVE_NEON
+                    FillToneTableNEON(table, plan, &changes);
+#else
+                    continue;
+#endif
+                }
+
+                if(memcmp(table, expected, SC55_TONE_TABLE_SIZE) != 0 || !ToneChangesCovered(original, table, &changes))
+                {
+                    failures |= 1 << kernel;
+                }
+            }
+        }
+    }
+
+    SC55_FREE(table);
+    SC55_FREE(expected);
+    SC55_FREE(original);
+    return failures;
+}
+
+/*
+** Builds a journal for each of the six modes from a random image, then
+** takes a 60-step random walk between them: switching from one mode to
+** another, reverting to the original and applying from there.  After
+** every step the image must match PatchROM's result for the current
+** mode, or the original.  Last, the image is marked known and patched
+** with the version update, which must rewrite the two bytes given by
+** PatchedVersionAddress.  Returns 0 on success, 1 on a journal mismatch,
+** 2 if the version bytes are wrong, or -1 if the test images could not
+** be allocated.
+*/
+int SelfTestPatchJournal(void)
+{
+    static const uint8_t compat_modes[3] = {SC55_STRICT_SC55_COMPAT, SC55_SC55_COMPAT, SC55_SC55MKII_COMPAT};
+    static const uint8_t drum_modes[2] = {SC55_DRUM_EARLY_COMPAT, SC55_DRUM_LATE_COMPAT};
+    SC55PatchJournal journals[6];
+    SC55ReadOptions options;
+    SC55ROMData rom;
+    SC55ROMData expected_rom;
+    uint8_t *original;
+    uint8_t *image;
+    uint8_t *expected;
+    size_t i, step;
+    size_t num_journals = 0;
+    uint32_t seed = 0x13572468U;
+    int current = -1;
+    int next;
+    int result = 0;
+
+    original = (uint8_t*)SC55_MALLOC(SC55_MIN_ROM_SIZE);
+    image = (uint8_t*)SC55_MALLOC(SC55_MIN_ROM_SIZE);
+    expected = (uint8_t*)SC55_MALLOC(SC55_MIN_ROM_SIZE * 6);
+    if(original == NULL || image == NULL || expected == NULL)
+    {
+        SC55_FREE(original);
+        SC55_FREE(image);
+        SC55_FREE(expected);
+        return -1;
+    }
+
+    /* About a quarter of the bytes are 0xff, so tone cells and drum slots are often empty */
+    for(i = 0; i < SC55_MIN_ROM_SIZE; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        original[i] = (seed >> 24) < 64 ? 0xff : (uint8_t)seed;
+    }
+
+    InitReadOptions(&options);
+    options.ignore_sha256_failures = 1;
+
+    for(i = 0; i < 6; i++)
+    {
+        memcpy(expected + (i * SC55_MIN_ROM_SIZE), original, SC55_MIN_ROM_SIZE);
+        expected_rom = ParseROMBorrowed(expected + (i * SC55_MIN_ROM_SIZE), SC55_MIN_ROM_SIZE, &options);
+        if(PatchROM(&expected_rom, compat_modes[i / 2], drum_modes[i % 2], 0) != 0)
+        {
+            result = 1;
+        }
+        DestroyROM(&expected_rom);
+    }
+
+    memcpy(image, original, SC55_MIN_ROM_SIZE);
+    rom = ParseROMBorrowed(image, SC55_MIN_ROM_SIZE, &options);
+
+    for(i = 0; i < 6 && result == 0; i++)
+    {
+        if(BuildPatchJournal(&rom, compat_modes[i / 2], drum_modes[i % 2], 0, &journals[i]) != 0)
+        {
+            result = 1;
+            break;
+        }
+        num_journals++;
+    }
+
+    for(step = 0; step < 60 && result == 0; step++)
+    {
+        /* -1 stands for the original image */
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        next = (int)(seed % 7) - 1;
+
+        if(current < 0 && next >= 0)
+        {
+            result = ApplyPatchJournal(&rom, &journals[next]);
+        }
+        else if(current >= 0 && next < 0)
+        {
+            result = RevertPatchJournal(&rom, &journals[current]);
+        }
+        else if(current >= 0)
+        {
+            result = SwitchPatchJournal(&rom, &journals[current], &journals[next]);
+        }
+        current = next;
+
+        if(result == 0 && memcmp(image, current < 0 ? original : expected + ((size_t)current * SC55_MIN_ROM_SIZE), SC55_MIN_ROM_SIZE) != 0)
+        {
+            result = 1;
+        }
+    }
+
+    /* Marked known as a lookup would, so the version op runs; the bytes before the two it replaces must be untouched */
+    if(result == 0)
+    {
+        memcpy(image, original, SC55_MIN_ROM_SIZE);
+        rom.is_known_rom = 1;
+        rom.rom_version_address = image + SC55_MIN_ROM_SIZE - 16;
+        if(PatchROM(&rom, SC55_SC55_COMPAT, SC55_DRUM_EARLY_COMPAT, 1) != 0 || PatchedVersionAddress(&rom) != rom.rom_version_address + SC55_MODEL_LAYOUTS[rom.rom_model].version_offset)
+        {
+            result = 2;
+        }
+        else if(memcmp(PatchedVersionAddress(&rom), SC55_PATCH_BYTES, 2) != 0 || memcmp(rom.rom_version_address, original + SC55_MIN_ROM_SIZE - 16, SC55_MODEL_LAYOUTS[rom.rom_model].version_offset) != 0)
+        {
+            result = 2;
+        }
+    }
+
+    for(i = 0; i < num_journals; i++)
+    {
+        FreePatchJournal(&journals[i]);
+    }
+    DestroyROM(&rom);
+    SC55_FREE(expected);
+    SC55_FREE(image);
+    SC55_FREE(original);
+    return result;
+}
@@ -0,0 +1,43 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_SELF_TEST_H
+#define CTF_SELF_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Internal to the CTFPatch program; see CTFSelfTest.c */
+
+int SelfTestSHA256(void);
+
+int SelfTestSHA256Multi(void);
+
+int SelfTestHashIndex(void);
+
+int SelfTestFillKernels(void);
+
+int SelfTestPatchJournal(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTF_SELF_TEST_H */
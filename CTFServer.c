@@ -0,0 +1,706 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "CTFBatch.h"
+#include "CTFPatch.h"
+#include "CTFServer.h"
+
+#ifdef CTF_HAVE_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "CTFWorkPool.h"
+
+/*
+** Request: "CTFD", protocol version, compat mode, drum compat mode,
+** update version, ignore checksum, truncate output, then two reserved
+** zero bytes.  The input and output descriptors travel with it as
+** SCM_RIGHTS.  With truncate output set, the server empties the output
+** once the input has been read and patched, so an existing file is
+** only replaced by a successful patch.
+**
+** Reply: "CTFR", the ROM_JOB_ status and the job's SC55ROMStats: eight
+** 64-bit fields from read_ns to bytes_written, then four 32-bit fields
+** from sub_capital_fills to identified.  Integers are little-endian.
+*/
+#define SERVER_REQUEST_MAGIC "CTFD"
+#define SERVER_REPLY_MAGIC "CTFR"
+#define SERVER_PROTOCOL_VERSION 2
+#define SERVER_REQUEST_SIZE 12
+#define SERVER_REPLY_SIZE 88
+
+/* How long a worker waits for a client that has connected but not sent its request */
+#define SERVER_REQUEST_TIMEOUT 30
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct
+{
+	int connection;
+	const rom_patch_options *options;
+} server_task;
+
+static volatile sig_atomic_t server_stopping = 0;
+
+static void stop_server(int signal_number)
+{
+	(void)signal_number;
+	server_stopping = 1;
+}
+
+static void store_le32(uint8_t *out, uint32_t value)
+{
+	size_t i;
+
+	for(i = 0; i < 4; i++)
+	{
+		out[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+static void store_le64(uint8_t *out, uint64_t value)
+{
+	size_t i;
+
+	for(i = 0; i < 8; i++)
+	{
+		out[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+static uint32_t load_le32(const uint8_t *in)
+{
+	return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static uint64_t load_le64(const uint8_t *in)
+{
+	return (uint64_t)load_le32(in) | ((uint64_t)load_le32(in + 4) << 32);
+}
+
+static int make_socket_address(struct sockaddr_un *address, const char *socket_path)
+{
+	if(strlen(socket_path) >= sizeof(address->sun_path))
+	{
+		return 1;
+	}
+
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	strcpy(address->sun_path, socket_path);
+	return 0;
+}
+
+static int send_all(int fd, const uint8_t *data, size_t length)
+{
+	ssize_t sent;
+
+	while(length > 0)
+	{
+		sent = send(fd, data, length, MSG_NOSIGNAL);
+		if(sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(sent <= 0)
+		{
+			return 1;
+		}
+		data += sent;
+		length -= (size_t)sent;
+	}
+
+	return 0;
+}
+
+static int receive_all(int fd, uint8_t *data, size_t length)
+{
+	ssize_t received;
+
+	while(length > 0)
+	{
+		received = recv(fd, data, length, 0);
+		if(received < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(received <= 0)
+		{
+			return 1;
+		}
+		data += received;
+		length -= (size_t)received;
+	}
+
+	return 0;
+}
+
+/*
+** Receives the request header and exactly two descriptors.  Any
+** descriptors that arrive with a malformed request are closed.
+*/
+static int receive_request(int connection, uint8_t request[SERVER_REQUEST_SIZE], int fds[2])
+{
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(2 * sizeof(int))];
+	} control;
+	struct msghdr message;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	ssize_t received;
+	size_t num_fds = 0;
+	size_t i;
+	int received_fds[2];
+
+	memset(&message, 0, sizeof(message));
+	memset(&control, 0, sizeof(control));
+	iov.iov_base = request;
+	iov.iov_len = SERVER_REQUEST_SIZE;
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+
+	do
+	{
+		received = recvmsg(connection, &message, 0);
+	} while(received < 0 && errno == EINTR);
+
+	if(received <= 0)
+	{
+		return 1;
+	}
+
+	for(cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg))
+	{
+		if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+		{
+			continue;
+		}
+
+		for(i = 0; i < (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int); i++)
+		{
+			if(num_fds < 2)
+			{
+				memcpy(&received_fds[num_fds], CMSG_DATA(cmsg) + (i * sizeof(int)), sizeof(int));
+			}
+			else
+			{
+				int extra_fd;
+
+				memcpy(&extra_fd, CMSG_DATA(cmsg) + (i * sizeof(int)), sizeof(int));
+				close(extra_fd);
+			}
+			num_fds++;
+		}
+	}
+
+	if(num_fds != 2 || (message.msg_flags & MSG_CTRUNC) || ((size_t)received < SERVER_REQUEST_SIZE && receive_all(connection, request + received, SERVER_REQUEST_SIZE - (size_t)received) != 0))
+	{
+		for(i = 0; i < num_fds && i < 2; i++)
+		{
+			close(received_fds[i]);
+		}
+		return 1;
+	}
+
+	fds[0] = received_fds[0];
+	fds[1] = received_fds[1];
+	return 0;
+}
+
+static int serve_request(const uint8_t request[SERVER_REQUEST_SIZE], int input_fd, int output_fd, const rom_patch_options *server_options, SC55ROMStats *stats)
+{
+	rom_patch_options options = *server_options;
+	SC55ReadOptions read_options;
+	SC55ROMData rom_data;
+	FILE *input;
+	FILE *output;
+	uint8_t output_sha256[32];
+	int status = ROM_JOB_OK;
+
+	if(memcmp(request, SERVER_REQUEST_MAGIC, 4) != 0 || request[4] != SERVER_PROTOCOL_VERSION
+		|| (request[5] != SC55_STRICT_SC55_COMPAT && request[5] != SC55_SC55_COMPAT && request[5] != SC55_SC55MKII_COMPAT)
+		|| (request[6] != SC55_DRUM_EARLY_COMPAT && request[6] != SC55_DRUM_LATE_COMPAT))
+	{
+		close(input_fd);
+		close(output_fd);
+		return ROM_JOB_SERVER_FAILED;
+	}
+
+	options.sc55_compat_mode = request[5];
+	options.sc55_drum_compat_mode = request[6];
+	options.update_version = request[7] != 0;
+	options.ignore_checksum = request[8] != 0;
+	options.stats = stats;
+
+	InitReadOptions(&read_options);
+	read_options.ignore_sha256_failures = options.ignore_checksum;
+	read_options.hash_database = options.hash_database;
+	read_options.stats = stats;
+	read_options.buffer_pool = options.buffer_pool;
+
+	input = fdopen(input_fd, "rb");
+	if(input == NULL)
+	{
+		close(input_fd);
+		close(output_fd);
+		return ROM_JOB_READ_FAILED;
+	}
+
+	rom_data = ReadROMStream(input, &read_options);
+	fclose(input);
+
+	if(!rom_data.rom_data)
+	{
+		close(output_fd);
+		return ROM_JOB_READ_FAILED;
+	}
+
+	if(patch_rom_data(&rom_data, &options) != 0)
+	{
+		status = ROM_JOB_PATCH_FAILED;
+	}
+
+	if(status == ROM_JOB_OK && request[9] != 0 && ftruncate(output_fd, 0) != 0)
+	{
+		status = ROM_JOB_WRITE_FAILED;
+	}
+
+	output = fdopen(output_fd, "wb");
+	if(output == NULL)
+	{
+		close(output_fd);
+	}
+
+	if(status == ROM_JOB_OK && (output == NULL || WriteROMStreamWithDigest(&rom_data, output, output_sha256) != 0))
+	{
+		status = ROM_JOB_WRITE_FAILED;
+	}
+
+	if(output != NULL && fclose(output) != 0 && status == ROM_JOB_OK)
+	{
+		status = ROM_JOB_WRITE_FAILED;
+	}
+
+	if(status == ROM_JOB_OK && CheckPatchedDigest(rom_data.rom_sha256, options.sc55_compat_mode, options.sc55_drum_compat_mode, options.update_version, output_sha256) == SC55_PATCHED_DIGEST_MISMATCH)
+	{
+		status = ROM_JOB_VERIFY_FAILED;
+	}
+
+	DestroyROM(&rom_data);
+	return status;
+}
+
+static void run_server_task(void *argument, size_t worker_index)
+{
+	server_task *task = (server_task*)argument;
+	struct timeval timeout;
+	uint8_t request[SERVER_REQUEST_SIZE];
+	uint8_t reply[SERVER_REPLY_SIZE];
+	SC55ROMStats stats;
+	int fds[2];
+	int status;
+
+	(void)worker_index;
+
+	timeout.tv_sec = SERVER_REQUEST_TIMEOUT;
+	timeout.tv_usec = 0;
+	setsockopt(task->connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	InitROMStats(&stats);
+
+	if(receive_request(task->connection, request, fds) != 0)
+	{
+		status = ROM_JOB_SERVER_FAILED;
+	}
+	else
+	{
+		status = serve_request(request, fds[0], fds[1], task->options, &stats);
+	}
+
+	memcpy(reply, SERVER_REPLY_MAGIC, 4);
+	store_le32(reply + 4, (uint32_t)status);
+	store_le64(reply + 8, stats.read_ns);
+	store_le64(reply + 16, stats.hash_ns);
+	store_le64(reply + 24, stats.identify_ns);
+	store_le64(reply + 32, stats.patch_ns);
+	store_le64(reply + 40, stats.write_ns);
+	store_le64(reply + 48, stats.bytes_read);
+	store_le64(reply + 56, stats.bytes_hashed);
+	store_le64(reply + 64, stats.bytes_written);
+	store_le32(reply + 72, stats.sub_capital_fills);
+	store_le32(reply + 76, stats.capital_fills);
+	store_le32(reply + 80, stats.drum_fills);
+	store_le32(reply + 84, stats.identified);
+
+	send_all(task->connection, reply, SERVER_REPLY_SIZE);
+	close(task->connection);
+	free(task);
+}
+
+/* Binds and listens on socket_path, replacing a socket nobody is listening on any more */
+static int open_listening_socket(const char *socket_path)
+{
+	struct sockaddr_un address;
+	struct stat st;
+	int probe;
+	int fd;
+
+	if(make_socket_address(&address, socket_path) != 0)
+	{
+		return -1;
+	}
+
+	if(lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+	{
+		probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(probe >= 0 && connect(probe, (struct sockaddr*)&address, sizeof(address)) != 0 && errno == ECONNREFUSED)
+		{
+			unlink(socket_path);
+		}
+		if(probe >= 0)
+		{
+			close(probe);
+		}
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		return -1;
+	}
+
+	if(bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int run_server(const char *socket_path, const rom_patch_options *options, size_t num_threads)
+{
+	struct sigaction action;
+	sigset_t stop_signals;
+	sigset_t previous_mask;
+	work_pool *pool;
+	server_task *task;
+	int listen_fd;
+	int connection;
+
+	listen_fd = open_listening_socket(socket_path);
+	if(listen_fd < 0)
+	{
+		fprintf(stderr, "Unable to listen on %s: %s\n", socket_path, strerror(errno));
+		return 1;
+	}
+
+	/* Workers inherit a mask blocking the stop signals, so they always interrupt accept() on this thread */
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGINT);
+	sigaddset(&stop_signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_mask);
+
+	pool = work_pool_create(num_threads);
+	if(pool == NULL)
+	{
+		fprintf(stderr, "Unable to start server workers\n");
+		pthread_sigmask(SIG_SETMASK, &previous_mask, NULL);
+		close(listen_fd);
+		unlink(socket_path);
+		return 1;
+	}
+
+	memset(&action, 0, sizeof(action));
+	sigemptyset(&action.sa_mask);
+	action.sa_handler = stop_server;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &action, NULL);
+
+	pthread_sigmask(SIG_SETMASK, &previous_mask, NULL);
+
+	printf("Serving on %s with %lu workers\n", socket_path, (unsigned long)work_pool_size(pool));
+	fflush(stdout);
+
+	while(!server_stopping)
+	{
+		connection = accept(listen_fd, NULL, NULL);
+		if(connection < 0)
+		{
+			if(errno != EINTR && errno != ECONNABORTED)
+			{
+				fprintf(stderr, "Unable to accept connections: %s\n", strerror(errno));
+				break;
+			}
+			continue;
+		}
+
+		task = (server_task*)malloc(sizeof(server_task));
+		if(task == NULL)
+		{
+			close(connection);
+			continue;
+		}
+
+		task->connection = connection;
+		task->options = options;
+		if(work_pool_submit(pool, run_server_task, task) != 0)
+		{
+			close(connection);
+			free(task);
+		}
+	}
+
+	close(listen_fd);
+	unlink(socket_path);
+
+	/* Requests already accepted are finished before exiting */
+	work_pool_wait(pool);
+	work_pool_destroy(pool);
+
+	printf("Server stopped\n");
+	return 0;
+}
+
+int patch_rom_remote(const char *socket_path, const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress)
+{
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(2 * sizeof(int))];
+	} control;
+	struct sockaddr_un address;
+	struct msghdr message;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	uint8_t request[SERVER_REQUEST_SIZE];
+	uint8_t reply[SERVER_REPLY_SIZE];
+	int fds[2];
+	int use_stdin = strcmp(input_rom_path, ROM_PATH_STDIO) == 0;
+	int use_stdout = strcmp(output_rom_path, ROM_PATH_STDIO) == 0;
+	int created_output = 0;
+	struct stat input_stat;
+	struct stat output_stat;
+	int connection;
+	int status;
+
+	if(make_socket_address(&address, socket_path) != 0)
+	{
+		return ROM_JOB_SERVER_UNAVAILABLE;
+	}
+
+	connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(connection < 0)
+	{
+		return ROM_JOB_SERVER_UNAVAILABLE;
+	}
+
+	if(connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0)
+	{
+		close(connection);
+		return ROM_JOB_SERVER_UNAVAILABLE;
+	}
+
+	fds[0] = use_stdin ? STDIN_FILENO : open(input_rom_path, O_RDONLY);
+	if(fds[0] < 0)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Unable to read ROM data from %s\n", input_rom_path);
+		}
+		close(connection);
+		return ROM_JOB_READ_FAILED;
+	}
+
+	/* Patching a file in place is left to the local path, which reads the whole input before writing */
+	if(!use_stdout && fstat(fds[0], &input_stat) == 0 && stat(output_rom_path, &output_stat) == 0
+		&& input_stat.st_dev == output_stat.st_dev && input_stat.st_ino == output_stat.st_ino)
+	{
+		if(!use_stdin)
+		{
+			close(fds[0]);
+		}
+		close(connection);
+		return ROM_JOB_SERVER_SKIPPED;
+	}
+
+	if(progress)
+	{
+		fprintf(progress, "Patching ROM on server %s...\n", socket_path);
+	}
+
+	if(use_stdout)
+	{
+		fflush(stdout);
+	}
+
+	/* An existing output is not truncated here, so a failed request leaves it as it was */
+	if(use_stdout)
+	{
+		fds[1] = STDOUT_FILENO;
+	}
+	else
+	{
+		/* An output hardlinked to others is replaced, since the server rewrites what it is given in place */
+		fds[1] = unshare_output(output_rom_path) == 0 ? open(output_rom_path, O_WRONLY | O_CREAT | O_EXCL, 0666) : -1;
+		if(fds[1] >= 0)
+		{
+			created_output = 1;
+		}
+		else if(errno == EEXIST)
+		{
+			fds[1] = open(output_rom_path, O_WRONLY);
+		}
+	}
+
+	if(fds[1] < 0)
+	{
+		if(progress)
+		{
+			fprintf(progress, "Error writing ROM to %s\n", output_rom_path);
+		}
+		if(!use_stdin)
+		{
+			close(fds[0]);
+		}
+		close(connection);
+		return ROM_JOB_WRITE_FAILED;
+	}
+
+	memset(request, 0, sizeof(request));
+	memcpy(request, SERVER_REQUEST_MAGIC, 4);
+	request[4] = SERVER_PROTOCOL_VERSION;
+	request[5] = options->sc55_compat_mode;
+	request[6] = options->sc55_drum_compat_mode;
+	request[7] = options->update_version;
+	request[8] = options->ignore_checksum;
+	request[9] = !use_stdout;
+
+	memset(&message, 0, sizeof(message));
+	memset(&control, 0, sizeof(control));
+	iov.iov_base = request;
+	iov.iov_len = SERVER_REQUEST_SIZE;
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+
+	cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, 2 * sizeof(int));
+
+	/* The server holds its own copies of the descriptors once they are sent */
+	if(sendmsg(connection, &message, MSG_NOSIGNAL) != SERVER_REQUEST_SIZE || receive_all(connection, reply, SERVER_REPLY_SIZE) != 0 || memcmp(reply, SERVER_REPLY_MAGIC, 4) != 0)
+	{
+		status = ROM_JOB_SERVER_FAILED;
+	}
+	else
+	{
+		status = (int)load_le32(reply + 4);
+	}
+
+	if(!use_stdin)
+	{
+		close(fds[0]);
+	}
+	if(!use_stdout)
+	{
+		close(fds[1]);
+	}
+	close(connection);
+
+	/* Outputs that fail verification are kept for inspection, as when patching locally, and files the client did not create are never removed */
+	if(status != ROM_JOB_OK && status != ROM_JOB_VERIFY_FAILED && created_output)
+	{
+		remove(output_rom_path);
+	}
+
+	if(status != ROM_JOB_SERVER_FAILED && options->stats)
+	{
+		options->stats->read_ns += load_le64(reply + 8);
+		options->stats->hash_ns += load_le64(reply + 16);
+		options->stats->identify_ns += load_le64(reply + 24);
+		options->stats->patch_ns += load_le64(reply + 32);
+		options->stats->write_ns += load_le64(reply + 40);
+		options->stats->bytes_read += load_le64(reply + 48);
+		options->stats->bytes_hashed += load_le64(reply + 56);
+		options->stats->bytes_written += load_le64(reply + 64);
+		options->stats->sub_capital_fills += load_le32(reply + 72);
+		options->stats->capital_fills += load_le32(reply + 76);
+		options->stats->drum_fills += load_le32(reply + 80);
+		options->stats->identified += load_le32(reply + 84);
+	}
+
+	if(progress)
+	{
+		if(status == ROM_JOB_OK)
+		{
+			fprintf(progress, "ROM written successfully.\n");
+		}
+		else
+		{
+			fprintf(progress, "Server could not patch %s: %s\n", input_rom_path, rom_job_status_string(status));
+		}
+	}
+
+	return status;
+}
+#else
+int run_server(const char *socket_path, const rom_patch_options *options, size_t num_threads)
+{
+	(void)socket_path;
+	(void)options;
+	(void)num_threads;
+	fprintf(stderr, "The patch server is not supported on this platform.\n");
+	return 1;
+}
+
+/* Without Unix sockets there is never a server to reach, so callers patch locally */
+int patch_rom_remote(const char *socket_path, const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress)
+{
+	(void)socket_path;
+	(void)input_rom_path;
+	(void)output_rom_path;
+	(void)options;
+	(void)progress;
+	return ROM_JOB_SERVER_UNAVAILABLE;
+}
+#endif
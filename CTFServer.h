@@ -0,0 +1,66 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_SERVER_H
+#define CTF_SERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "CTFBatch.h"
+
+/*
+** A long-lived patch server on a Unix domain socket.  Each connection
+** carries one request: a small header with the compatibility modes,
+** plus the client's input and output file descriptors passed with
+** SCM_RIGHTS, so ROM data never travels over the socket.  The server
+** reads the input descriptor, patches, writes the whole image to the
+** output descriptor and replies with a status and the job's stats.
+*/
+
+/*
+** Serves requests on socket_path with a pool of num_threads workers (0
+** for one per core) until SIGINT or SIGTERM.  The hash database and
+** cache directory of options are shared by every request; the modes,
+** checksum and version settings come from each request.  A stale socket
+** left by a previous server is replaced.  Returns 0 on a clean shutdown.
+*/
+int run_server(const char *socket_path, const rom_patch_options *options, size_t num_threads);
+
+/*
+** Has the server on socket_path patch one ROM, with the same paths as
+** patch_rom_file (including "-" for stdin and stdout).  Stats returned
+** by the server are added to options->stats.  Returns a ROM_JOB_ status,
+** ROM_JOB_SERVER_UNAVAILABLE if no server answers, or
+** ROM_JOB_SERVER_SKIPPED if the input and output are the same file, in
+** which case nothing has been written and the ROM should be patched
+** locally.  An existing output is only replaced once the server has
+** read and patched the input, and is never removed.
+*/
+int patch_rom_remote(const char *socket_path, const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTF_SERVER_H */
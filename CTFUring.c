@@ -0,0 +1,449 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CTFUring.h"
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* IORING_FEAT_RW_CUR_POS arrived in the same headers as the openat and close operations */
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+
+struct io_ring
+{
+	int fd;
+	void *sq_map;
+	size_t sq_map_size;
+	void *cq_map;
+	size_t cq_map_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned sq_mask;
+	unsigned sq_entries;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+	/* Entries queued since the last submit */
+	unsigned pending;
+	/* Entries queued whose completion has not been taken */
+	unsigned in_flight;
+};
+
+static int ring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/* Checks that the kernel knows every operation the ring is used for */
+static int ring_supports_operations(int fd)
+{
+	static const unsigned char needed[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE };
+	struct io_uring_probe *probe;
+	size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+	size_t i;
+	int supported = 1;
+
+	probe = (struct io_uring_probe*)calloc(1, probe_size);
+	if(probe == NULL)
+	{
+		return 0;
+	}
+
+	if(syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+	{
+		free(probe);
+		return 0;
+	}
+
+	for(i = 0; i < sizeof(needed); i++)
+	{
+		if(needed[i] > probe->last_op || !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED))
+		{
+			supported = 0;
+		}
+	}
+
+	free(probe);
+	return supported;
+}
+
+io_ring *io_ring_create(unsigned entries)
+{
+	struct io_uring_params params;
+	io_ring *ring;
+	char *sq;
+	char *cq;
+
+	ring = (io_ring*)calloc(1, sizeof(io_ring));
+	if(ring == NULL)
+	{
+		return NULL;
+	}
+
+	memset(&params, 0, sizeof(params));
+	ring->fd = ring_setup(entries, &params);
+	if(ring->fd < 0)
+	{
+		free(ring);
+		return NULL;
+	}
+
+	ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(ring->cq_map_size > ring->sq_map_size)
+		{
+			ring->sq_map_size = ring->cq_map_size;
+		}
+		ring->cq_map_size = ring->sq_map_size;
+	}
+
+	ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if(ring->sq_map == MAP_FAILED)
+	{
+		close(ring->fd);
+		free(ring);
+		return NULL;
+	}
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		ring->cq_map = ring->sq_map;
+	}
+	else
+	{
+		ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if(ring->cq_map == MAP_FAILED)
+		{
+			munmap(ring->sq_map, ring->sq_map_size);
+			close(ring->fd);
+			free(ring);
+			return NULL;
+		}
+	}
+
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED)
+	{
+		ring->sqes = NULL;
+		io_ring_destroy(ring);
+		return NULL;
+	}
+
+	sq = (char*)ring->sq_map;
+	cq = (char*)ring->cq_map;
+	ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sq_entries = params.sq_entries;
+	ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	if(!ring_supports_operations(ring->fd))
+	{
+		io_ring_destroy(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+void io_ring_destroy(io_ring *ring)
+{
+	if(ring == NULL)
+	{
+		return;
+	}
+
+	if(ring->sqes)
+	{
+		munmap(ring->sqes, ring->sqes_size);
+	}
+	if(ring->cq_map != ring->sq_map)
+	{
+		munmap(ring->cq_map, ring->cq_map_size);
+	}
+	munmap(ring->sq_map, ring->sq_map_size);
+	close(ring->fd);
+	free(ring);
+}
+
+/* Returns a cleared entry at the tail of the submission queue, or NULL if it is full */
+static struct io_uring_sqe *next_entry(io_ring *ring)
+{
+	unsigned tail = *ring->sq_tail;
+	struct io_uring_sqe *sqe;
+
+	if(tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+	{
+		return NULL;
+	}
+
+	sqe = &ring->sqes[tail & ring->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	return sqe;
+}
+
+/* Publishes the entry next_entry() returned, so the kernel sees it on the next submit */
+static int queue_entry(io_ring *ring, struct io_uring_sqe *sqe, uint64_t user_data)
+{
+	unsigned tail = *ring->sq_tail;
+
+	sqe->user_data = user_data;
+	ring->sq_array[tail & ring->sq_mask] = (unsigned)(sqe - ring->sqes);
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring->pending++;
+	ring->in_flight++;
+	return 0;
+}
+
+int io_ring_openat(io_ring *ring, const char *path, int flags, unsigned mode, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe = next_entry(ring);
+
+	if(sqe == NULL)
+	{
+		return -1;
+	}
+
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uint64_t)(uintptr_t)path;
+	sqe->len = mode;
+	sqe->open_flags = (uint32_t)flags;
+	return queue_entry(ring, sqe, user_data);
+}
+
+static int queue_transfer(io_ring *ring, uint8_t opcode, int fd, const void *buffer, size_t length, uint64_t offset, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe = next_entry(ring);
+
+	if(sqe == NULL)
+	{
+		return -1;
+	}
+
+	/* A single operation moves at most 2 GiB; callers continue from a short count */
+	if(length > 0x7ffff000)
+	{
+		length = 0x7ffff000;
+	}
+
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buffer;
+	sqe->len = (uint32_t)length;
+	sqe->off = offset;
+	return queue_entry(ring, sqe, user_data);
+}
+
+int io_ring_read(io_ring *ring, int fd, void *buffer, size_t length, uint64_t offset, uint64_t user_data)
+{
+	return queue_transfer(ring, IORING_OP_READ, fd, buffer, length, offset, user_data);
+}
+
+int io_ring_write(io_ring *ring, int fd, const void *buffer, size_t length, uint64_t offset, uint64_t user_data)
+{
+	return queue_transfer(ring, IORING_OP_WRITE, fd, buffer, length, offset, user_data);
+}
+
+int io_ring_close(io_ring *ring, int fd, uint64_t user_data)
+{
+	struct io_uring_sqe *sqe = next_entry(ring);
+
+	if(sqe == NULL)
+	{
+		return -1;
+	}
+
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	return queue_entry(ring, sqe, user_data);
+}
+
+int io_ring_submit(io_ring *ring, unsigned wait_for)
+{
+	int submitted;
+
+	while(ring->pending > 0 || wait_for > 0)
+	{
+		submitted = ring_enter(ring->fd, ring->pending, wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+		if(submitted < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+
+		ring->pending -= (unsigned)submitted;
+		if(ring->pending == 0)
+		{
+			break;
+		}
+	}
+
+	return 0;
+}
+
+int io_ring_complete(io_ring *ring, uint64_t *user_data, int32_t *result)
+{
+	unsigned head = *ring->cq_head;
+	struct io_uring_cqe *cqe;
+
+	if(head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+	{
+		return 0;
+	}
+
+	cqe = &ring->cqes[head & ring->cq_mask];
+	*user_data = cqe->user_data;
+	*result = cqe->res;
+	__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+	ring->in_flight--;
+	return 1;
+}
+
+int io_ring_drain(io_ring *ring)
+{
+	uint64_t user_data;
+	int32_t result;
+
+	while(ring->in_flight > 0)
+	{
+		if(io_ring_submit(ring, 1) != 0)
+		{
+			return -1;
+		}
+
+		while(io_ring_complete(ring, &user_data, &result))
+		{
+			(void)user_data;
+		}
+	}
+
+	return 0;
+}
+
+#else
+
+/* Without io_uring every ring fails to start, and callers use blocking I/O */
+io_ring *io_ring_create(unsigned entries)
+{
+	(void)entries;
+	return NULL;
+}
+
+void io_ring_destroy(io_ring *ring)
+{
+	(void)ring;
+}
+
+int io_ring_openat(io_ring *ring, const char *path, int flags, unsigned mode, uint64_t user_data)
+{
+	(void)ring;
+	(void)path;
+	(void)flags;
+	(void)mode;
+	(void)user_data;
+	return -1;
+}
+
+int io_ring_read(io_ring *ring, int fd, void *buffer, size_t length, uint64_t offset, uint64_t user_data)
+{
+	(void)ring;
+	(void)fd;
+	(void)buffer;
+	(void)length;
+	(void)offset;
+	(void)user_data;
+	return -1;
+}
+
+int io_ring_write(io_ring *ring, int fd, const void *buffer, size_t length, uint64_t offset, uint64_t user_data)
+{
+	(void)ring;
+	(void)fd;
+	(void)buffer;
+	(void)length;
+	(void)offset;
+	(void)user_data;
+	return -1;
+}
+
+int io_ring_close(io_ring *ring, int fd, uint64_t user_data)
+{
+	(void)ring;
+	(void)fd;
+	(void)user_data;
+	return -1;
+}
+
+int io_ring_submit(io_ring *ring, unsigned wait_for)
+{
+	(void)ring;
+	(void)wait_for;
+	return -1;
+}
+
+int io_ring_complete(io_ring *ring, uint64_t *user_data, int32_t *result)
+{
+	(void)ring;
+	(void)user_data;
+	(void)result;
+	return 0;
+}
+
+int io_ring_drain(io_ring *ring)
+{
+	(void)ring;
+	return -1;
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_URING_H
+#define CTF_URING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+** A minimal io_uring ring driven through the raw system calls, so no
+** liburing is needed.  Operations are queued with the io_ring_ calls,
+** which return -1 when the submission queue is full, and only reach the
+** kernel on the next io_ring_submit(), so everything queued between two
+** submits goes in with one system call.  Each completion carries the
+** user_data it was queued with and the operation's result, a negative
+** errno on failure.  A ring belongs to one thread.
+*/
+typedef struct io_ring io_ring;
+
+/*
+** Sets up a ring with room for entries queued operations.  Returns NULL
+** when io_uring is unavailable, including kernels that lack the openat,
+** read, write and close operations and sandboxes that block the system
+** calls, so callers can fall back to blocking I/O.
+*/
+io_ring *io_ring_create(unsigned entries);
+
+void io_ring_destroy(io_ring *ring);
+
+int io_ring_openat(io_ring *ring, const char *path, int flags, unsigned mode, uint64_t user_data);
+
+int io_ring_read(io_ring *ring, int fd, void *buffer, size_t length, uint64_t offset, uint64_t user_data);
+
+int io_ring_write(io_ring *ring, int fd, const void *buffer, size_t length, uint64_t offset, uint64_t user_data);
+
+int io_ring_close(io_ring *ring, int fd, uint64_t user_data);
+
+/* Submits everything queued and waits until at least wait_for completions are ready; returns 0 on success */
+int io_ring_submit(io_ring *ring, unsigned wait_for);
+
+/* Takes the next completion if there is one, returning 1, or 0 if none is ready */
+int io_ring_complete(io_ring *ring, uint64_t *user_data, int32_t *result);
+
+/* Submits everything queued and waits for every operation to finish, discarding the completions */
+int io_ring_drain(io_ring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTF_URING_H */
@@ -0,0 +1,331 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "CTFWorkPool.h"
+
+typedef struct
+{
+	work_pool_task task;
+	void *argument;
+} work_item;
+
+/* Ring buffer of tasks; the owner pushes and pops at the tail, thieves take from the head */
+typedef struct
+{
+	pthread_mutex_t lock;
+	work_item *items;
+	size_t capacity;
+	size_t head;
+	size_t count;
+} work_deque;
+
+typedef struct
+{
+	work_pool *pool;
+	size_t index;
+	pthread_t thread;
+} work_worker;
+
+struct work_pool
+{
+	size_t num_workers;
+	size_t num_threads;
+	work_deque *deques;
+	work_worker *workers;
+
+	/* queued counts tasks sitting in deques, pending counts tasks not yet finished */
+	pthread_mutex_t lock;
+	pthread_cond_t work_available;
+	pthread_cond_t work_done;
+	size_t queued;
+	size_t pending;
+	size_t next_worker;
+	int shutting_down;
+};
+
+static int deque_push(work_deque *deque, const work_item item)
+{
+	work_item *items;
+	size_t capacity;
+	size_t i;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if(deque->count == deque->capacity)
+	{
+		capacity = deque->capacity ? deque->capacity * 2 : 64;
+		items = (work_item*)malloc(capacity * sizeof(work_item));
+		if(items == NULL)
+		{
+			pthread_mutex_unlock(&deque->lock);
+			return 1;
+		}
+
+		for(i = 0; i < deque->count; i++)
+		{
+			items[i] = deque->items[(deque->head + i) % deque->capacity];
+		}
+
+		free(deque->items);
+		deque->items = items;
+		deque->capacity = capacity;
+		deque->head = 0;
+	}
+
+	deque->items[(deque->head + deque->count) % deque->capacity] = item;
+	deque->count++;
+
+	pthread_mutex_unlock(&deque->lock);
+	return 0;
+}
+
+static int deque_pop_tail(work_deque *deque, work_item *item)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->count > 0)
+	{
+		deque->count--;
+		*item = deque->items[(deque->head + deque->count) % deque->capacity];
+		found = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+static int deque_steal_head(work_deque *deque, work_item *item)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->count > 0)
+	{
+		*item = deque->items[deque->head];
+		deque->head = (deque->head + 1) % deque->capacity;
+		deque->count--;
+		found = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+static void *worker_main(void *argument)
+{
+	work_worker *worker = (work_worker*)argument;
+	work_pool *pool = worker->pool;
+	work_item item;
+	size_t victim;
+	size_t i;
+	int found;
+
+	for(;;)
+	{
+		/* Reserve one queued task; it is guaranteed to be in some deque */
+		pthread_mutex_lock(&pool->lock);
+		while(pool->queued == 0 && !pool->shutting_down)
+		{
+			pthread_cond_wait(&pool->work_available, &pool->lock);
+		}
+
+		if(pool->queued == 0)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+
+		pool->queued--;
+		pthread_mutex_unlock(&pool->lock);
+
+		found = deque_pop_tail(&pool->deques[worker->index], &item);
+		while(!found)
+		{
+			for(i = 1; i <= pool->num_workers && !found; i++)
+			{
+				victim = (worker->index + i) % pool->num_workers;
+				found = deque_steal_head(&pool->deques[victim], &item);
+			}
+		}
+
+		item.task(item.argument, worker->index);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+		if(pool->pending == 0)
+		{
+			pthread_cond_broadcast(&pool->work_done);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+size_t work_pool_core_count(void)
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cores > 0 ? (size_t)cores : 1;
+}
+
+work_pool *work_pool_create(size_t num_workers)
+{
+	work_pool *pool;
+	size_t i;
+
+	if(num_workers == 0)
+	{
+		num_workers = work_pool_core_count();
+	}
+
+	pool = (work_pool*)calloc(1, sizeof(work_pool));
+	if(pool == NULL)
+	{
+		return NULL;
+	}
+
+	pool->num_workers = num_workers;
+	pool->deques = (work_deque*)calloc(num_workers, sizeof(work_deque));
+	pool->workers = (work_worker*)calloc(num_workers, sizeof(work_worker));
+	if(pool->deques == NULL || pool->workers == NULL)
+	{
+		free(pool->deques);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_available, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+
+	for(i = 0; i < num_workers; i++)
+	{
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+	}
+
+	for(i = 0; i < num_workers; i++)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		if(pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0)
+		{
+			break;
+		}
+		pool->num_threads++;
+	}
+
+	if(pool->num_threads != num_workers)
+	{
+		/* Let the threads that did start see the shutdown, then tear everything down */
+		work_pool_destroy(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+size_t work_pool_size(const work_pool *pool)
+{
+	return pool->num_workers;
+}
+
+int work_pool_submit_to(work_pool *pool, size_t worker_index, work_pool_task task, void *argument)
+{
+	work_item item;
+
+	item.task = task;
+	item.argument = argument;
+
+	if(deque_push(&pool->deques[worker_index % pool->num_workers], item) != 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->queued++;
+	pool->pending++;
+	pthread_cond_signal(&pool->work_available);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+int work_pool_submit(work_pool *pool, work_pool_task task, void *argument)
+{
+	size_t worker_index;
+
+	pthread_mutex_lock(&pool->lock);
+	worker_index = pool->next_worker;
+	pool->next_worker = (pool->next_worker + 1) % pool->num_workers;
+	pthread_mutex_unlock(&pool->lock);
+
+	return work_pool_submit_to(pool, worker_index, task, argument);
+}
+
+void work_pool_wait(work_pool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	while(pool->pending > 0)
+	{
+		pthread_cond_wait(&pool->work_done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void work_pool_destroy(work_pool *pool)
+{
+	size_t i;
+
+	if(pool == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutting_down = 1;
+	pthread_cond_broadcast(&pool->work_available);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(i = 0; i < pool->num_threads; i++)
+	{
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+
+	for(i = 0; i < pool->num_workers; i++)
+	{
+		free(pool->deques[i].items);
+		pthread_mutex_destroy(&pool->deques[i].lock);
+	}
+
+	pthread_cond_destroy(&pool->work_done);
+	pthread_cond_destroy(&pool->work_available);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->deques);
+	free(pool->workers);
+	free(pool);
+}
@@ -0,0 +1,62 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CTF_WORK_POOL_H
+#define CTF_WORK_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/*
+** A fixed-size pool of worker threads with one deque per worker.  A
+** worker runs its own newest task first and, when its deque is empty,
+** steals the oldest task from another worker.  Tasks may submit further
+** tasks; work_pool_wait() returns once every task, including those,
+** has finished.
+*/
+typedef struct work_pool work_pool;
+
+/* worker_index identifies the worker running the task, in [0, work_pool_size()) */
+typedef void (*work_pool_task)(void *argument, size_t worker_index);
+
+size_t work_pool_core_count(void);
+
+/* num_workers of 0 means one worker per online core */
+work_pool *work_pool_create(size_t num_workers);
+
+size_t work_pool_size(const work_pool *pool);
+
+/* Queues a task on the next worker in turn */
+int work_pool_submit(work_pool *pool, work_pool_task task, void *argument);
+
+/* Queues a task on the given worker's deque; tasks use this with their own worker_index */
+int work_pool_submit_to(work_pool *pool, size_t worker_index, work_pool_task task, void *argument);
+
+void work_pool_wait(work_pool *pool);
+
+void work_pool_destroy(work_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTF_WORK_POOL_H */
@@ -25,10 +25,11 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct
 {
-    const char sha256hash[64];
+    const char sha256hash[65];
     const size_t file_size;
     const char rom_name[128];
     const size_t version_address;
@@ -39,6 +40,43 @@ static const SC55Hash SC55_HASHES[] = {
     {"2e138479101452f7e331f95dd7be9232df6dda317c8fd38b6d71243c210c5e6d", 524288, "XP-10 1.02", 0x4405d}
 };
 
+/*
+** Binary copies of the digests above, sorted by digest for binary
+** search, with the index of the matching SC55_HASHES entry.  Keep this
+** in step with SC55_HASHES; CTFPatch -t checks that it is.
+*/
+typedef struct
+{
+    const uint8_t sha256[32];
+    const size_t hash_index;
+} SC55HashIndexEntry;
+
+static const SC55HashIndexEntry SC55_HASH_INDEX[] = {
+    {{0x2e, 0x13, 0x84, 0x79, 0x10, 0x14, 0x52, 0xf7, 0xe3, 0x31, 0xf9, 0x5d, 0xd7, 0xbe, 0x92, 0x32, 0xdf, 0x6d, 0xda, 0x31, 0x7c, 0x8f, 0xd3, 0x8b, 0x6d, 0x71, 0x24, 0x3c, 0x21, 0x0c, 0x5e, 0x6d}, 1},
+    {{0xa4, 0xc9, 0xfd, 0x82, 0x10, 0x59, 0x05, 0x4c, 0x7e, 0x76, 0x81, 0xd6, 0x1f, 0x49, 0xce, 0x6f, 0x42, 0xed, 0x2f, 0xe4, 0x07, 0xa7, 0xec, 0x1b, 0xa0, 0xdf, 0xdc, 0x97, 0x22, 0x58, 0x2c, 0xe0}, 0}
+};
+
+/*
+** Expected digests of patched known ROMs, by the digest of the original
+** ROM and the compatibility, drum compatibility and version options the
+** patch was made with.  Outputs are checked against these as they are
+** written.  Entries are generated from real dumps with
+** CTFPatch --patched-hashes -i ROM, and the list ends with an entry
+** whose source digest is empty.
+*/
+typedef struct
+{
+    const char source_sha256hash[65];
+    const uint8_t compat_mode;
+    const uint8_t drum_compat_mode;
+    const uint8_t update_version;
+    const char patched_sha256hash[65];
+} SC55PatchedHash;
+
+static const SC55PatchedHash SC55_PATCHED_HASHES[] = {
+    {"", 0, 0, 0, ""}
+};
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,671 @@
+/* Generated by gen_tone_map from SC55Tones.h.  Do not edit; run make to regenerate. */
+
+#ifndef SC55TONEMAP_H
+#define SC55TONEMAP_H
+
+#include <stdint.h>
+
+#define SC55_TONE_MAP_BANKS 64
+
+#define SC55_TONE_PLAN_STRICT 0
+#define SC55_TONE_PLAN_SC55 1
+#define SC55_TONE_PLAN_MKII 2
+
+/* Bit (bank % 8) of byte (bank / 8) is set when the program has a tone in that bank */
+static const uint8_t SC55_TONE_MEMBERSHIP[128][16] = {
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0xff, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+    {0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80}
+};
+
+/*
+** Per-bank program masks, with bit (prog % 64) of word (prog / 64) for
+** each program.  An empty cell, or any cell in force, is replaced when
+** fill is set: by the tone in bank (bank & 0x78) if use_group is set and
+** that tone exists, otherwise by the capital tone in bank 0.
+*/
+typedef struct
+{
+    uint64_t use_group[SC55_TONE_MAP_BANKS][2];
+    uint64_t force[SC55_TONE_MAP_BANKS][2];
+} SC55TonePlan;
+
+static const uint64_t SC55_TONE_FILL[2] = {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)};
+
+static const SC55TonePlan SC55_TONE_PLANS[3] = {
+    /* strict */
+    {
+        {
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0xe00500c0df2b4070), UINT64_C(0x0078080000010000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000002000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)}
+        },
+        {
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0x1ffaff3f20d4bf8f), UINT64_C(0x0087f7fffffeffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xfffffffffdffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)}
+        }
+    },
+    /* sc55 */
+    {
+        {
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0xe00500c0df2b4070), UINT64_C(0x0078080000010000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000002000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)}
+        },
+        {
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)}
+        }
+    },
+    /* mkii */
+    {
+        {
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)},
+            {UINT64_C(0xffffffffffffffff), UINT64_C(0x00ffffffffffffff)}
+        },
+        {
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)},
+            {UINT64_C(0x0000000000000000), UINT64_C(0x0000000000000000)}
+        }
+    }
+};
+
+/* Byte ranges patch ops apply to; the version region starts at the bytes a model replaces */
+#define SC55_PATCH_REGION_TONES 0
+#define SC55_PATCH_REGION_DRUMS 1
+#define SC55_PATCH_REGION_VERSION 2
+#define SC55_PATCH_REGIONS 3
+
+/*
+** Each op covers length bytes at offset into its region.  FILL_TONES
+** runs tone plan arg over a whole tone table, FILL_GROUPS replaces 0xff
+** bytes with the first byte of their arg-byte group, and COPY writes
+** SC55_PATCH_BYTES starting at index arg.
+*/
+#define SC55_PATCH_OP_FILL_TONES 0
+#define SC55_PATCH_OP_FILL_GROUPS 1
+#define SC55_PATCH_OP_COPY 2
+
+#define SC55_PATCH_DRUM_EARLY 0
+#define SC55_PATCH_DRUM_LATE 1
+
+#define SC55_NUM_MODELS 1
+#define SC55_MIN_ROM_SIZE 0x38080
+#define SC55_MAX_PATCH_OPS 3
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t region;
+    uint16_t arg;
+    uint32_t offset;
+    uint32_t length;
+} SC55PatchOp;
+
+typedef struct
+{
+    uint32_t num_ops;
+    SC55PatchOp ops[SC55_MAX_PATCH_OPS];
+} SC55PatchProgram;
+
+/* late_data_offset is also the smallest ROM with the layout; parsing takes the first layout that fits */
+typedef struct
+{
+    const char *name;
+    uint32_t tone_table_offset;
+    uint32_t drum_table_offset;
+    uint32_t late_data_offset;
+    uint32_t version_offset;
+} SC55ModelLayout;
+
+static const SC55ModelLayout SC55_MODEL_LAYOUTS[SC55_NUM_MODELS] = {
+    {"SC-55 mkII", 0x30000, 0x38000, 0x38080, 2}
+};
+
+static const uint8_t SC55_PATCH_BYTES[2] = {0x43, 0x54};
+
+/* Indexed by model, tone plan, SC55_PATCH_DRUM_ mode and whether the version is updated */
+static const SC55PatchProgram SC55_PATCH_PROGRAMS[SC55_NUM_MODELS][3][2][2] = {
+    /* SC-55 mkII */
+    {
+        {
+            {
+                /* strict, early drums */
+                {2, {{0, 0, 0, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x40}}},
+                /* strict, early drums, version updated */
+                {3, {{0, 0, 0, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x40}, {2, 2, 0, 0x0, 0x2}}}
+            },
+            {
+                /* strict, late drums */
+                {2, {{0, 0, 0, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x30}}},
+                /* strict, late drums, version updated */
+                {3, {{0, 0, 0, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x30}, {2, 2, 0, 0x0, 0x2}}}
+            }
+        },
+        {
+            {
+                /* sc55, early drums */
+                {2, {{0, 0, 1, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x40}}},
+                /* sc55, early drums, version updated */
+                {3, {{0, 0, 1, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x40}, {2, 2, 0, 0x0, 0x2}}}
+            },
+            {
+                /* sc55, late drums */
+                {2, {{0, 0, 1, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x30}}},
+                /* sc55, late drums, version updated */
+                {3, {{0, 0, 1, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x30}, {2, 2, 0, 0x0, 0x2}}}
+            }
+        },
+        {
+            {
+                /* mkii, early drums */
+                {2, {{0, 0, 2, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x40}}},
+                /* mkii, early drums, version updated */
+                {3, {{0, 0, 2, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x40}, {2, 2, 0, 0x0, 0x2}}}
+            },
+            {
+                /* mkii, late drums */
+                {2, {{0, 0, 2, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x30}}},
+                /* mkii, late drums, version updated */
+                {3, {{0, 0, 2, 0x0, 0x4000}, {1, 1, 8, 0x0, 0x30}, {2, 2, 0, 0x0, 0x2}}}
+            }
+        }
+    }
+};
+
+#endif /* SC55TONEMAP_H */
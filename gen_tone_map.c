@@ -0,0 +1,359 @@
+/*
+** Copyright 2025 Christopher Gelatt
+**
+** This program is free software: you can redistribute it
+** and/or modify it under the terms of the
+** GNU Lesser General Public License as published by the
+** Free Software Foundation, either version 3 of the License,
+** or (at your option) any later version.
+**
+** This program is distributed in the hope that it will be
+** useful, but WITHOUT ANY WARRANTY; without even the implied
+** warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+** See the GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the
+** GNU Lesser General Public License along with this program.
+** If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+** Build-time generator for SC55ToneMap.h.  It turns the named tone lists
+** in SC55Tones.h into a bitset of which banks exist for each program and
+** into one fallback plan per compatibility mode, so patching never has
+** to search the tone lists.  It also compiles the model descriptors
+** below into a flat patch program for every combination of modes, so
+** the patcher runs a short list of ops instead of branching on the
+** model and modes itself.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SC55Tones.h"
+
+/* Banks 64 and up are for special use, and programs 121 and up are sound effects */
+#define PATCHED_BANKS 64
+#define PATCHED_PROGS 120
+
+#define PLAN_STRICT 0
+#define PLAN_SC55 1
+#define PLAN_MKII 2
+#define NUM_PLANS 3
+
+#define DRUM_EARLY 0
+#define DRUM_LATE 1
+#define NUM_DRUM_MODES 2
+
+#define REGION_TONES 0
+#define REGION_DRUMS 1
+#define REGION_VERSION 2
+
+#define OP_FILL_TONES 0
+#define OP_FILL_GROUPS 1
+#define OP_COPY 2
+#define MAX_OPS 3
+
+/*
+** Where a model keeps the tables that get patched and how its drum
+** table and version string are patched.  The tone table is always
+** SC55_TONE_MAP_BANKS rows of 128 two-byte tones, following the plans
+** built from SC55Tones.h.  late_data_offset is the first byte past the
+** tables, so it is also the smallest ROM that can hold the layout.
+*/
+typedef struct
+{
+    const char *name;
+    size_t tone_table_offset;
+    size_t drum_table_offset;
+    size_t late_data_offset;
+    size_t drum_group_size;
+    size_t drum_slots[NUM_DRUM_MODES];
+    size_t version_offset;
+    const char *version_bytes;
+} ModelDescriptor;
+
+/*
+** The SC-55 mkII and XP-10 ROMs share one layout.  Parsing picks the
+** first model whose late_data_offset fits the ROM, so when a ROM is big
+** enough for several layouts, the order here decides its model.
+*/
+static const ModelDescriptor MODELS[] = {
+    {"SC-55 mkII", 0x30000, 0x38000, 0x38080, 8, {64, 48}, 2, "CT"}
+};
+
+#define NUM_MODELS (sizeof(MODELS) / sizeof(MODELS[0]))
+
+typedef struct
+{
+    unsigned op;
+    unsigned region;
+    size_t arg;
+    size_t offset;
+    size_t length;
+} PatchOp;
+
+static uint8_t membership[128][16];
+
+static uint8_t ToneExists(const size_t prog, const size_t bank)
+{
+    return (membership[prog][bank / 8] >> (bank % 8)) & 1;
+}
+
+static void SetMaskBit(uint64_t mask[2], const size_t prog)
+{
+    mask[prog / 64] |= (uint64_t)1 << (prog % 64);
+}
+
+static void PrintMask(FILE *fp, const uint64_t mask[2])
+{
+    fprintf(fp, "{UINT64_C(0x%016llx), UINT64_C(0x%016llx)}", (unsigned long long)mask[0], (unsigned long long)mask[1]);
+}
+
+/* Appends an op, merging it into the previous one when both cover adjacent bytes the same way */
+static void AddOp(PatchOp *ops, size_t *num_ops, const unsigned op, const unsigned region, const size_t arg, const size_t offset, const size_t length)
+{
+    PatchOp *last = *num_ops > 0 ? &ops[*num_ops - 1] : NULL;
+
+    if(length == 0)
+    {
+        return;
+    }
+
+    if(last && last->op == op && last->region == region && last->offset + last->length == offset &&
+       ((op == OP_COPY && last->arg + last->length == arg) || (op == OP_FILL_GROUPS && last->arg == arg)))
+    {
+        last->length += length;
+        return;
+    }
+
+    ops[*num_ops].op = op;
+    ops[*num_ops].region = region;
+    ops[*num_ops].arg = arg;
+    ops[*num_ops].offset = offset;
+    ops[*num_ops].length = length;
+    (*num_ops)++;
+}
+
+/*
+** Compiles one combination of modes for a model.  Drum groups are added
+** one at a time and merged, so the program fills every slot in a single
+** pass.  version_arg is where the model's version bytes start in
+** SC55_PATCH_BYTES.
+*/
+static size_t CompileProgram(PatchOp *ops, const ModelDescriptor *model, const size_t plan, const size_t drum_mode, const size_t update_version, const size_t version_arg)
+{
+    size_t num_ops = 0;
+    size_t group;
+
+    AddOp(ops, &num_ops, OP_FILL_TONES, REGION_TONES, plan, 0, (size_t)PATCHED_BANKS * 256);
+
+    for(group = 0; group < model->drum_slots[drum_mode]; group += model->drum_group_size)
+    {
+        AddOp(ops, &num_ops, OP_FILL_GROUPS, REGION_DRUMS, model->drum_group_size, group, model->drum_group_size);
+    }
+
+    if(update_version)
+    {
+        AddOp(ops, &num_ops, OP_COPY, REGION_VERSION, version_arg, 0, strlen(model->version_bytes));
+    }
+
+    return num_ops;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *plan_names[NUM_PLANS] = {"strict", "sc55", "mkii"};
+    static const char *drum_names[NUM_DRUM_MODES] = {"early", "late"};
+    PatchOp ops[MAX_OPS];
+    size_t version_args[NUM_MODELS];
+    size_t min_rom_size = 0;
+    size_t num_patch_bytes = 0;
+    size_t model, drum_mode, update_version, num_ops, j;
+    uint64_t use_group[PATCHED_BANKS][2];
+    uint64_t force[PATCHED_BANKS][2];
+    uint64_t fill[2] = {0, 0};
+    size_t prog, bank, plan, i;
+    FILE *fp;
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "Usage: gen_tone_map OUTPUT\n");
+        return 1;
+    }
+
+    for(prog = 0; prog < 128; prog++)
+    {
+        for(i = 0; i < SC55_TONES[prog].num_tones; i++)
+        {
+            bank = SC55_TONES[prog].tones[i].tone_id;
+            membership[prog][bank / 8] |= (uint8_t)(1 << (bank % 8));
+        }
+    }
+
+    for(prog = 0; prog < PATCHED_PROGS; prog++)
+    {
+        SetMaskBit(fill, prog);
+    }
+
+    fp = fopen(argv[1], "w");
+    if(!fp)
+    {
+        fprintf(stderr, "Unable to open %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(fp, "/* Generated by gen_tone_map from SC55Tones.h.  Do not edit; run make to regenerate. */\n\n");
+    fprintf(fp, "#ifndef SC55TONEMAP_H\n#define SC55TONEMAP_H\n\n#include <stdint.h>\n\n");
+    fprintf(fp, "#define SC55_TONE_MAP_BANKS %d\n\n", PATCHED_BANKS);
+    fprintf(fp, "#define SC55_TONE_PLAN_STRICT %d\n#define SC55_TONE_PLAN_SC55 %d\n#define SC55_TONE_PLAN_MKII %d\n\n", PLAN_STRICT, PLAN_SC55, PLAN_MKII);
+
+    fprintf(fp, "/* Bit (bank %% 8) of byte (bank / 8) is set when the program has a tone in that bank */\n");
+    fprintf(fp, "static const uint8_t SC55_TONE_MEMBERSHIP[128][16] = {\n");
+    for(prog = 0; prog < 128; prog++)
+    {
+        fprintf(fp, "    {");
+        for(i = 0; i < 16; i++)
+        {
+            fprintf(fp, "0x%02x%s", membership[prog][i], i < 15 ? ", " : "");
+        }
+        fprintf(fp, "}%s\n", prog < 127 ? "," : "");
+    }
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "/*\n");
+    fprintf(fp, "** Per-bank program masks, with bit (prog %% 64) of word (prog / 64) for\n");
+    fprintf(fp, "** each program.  An empty cell, or any cell in force, is replaced when\n");
+    fprintf(fp, "** fill is set: by the tone in bank (bank & 0x78) if use_group is set and\n");
+    fprintf(fp, "** that tone exists, otherwise by the capital tone in bank 0.\n");
+    fprintf(fp, "*/\n");
+    fprintf(fp, "typedef struct\n{\n    uint64_t use_group[SC55_TONE_MAP_BANKS][2];\n    uint64_t force[SC55_TONE_MAP_BANKS][2];\n} SC55TonePlan;\n\n");
+
+    fprintf(fp, "static const uint64_t SC55_TONE_FILL[2] = ");
+    PrintMask(fp, fill);
+    fprintf(fp, ";\n\n");
+
+    fprintf(fp, "static const SC55TonePlan SC55_TONE_PLANS[%d] = {\n", NUM_PLANS);
+    for(plan = 0; plan < NUM_PLANS; plan++)
+    {
+        memset(use_group, 0, sizeof(use_group));
+        memset(force, 0, sizeof(force));
+
+        for(bank = 0; bank < PATCHED_BANKS; bank++)
+        {
+            for(prog = 0; prog < PATCHED_PROGS; prog++)
+            {
+                /* The SC-55 modes only borrow from a group bank when the SC-55 had that exact tone */
+                if(plan == PLAN_MKII || ToneExists(prog, bank))
+                {
+                    SetMaskBit(use_group[bank], prog);
+                }
+
+                /* Strict mode also replaces tones the SC-55 did not have */
+                if(plan == PLAN_STRICT && !ToneExists(prog, bank))
+                {
+                    SetMaskBit(force[bank], prog);
+                }
+            }
+        }
+
+        fprintf(fp, "    /* %s */\n    {\n        {\n", plan_names[plan]);
+        for(bank = 0; bank < PATCHED_BANKS; bank++)
+        {
+            fprintf(fp, "            ");
+            PrintMask(fp, use_group[bank]);
+            fprintf(fp, "%s\n", bank < PATCHED_BANKS - 1 ? "," : "");
+        }
+        fprintf(fp, "        },\n        {\n");
+        for(bank = 0; bank < PATCHED_BANKS; bank++)
+        {
+            fprintf(fp, "            ");
+            PrintMask(fp, force[bank]);
+            fprintf(fp, "%s\n", bank < PATCHED_BANKS - 1 ? "," : "");
+        }
+        fprintf(fp, "        }\n    }%s\n", plan < NUM_PLANS - 1 ? "," : "");
+    }
+    fprintf(fp, "};\n\n");
+
+    for(model = 0; model < NUM_MODELS; model++)
+    {
+        if(model == 0 || MODELS[model].late_data_offset < min_rom_size)
+        {
+            min_rom_size = MODELS[model].late_data_offset;
+        }
+        version_args[model] = num_patch_bytes;
+        num_patch_bytes += strlen(MODELS[model].version_bytes);
+    }
+
+    fprintf(fp, "/* Byte ranges patch ops apply to; the version region starts at the bytes a model replaces */\n");
+    fprintf(fp, "#define SC55_PATCH_REGION_TONES %d\n#define SC55_PATCH_REGION_DRUMS %d\n#define SC55_PATCH_REGION_VERSION %d\n#define SC55_PATCH_REGIONS 3\n\n", REGION_TONES, REGION_DRUMS, REGION_VERSION);
+    fprintf(fp, "/*\n");
+    fprintf(fp, "** Each op covers length bytes at offset into its region.  FILL_TONES\n");
+    fprintf(fp, "** runs tone plan arg over a whole tone table, FILL_GROUPS replaces 0xff\n");
+    fprintf(fp, "** bytes with the first byte of their arg-byte group, and COPY writes\n");
+    fprintf(fp, "** SC55_PATCH_BYTES starting at index arg.\n");
+    fprintf(fp, "*/\n");
+    fprintf(fp, "#define SC55_PATCH_OP_FILL_TONES %d\n#define SC55_PATCH_OP_FILL_GROUPS %d\n#define SC55_PATCH_OP_COPY %d\n\n", OP_FILL_TONES, OP_FILL_GROUPS, OP_COPY);
+    fprintf(fp, "#define SC55_PATCH_DRUM_EARLY %d\n#define SC55_PATCH_DRUM_LATE %d\n\n", DRUM_EARLY, DRUM_LATE);
+    fprintf(fp, "#define SC55_NUM_MODELS %d\n#define SC55_MIN_ROM_SIZE 0x%zx\n#define SC55_MAX_PATCH_OPS %d\n\n", (int)NUM_MODELS, min_rom_size, MAX_OPS);
+
+    fprintf(fp, "typedef struct\n{\n    uint8_t op;\n    uint8_t region;\n    uint16_t arg;\n    uint32_t offset;\n    uint32_t length;\n} SC55PatchOp;\n\n");
+    fprintf(fp, "typedef struct\n{\n    uint32_t num_ops;\n    SC55PatchOp ops[SC55_MAX_PATCH_OPS];\n} SC55PatchProgram;\n\n");
+    fprintf(fp, "/* late_data_offset is also the smallest ROM with the layout; parsing takes the first layout that fits */\n");
+    fprintf(fp, "typedef struct\n{\n    const char *name;\n    uint32_t tone_table_offset;\n    uint32_t drum_table_offset;\n    uint32_t late_data_offset;\n    uint32_t version_offset;\n} SC55ModelLayout;\n\n");
+
+    fprintf(fp, "static const SC55ModelLayout SC55_MODEL_LAYOUTS[SC55_NUM_MODELS] = {\n");
+    for(model = 0; model < NUM_MODELS; model++)
+    {
+        fprintf(fp, "    {\"%s\", 0x%zx, 0x%zx, 0x%zx, %zu}%s\n", MODELS[model].name, MODELS[model].tone_table_offset, MODELS[model].drum_table_offset, MODELS[model].late_data_offset, MODELS[model].version_offset, model + 1 < NUM_MODELS ? "," : "");
+    }
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "static const uint8_t SC55_PATCH_BYTES[%zu] = {", num_patch_bytes);
+    for(model = 0; model < NUM_MODELS; model++)
+    {
+        for(j = 0; MODELS[model].version_bytes[j] != 0; j++)
+        {
+            fprintf(fp, "%s0x%02x", model == 0 && j == 0 ? "" : ", ", (unsigned)(uint8_t)MODELS[model].version_bytes[j]);
+        }
+    }
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "/* Indexed by model, tone plan, SC55_PATCH_DRUM_ mode and whether the version is updated */\n");
+    fprintf(fp, "static const SC55PatchProgram SC55_PATCH_PROGRAMS[SC55_NUM_MODELS][%d][%d][2] = {\n", NUM_PLANS, NUM_DRUM_MODES);
+    for(model = 0; model < NUM_MODELS; model++)
+    {
+        fprintf(fp, "    /* %s */\n    {\n", MODELS[model].name);
+        for(plan = 0; plan < NUM_PLANS; plan++)
+        {
+            fprintf(fp, "        {\n");
+            for(drum_mode = 0; drum_mode < NUM_DRUM_MODES; drum_mode++)
+            {
+                fprintf(fp, "            {\n");
+                for(update_version = 0; update_version < 2; update_version++)
+                {
+                    num_ops = CompileProgram(ops, &MODELS[model], plan, drum_mode, update_version, version_args[model]);
+                    fprintf(fp, "                /* %s, %s drums%s */\n                {%zu, {", plan_names[plan], drum_names[drum_mode], update_version ? ", version updated" : "", num_ops);
+                    for(j = 0; j < num_ops; j++)
+                    {
+                        fprintf(fp, "%s{%u, %u, %zu, 0x%zx, 0x%zx}", j > 0 ? ", " : "", ops[j].op, ops[j].region, ops[j].arg, ops[j].offset, ops[j].length);
+                    }
+                    fprintf(fp, "}}%s\n", update_version == 0 ? "," : "");
+                }
+                fprintf(fp, "            }%s\n", drum_mode < NUM_DRUM_MODES - 1 ? "," : "");
+            }
+            fprintf(fp, "        }%s\n", plan < NUM_PLANS - 1 ? "," : "");
+        }
+        fprintf(fp, "    }%s\n", model + 1 < NUM_MODELS ? "," : "");
+    }
+    fprintf(fp, "};\n\n#endif /* SC55TONEMAP_H */\n");
+
+    if(fclose(fp) != 0)
+    {
+        fprintf(stderr, "Unable to write %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
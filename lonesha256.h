@@ -20,6 +20,53 @@ lonesha256 function:
 (static|extern) int lonesha256 (unsigned char out[32], const unsigned char* in, size_t len)
     writes the sha256 hash of the first "len" bytes in buffer "in" to buffer "out"
     returns 0 on success, may return non-zero in future versions to indicate error
+
+Compression backends:
+    The block compression function is chosen at runtime from the backends below, falling back to the
+    portable implementation when the CPU (or compiler) does not support an accelerated one.  Selection
+    is done by CPUID/hwcap on every call, so there is no global state to initialise or protect.
+    LONESHA256_BACKEND_PORTABLE  portable C, always available
+    LONESHA256_BACKEND_SHA_NI    x86 SHA extensions (GCC/Clang only)
+    LONESHA256_BACKEND_AVX2      x86 AVX2 message schedule with BMI2 rotates (GCC/Clang only)
+    LONESHA256_BACKEND_ARMV8     ARMv8 cryptography extensions (GCC/Clang on AArch64 only)
+    Define LONESHA256_NO_ACCELERATION to build only the portable backend.
+
+(static|extern) int lonesha256_select_backend (void)
+    returns the fastest backend supported by the running CPU
+(static|extern) int lonesha256_backend_available (int backend)
+    returns non-zero if "backend" was compiled in and is supported by the running CPU
+(static|extern) const char* lonesha256_backend_name (int backend)
+    returns a short human-readable name for "backend", or NULL if it is out of range
+(static|extern) int lonesha256_with_backend (int backend, unsigned char out[32], const unsigned char* in, size_t len)
+    same as lonesha256(), but forces the use of "backend"
+    returns non-zero if "backend" is not available
+
+Streaming functions:
+(static|extern) int lonesha256_init (lonesha256_ctx* ctx)
+    starts a new hash in "ctx" using the fastest available backend
+(static|extern) int lonesha256_init_backend (lonesha256_ctx* ctx, int backend)
+    same as lonesha256_init(), but forces the use of "backend"
+    returns non-zero if "backend" is not available
+(static|extern) int lonesha256_update (lonesha256_ctx* ctx, const unsigned char* in, size_t len)
+    adds the first "len" bytes in buffer "in" to the hash in "ctx"
+(static|extern) int lonesha256_final (lonesha256_ctx* ctx, unsigned char out[32])
+    writes the sha256 hash of everything passed to lonesha256_update() to buffer "out"
+    "ctx" must be re-initialised before it is used again
+
+Multi-buffer functions:
+    Hashing one buffer is serial, but independent buffers of the same length can be hashed in lockstep,
+    one per 32-bit lane of a vector register: eight at a time with AVX2, or sixteen with AVX-512 (F and BW).
+    A group that is not full is padded out with repeats of its first buffer while that is still faster
+    than hashing the rest one at a time with the fastest single-buffer backend.  Eight AVX2 lanes are no
+    faster than one stream with the SHA extensions, so they are only used on CPUs without them.
+(static|extern) int lonesha256_multi_lanes (void)
+    returns how many buffers lonesha256_multi() hashes in lockstep on the running CPU (16, 8, or 1 for none)
+(static|extern) int lonesha256_multi (unsigned char out[][32], const unsigned char* const in[], size_t count, size_t len)
+    writes the sha256 hash of the first "len" bytes of each of the "count" buffers in "in" to "out"
+    returns 0 on success, may return non-zero in future versions to indicate error
+(static|extern) int lonesha256_multi_with_lanes (int lanes, unsigned char out[][32], const unsigned char* const in[], size_t count, size_t len)
+    same as lonesha256_multi(), but forces groups of "lanes" buffers (1, 8 or 16)
+    returns non-zero if "lanes" is not available
 */
 
 /* header section */
@@ -34,15 +81,49 @@ extern "C" {
 #ifdef LONESHA256_STATIC
     #define LONESHA256_IMPLEMENTATION
     #define LSHA256DEF static
+    #if defined(__GNUC__)
+        #define LSHA256UNUSED __attribute__((unused))
+    #else
+        #define LSHA256UNUSED
+    #endif
 #else /* LONESHA256_EXTERN */
     #define LSHA256DEF extern
+    #define LSHA256UNUSED
 #endif
 
 /* includes */
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, uint64_t */
+
+/* backend identifiers */
+#define LONESHA256_BACKEND_PORTABLE 0
+#define LONESHA256_BACKEND_SHA_NI 1
+#define LONESHA256_BACKEND_AVX2 2
+#define LONESHA256_BACKEND_ARMV8 3
+#define LONESHA256_BACKEND_COUNT 4
 
-/* lonesha256 declaration */
+/* streaming context */
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char buf[64];
+    size_t buf_len;
+    int backend;
+} lonesha256_ctx;
+
+/* lonesha256 declarations */
 LSHA256DEF int lonesha256(unsigned char[32], const unsigned char*, size_t);
+LSHA256DEF int lonesha256_init(lonesha256_ctx*);
+LSHA256DEF int lonesha256_init_backend(lonesha256_ctx*, int);
+LSHA256DEF int lonesha256_update(lonesha256_ctx*, const unsigned char*, size_t);
+LSHA256DEF int lonesha256_final(lonesha256_ctx*, unsigned char[32]);
+LSHA256DEF int lonesha256_select_backend(void);
+LSHA256DEF int lonesha256_backend_available(int);
+LSHA256DEF const char* lonesha256_backend_name(int);
+LSHA256DEF int lonesha256_with_backend(int, unsigned char[32], const unsigned char*, size_t);
+LSHA256DEF int lonesha256_multi_lanes(void);
+LSHA256DEF int lonesha256_multi(unsigned char[][32], const unsigned char* const[], size_t, size_t);
+LSHA256DEF int lonesha256_multi_with_lanes(int, unsigned char[][32], const unsigned char* const[], size_t, size_t);
 
 #endif /* LONESHA256_H */
 
@@ -56,7 +137,7 @@ LSHA256DEF int lonesha256(unsigned char[32], const unsigned char*, size_t);
 #define Gamma0(x) (S(x, 7) ^ S(x, 18) ^ R(x, 3))
 #define Gamma1(x) (S(x, 17) ^ S(x, 19) ^ R(x, 10))
 #define RND(a,b,c,d,e,f,g,h,i) \
-    t0 = h + (S(e, 6) ^ S(e, 11) ^ S(e, 25)) + (g ^ (e & (f ^ g))) + K[i] + W[i]; \
+    t0 = h + (S(e, 6) ^ S(e, 11) ^ S(e, 25)) + (g ^ (e & (f ^ g))) + lonesha256_K[i] + W[i]; \
     t1 = (S(a, 2) ^ S(a, 13) ^ S(a, 22)) + (((a | b) & c) | (a & b)); \
     d += t0; \
     h  = t0 + t1;
@@ -70,82 +151,610 @@ LSHA256DEF int lonesha256(unsigned char[32], const unsigned char*, size_t);
     (y)[2] = (unsigned char)(((x)>>40)&255); (y)[3] = (unsigned char)(((x)>>32)&255); \
     (y)[4] = (unsigned char)(((x)>>24)&255); (y)[5] = (unsigned char)(((x)>>16)&255); \
     (y)[6] = (unsigned char)(((x)>>8)&255); (y)[7] = (unsigned char)((x)&255);
-#define SHA256_COMPRESS(buff) \
+#define SHA256_ROUNDS \
     for (i = 0; i < 8; i++) S[i] = sha256_state[i]; \
-    for (i = 0; i < 16; i++) LOAD32H(W[i], buff + (4*i)); \
-    for (i = 16; i < 64; i++) W[i] = Gamma1(W[i-2]) + W[i-7] + Gamma0(W[i-15]) + W[i-16]; \
     for (i = 0; i < 64; i++) { \
         RND(S[0],S[1],S[2],S[3],S[4],S[5],S[6],S[7],i); \
         t = S[7]; S[7] = S[6]; S[6] = S[5]; S[5] = S[4]; \
         S[4] = S[3]; S[3] = S[2]; S[2] = S[1]; S[1] = S[0]; S[0] = t; \
     } \
     for (i = 0; i < 8; i++) sha256_state[i] = sha256_state[i] + S[i];
+#define SHA256_COMPRESS(buff) \
+    for (i = 0; i < 16; i++) LOAD32H(W[i], buff + (4*i)); \
+    for (i = 16; i < 64; i++) W[i] = Gamma1(W[i-2]) + W[i-7] + Gamma0(W[i-15]) + W[i-16]; \
+    SHA256_ROUNDS
 
 /* includes */
-#include <stdint.h> /* uint32_t, uint64_t */
 #include <string.h> /* memcpy */
 
-/* lonesha256 function */
-LSHA256DEF int lonesha256 (unsigned char out[32], const unsigned char* in, size_t len) {
-    /* writes the sha256 hash of the first "len" bytes in buffer "in" to buffer "out"
-       returns 0 on success, may return non-zero in future versions to indicate error */
-    const uint32_t K[64] = {
-        0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
-        0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
-        0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
-        0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
-        0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
-        0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
-        0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
-        0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
-        0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
-        0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
-        0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
-        0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
-        0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
-        0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
-        0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
-        0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
-    };
-    uint64_t sha256_length = 0;
-    uint32_t sha256_state[8] = {
+/* accelerated backend configuration */
+#if !defined(LONESHA256_NO_ACCELERATION) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define LONESHA256_HAVE_X86
+    #define LONESHA256_TARGET_SHA_NI __attribute__((target("sha,sse4.1,ssse3")))
+    #define LONESHA256_TARGET_AVX2 __attribute__((target("avx2,bmi2")))
+    #define LONESHA256_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+    #include <cpuid.h>
+    #include <immintrin.h>
+#endif
+#if !defined(LONESHA256_NO_ACCELERATION) && defined(__GNUC__) && defined(__aarch64__)
+    #define LONESHA256_HAVE_ARMV8
+    #if defined(__clang__)
+        #define LONESHA256_TARGET_ARMV8 __attribute__((target("crypto")))
+    #else
+        #define LONESHA256_TARGET_ARMV8 __attribute__((target("+crypto")))
+    #endif
+    #include <arm_neon.h>
+    #if defined(__linux__)
+        #include <sys/auxv.h>
+        #ifndef HWCAP_SHA2
+            #define HWCAP_SHA2 (1 << 6)
+        #endif
+    #endif
+#endif
+
+/* round constants, shared by every backend */
+static const uint32_t lonesha256_K[64] = {
+    0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+    0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+    0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+    0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+    0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+    0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+    0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+    0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+    0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+    0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+    0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+    0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+    0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+    0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+    0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+    0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+/* compresses "blocks" 64 byte blocks from "in" into "sha256_state" */
+typedef void (*lonesha256_compress_fn)(uint32_t sha256_state[8], const unsigned char* in, size_t blocks);
+
+static void lonesha256_compress_portable (uint32_t sha256_state[8], const unsigned char* in, size_t blocks) {
+    uint32_t S[8], W[64], t0, t1, t;
+    int i = 0; /* declare in advance for C90 compatibility */
+    while (blocks--) {
+        SHA256_COMPRESS(in);
+        in += 64;
+    }
+}
+
+#ifdef LONESHA256_HAVE_X86
+/* one group of four rounds, with the message schedule for the group three steps ahead interleaved */
+#define SHA256_SHA_NI_QROUND(g, mc, mn, mp) \
+    if ((g) < 4) mc = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 16*(g))), mask); \
+    msg = _mm_add_epi32(mc, _mm_loadu_si128((const __m128i*)(lonesha256_K + 4*(g)))); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+    if ((g) >= 3 && (g) < 15) mn = _mm_sha256msg2_epu32(_mm_add_epi32(mn, _mm_alignr_epi8(mc, mp, 4)), mc); \
+    msg = _mm_shuffle_epi32(msg, 0x0E); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg); \
+    if ((g) >= 1 && (g) < 13) mp = _mm_sha256msg1_epu32(mp, mc);
+
+LONESHA256_TARGET_SHA_NI static void lonesha256_compress_sha_ni (uint32_t sha256_state[8], const unsigned char* in, size_t blocks) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, msg, tmp, abef_save, cdgh_save;
+    __m128i m0 = _mm_setzero_si128(), m1 = m0, m2 = m0, m3 = m0;
+    /* state is kept as ABEF/CDGH pairs, as expected by sha256rnds2 */
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&sha256_state[0]), 0xB1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&sha256_state[4]), 0x1B);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    while (blocks--) {
+        abef_save = state0;
+        cdgh_save = state1;
+        SHA256_SHA_NI_QROUND(0, m0, m1, m3)
+        SHA256_SHA_NI_QROUND(1, m1, m2, m0)
+        SHA256_SHA_NI_QROUND(2, m2, m3, m1)
+        SHA256_SHA_NI_QROUND(3, m3, m0, m2)
+        SHA256_SHA_NI_QROUND(4, m0, m1, m3)
+        SHA256_SHA_NI_QROUND(5, m1, m2, m0)
+        SHA256_SHA_NI_QROUND(6, m2, m3, m1)
+        SHA256_SHA_NI_QROUND(7, m3, m0, m2)
+        SHA256_SHA_NI_QROUND(8, m0, m1, m3)
+        SHA256_SHA_NI_QROUND(9, m1, m2, m0)
+        SHA256_SHA_NI_QROUND(10, m2, m3, m1)
+        SHA256_SHA_NI_QROUND(11, m3, m0, m2)
+        SHA256_SHA_NI_QROUND(12, m0, m1, m3)
+        SHA256_SHA_NI_QROUND(13, m1, m2, m0)
+        SHA256_SHA_NI_QROUND(14, m2, m3, m1)
+        SHA256_SHA_NI_QROUND(15, m3, m0, m2)
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        in += 64;
+    }
+    /* back to ABCD/EFGH */
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i*)&sha256_state[0], state0);
+    _mm_storeu_si128((__m128i*)&sha256_state[4], state1);
+}
+
+#undef SHA256_SHA_NI_QROUND
+
+#define SHA256_AVX2_ROR(x, n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+#define SHA256_AVX2_GAMMA0(x) _mm_xor_si128(_mm_xor_si128(SHA256_AVX2_ROR(x, 7), SHA256_AVX2_ROR(x, 18)), _mm_srli_epi32(x, 3))
+#define SHA256_AVX2_GAMMA1(x) _mm_xor_si128(_mm_xor_si128(SHA256_AVX2_ROR(x, 17), SHA256_AVX2_ROR(x, 19)), _mm_srli_epi32(x, 10))
+
+#define SHA256_AVX2_RND(a,b,c,d,e,f,g,h,i) \
+    t0 = h + (S(e, 6) ^ S(e, 11) ^ S(e, 25)) + (g ^ (e & (f ^ g))) + WK[i]; \
+    t1 = (S(a, 2) ^ S(a, 13) ^ S(a, 22)) + (((a | b) & c) | (a & b)); \
+    d += t0; \
+    h  = t0 + t1;
+
+/* the rounds of a single stream are serial, so only the message schedule (and the K[i] + W[i] adds)
+   are vectorised, four words at a time in two halves because of the W[i-2] dependency; the rounds
+   are fully register-renamed and use BMI2 rorx rotates */
+LONESHA256_TARGET_AVX2 static void lonesha256_compress_avx2 (uint32_t sha256_state[8], const unsigned char* in, size_t blocks) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i x0, x1, x2, x3, n;
+    uint32_t WK[64], a, b, c, d, e, f, g, h, t0, t1;
+    int i = 0;
+    while (blocks--) {
+        x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 0)), mask);
+        x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 16)), mask);
+        x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 32)), mask);
+        x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 48)), mask);
+        _mm_storeu_si128((__m128i*)&WK[0], _mm_add_epi32(x0, _mm_loadu_si128((const __m128i*)&lonesha256_K[0])));
+        _mm_storeu_si128((__m128i*)&WK[4], _mm_add_epi32(x1, _mm_loadu_si128((const __m128i*)&lonesha256_K[4])));
+        _mm_storeu_si128((__m128i*)&WK[8], _mm_add_epi32(x2, _mm_loadu_si128((const __m128i*)&lonesha256_K[8])));
+        _mm_storeu_si128((__m128i*)&WK[12], _mm_add_epi32(x3, _mm_loadu_si128((const __m128i*)&lonesha256_K[12])));
+        for (i = 16; i < 64; i += 4) {
+            n = _mm_add_epi32(x0, _mm_alignr_epi8(x3, x2, 4));
+            n = _mm_add_epi32(n, SHA256_AVX2_GAMMA0(_mm_alignr_epi8(x1, x0, 4)));
+            n = _mm_add_epi32(n, SHA256_AVX2_GAMMA1(_mm_srli_si128(x3, 8)));
+            n = _mm_add_epi32(n, SHA256_AVX2_GAMMA1(_mm_slli_si128(n, 8)));
+            _mm_storeu_si128((__m128i*)&WK[i], _mm_add_epi32(n, _mm_loadu_si128((const __m128i*)&lonesha256_K[i])));
+            x0 = x1; x1 = x2; x2 = x3; x3 = n;
+        }
+        a = sha256_state[0]; b = sha256_state[1]; c = sha256_state[2]; d = sha256_state[3];
+        e = sha256_state[4]; f = sha256_state[5]; g = sha256_state[6]; h = sha256_state[7];
+        for (i = 0; i < 64; i += 8) {
+            SHA256_AVX2_RND(a,b,c,d,e,f,g,h,i+0);
+            SHA256_AVX2_RND(h,a,b,c,d,e,f,g,i+1);
+            SHA256_AVX2_RND(g,h,a,b,c,d,e,f,i+2);
+            SHA256_AVX2_RND(f,g,h,a,b,c,d,e,i+3);
+            SHA256_AVX2_RND(e,f,g,h,a,b,c,d,i+4);
+            SHA256_AVX2_RND(d,e,f,g,h,a,b,c,i+5);
+            SHA256_AVX2_RND(c,d,e,f,g,h,a,b,i+6);
+            SHA256_AVX2_RND(b,c,d,e,f,g,h,a,i+7);
+        }
+        sha256_state[0] += a; sha256_state[1] += b; sha256_state[2] += c; sha256_state[3] += d;
+        sha256_state[4] += e; sha256_state[5] += f; sha256_state[6] += g; sha256_state[7] += h;
+        in += 64;
+    }
+}
+
+#undef SHA256_AVX2_ROR
+#undef SHA256_AVX2_RND
+#undef SHA256_AVX2_GAMMA0
+#undef SHA256_AVX2_GAMMA1
+
+/* multi-buffer kernels: "state" holds word i of lane l at state[i * lanes + l], and every lane
+   compresses "blocks" blocks from its own input pointer, so the rounds are identical across lanes */
+#define SHA256_X8_ROR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define SHA256_X8_GAMMA0(x) _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROR(x, 7), SHA256_X8_ROR(x, 18)), _mm256_srli_epi32(x, 3))
+#define SHA256_X8_GAMMA1(x) _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROR(x, 17), SHA256_X8_ROR(x, 19)), _mm256_srli_epi32(x, 10))
+#define SHA256_X8_SIGMA0(x) _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROR(x, 2), SHA256_X8_ROR(x, 13)), SHA256_X8_ROR(x, 22))
+#define SHA256_X8_SIGMA1(x) _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROR(x, 6), SHA256_X8_ROR(x, 11)), SHA256_X8_ROR(x, 25))
+
+LONESHA256_TARGET_AVX2 static void lonesha256_compress_x8_avx2 (uint32_t sha256_state[64], const unsigned char* const in[8], size_t blocks) {
+    const __m256i mask = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m256i s[8], v[8], r[8], t[8], W[16], t0, t1;
+    size_t offset = 0;
+    int i, j, k;
+    for (i = 0; i < 8; i++) s[i] = _mm256_loadu_si256((const __m256i*)&sha256_state[8*i]);
+    while (blocks--) {
+        /* load eight words from each lane and transpose them to one word per register, twice */
+        for (k = 0; k < 2; k++) {
+            for (i = 0; i < 8; i++) r[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in[i] + offset + 32*k)), mask);
+            for (i = 0; i < 8; i += 2) {
+                t[i] = _mm256_unpacklo_epi32(r[i], r[i+1]);
+                t[i+1] = _mm256_unpackhi_epi32(r[i], r[i+1]);
+            }
+            for (i = 0; i < 8; i += 4) {
+                r[i] = _mm256_unpacklo_epi64(t[i], t[i+2]);
+                r[i+1] = _mm256_unpackhi_epi64(t[i], t[i+2]);
+                r[i+2] = _mm256_unpacklo_epi64(t[i+1], t[i+3]);
+                r[i+3] = _mm256_unpackhi_epi64(t[i+1], t[i+3]);
+            }
+            for (j = 0; j < 4; j++) {
+                W[8*k+j] = _mm256_permute2x128_si256(r[j], r[4+j], 0x20);
+                W[8*k+4+j] = _mm256_permute2x128_si256(r[j], r[4+j], 0x31);
+            }
+        }
+        for (i = 0; i < 8; i++) v[i] = s[i];
+        for (i = 0; i < 64; i++) {
+            if (i >= 16) {
+                W[i & 15] = _mm256_add_epi32(_mm256_add_epi32(W[i & 15], SHA256_X8_GAMMA0(W[(i + 1) & 15])),
+                                             _mm256_add_epi32(W[(i + 9) & 15], SHA256_X8_GAMMA1(W[(i + 14) & 15])));
+            }
+            t0 = _mm256_add_epi32(_mm256_add_epi32(v[7], SHA256_X8_SIGMA1(v[4])),
+                                  _mm256_add_epi32(_mm256_xor_si256(v[6], _mm256_and_si256(v[4], _mm256_xor_si256(v[5], v[6]))),
+                                                   _mm256_add_epi32(W[i & 15], _mm256_set1_epi32((int)lonesha256_K[i]))));
+            t1 = _mm256_add_epi32(SHA256_X8_SIGMA0(v[0]), _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(v[0], v[1]), v[2]), _mm256_and_si256(v[0], v[1])));
+            v[7] = v[6]; v[6] = v[5]; v[5] = v[4];
+            v[4] = _mm256_add_epi32(v[3], t0);
+            v[3] = v[2]; v[2] = v[1]; v[1] = v[0];
+            v[0] = _mm256_add_epi32(t0, t1);
+        }
+        for (i = 0; i < 8; i++) s[i] = _mm256_add_epi32(s[i], v[i]);
+        offset += 64;
+    }
+    for (i = 0; i < 8; i++) _mm256_storeu_si256((__m256i*)&sha256_state[8*i], s[i]);
+}
+
+#undef SHA256_X8_ROR
+#undef SHA256_X8_GAMMA0
+#undef SHA256_X8_GAMMA1
+#undef SHA256_X8_SIGMA0
+#undef SHA256_X8_SIGMA1
+
+#define SHA256_X16_GAMMA0(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 7), _mm512_ror_epi32(x, 18), _mm512_srli_epi32(x, 3), 0x96)
+#define SHA256_X16_GAMMA1(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 17), _mm512_ror_epi32(x, 19), _mm512_srli_epi32(x, 10), 0x96)
+#define SHA256_X16_SIGMA0(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 2), _mm512_ror_epi32(x, 13), _mm512_ror_epi32(x, 22), 0x96)
+#define SHA256_X16_SIGMA1(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 6), _mm512_ror_epi32(x, 11), _mm512_ror_epi32(x, 25), 0x96)
+
+/* same as the AVX2 kernel, with native rotates and Ch/Maj as single ternary logic ops (0xCA and 0xE8) */
+LONESHA256_TARGET_AVX512 static void lonesha256_compress_x16_avx512 (uint32_t sha256_state[128], const unsigned char* const in[16], size_t blocks) {
+    const __m512i mask = _mm512_set_epi64(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+                                          0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m512i s[8], v[8], r[16], t[16], W[16], x0, x1, y0, y1, t0, t1;
+    size_t offset = 0;
+    int i, j;
+    for (i = 0; i < 8; i++) s[i] = _mm512_loadu_si512((const void*)&sha256_state[16*i]);
+    while (blocks--) {
+        /* load sixteen words from each lane and transpose them to one word per register */
+        for (i = 0; i < 16; i++) r[i] = _mm512_shuffle_epi8(_mm512_loadu_si512((const void*)(in[i] + offset)), mask);
+        for (i = 0; i < 16; i += 2) {
+            t[i] = _mm512_unpacklo_epi32(r[i], r[i+1]);
+            t[i+1] = _mm512_unpackhi_epi32(r[i], r[i+1]);
+        }
+        for (i = 0; i < 16; i += 4) {
+            r[i] = _mm512_unpacklo_epi64(t[i], t[i+2]);
+            r[i+1] = _mm512_unpackhi_epi64(t[i], t[i+2]);
+            r[i+2] = _mm512_unpacklo_epi64(t[i+1], t[i+3]);
+            r[i+3] = _mm512_unpackhi_epi64(t[i+1], t[i+3]);
+        }
+        for (j = 0; j < 4; j++) {
+            x0 = _mm512_shuffle_i32x4(r[j], r[4+j], 0x88);
+            x1 = _mm512_shuffle_i32x4(r[j], r[4+j], 0xdd);
+            y0 = _mm512_shuffle_i32x4(r[8+j], r[12+j], 0x88);
+            y1 = _mm512_shuffle_i32x4(r[8+j], r[12+j], 0xdd);
+            W[j] = _mm512_shuffle_i32x4(x0, y0, 0x88);
+            W[8+j] = _mm512_shuffle_i32x4(x0, y0, 0xdd);
+            W[4+j] = _mm512_shuffle_i32x4(x1, y1, 0x88);
+            W[12+j] = _mm512_shuffle_i32x4(x1, y1, 0xdd);
+        }
+        for (i = 0; i < 8; i++) v[i] = s[i];
+        for (i = 0; i < 64; i++) {
+            if (i >= 16) {
+                W[i & 15] = _mm512_add_epi32(_mm512_add_epi32(W[i & 15], SHA256_X16_GAMMA0(W[(i + 1) & 15])),
+                                             _mm512_add_epi32(W[(i + 9) & 15], SHA256_X16_GAMMA1(W[(i + 14) & 15])));
+            }
+            t0 = _mm512_add_epi32(_mm512_add_epi32(v[7], SHA256_X16_SIGMA1(v[4])),
+                                  _mm512_add_epi32(_mm512_ternarylogic_epi32(v[4], v[5], v[6], 0xCA),
+                                                   _mm512_add_epi32(W[i & 15], _mm512_set1_epi32((int)lonesha256_K[i]))));
+            t1 = _mm512_add_epi32(SHA256_X16_SIGMA0(v[0]), _mm512_ternarylogic_epi32(v[0], v[1], v[2], 0xE8));
+            v[7] = v[6]; v[6] = v[5]; v[5] = v[4];
+            v[4] = _mm512_add_epi32(v[3], t0);
+            v[3] = v[2]; v[2] = v[1]; v[1] = v[0];
+            v[0] = _mm512_add_epi32(t0, t1);
+        }
+        for (i = 0; i < 8; i++) s[i] = _mm512_add_epi32(s[i], v[i]);
+        offset += 64;
+    }
+    for (i = 0; i < 8; i++) _mm512_storeu_si512((void*)&sha256_state[16*i], s[i]);
+}
+
+#undef SHA256_X16_GAMMA0
+#undef SHA256_X16_GAMMA1
+#undef SHA256_X16_SIGMA0
+#undef SHA256_X16_SIGMA1
+
+static void lonesha256_cpuid_x86 (int* sha_ni, int* avx2, int* avx512) {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0, xcr0_lo = 0, xcr0_hi = 0;
+    unsigned int leaf1_ecx;
+    *sha_ni = 0;
+    *avx2 = 0;
+    *avx512 = 0;
+    if (__get_cpuid_max(0, NULL) < 7) return;
+    __cpuid(1, eax, ebx, ecx, edx);
+    leaf1_ecx = ecx;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    /* SHA (leaf 7 EBX bit 29) also needs SSSE3 and SSE4.1 */
+    *sha_ni = (ebx & (1U << 29)) && (leaf1_ecx & (1U << 9)) && (leaf1_ecx & (1U << 19));
+    /* AVX2 (EBX bit 5) and BMI2 (EBX bit 8) need the OS to save the YMM state (OSXSAVE, XCR0 bits 1-2) */
+    if ((ebx & (1U << 5)) && (ebx & (1U << 8)) && (leaf1_ecx & (1U << 27))) {
+        __asm__ __volatile__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        *avx2 = (xcr0_lo & 6U) == 6U;
+        /* AVX-512F (EBX bit 16) and BW (EBX bit 30) also need the opmask and ZMM state (XCR0 bits 5-7) */
+        *avx512 = *avx2 && (ebx & (1U << 16)) && (ebx & (1U << 30)) && (xcr0_lo & 0xE0U) == 0xE0U;
+    }
+    (void)xcr0_hi;
+}
+#endif /* LONESHA256_HAVE_X86 */
+
+#ifdef LONESHA256_HAVE_ARMV8
+LONESHA256_TARGET_ARMV8 static void lonesha256_compress_armv8 (uint32_t sha256_state[8], const unsigned char* in, size_t blocks) {
+    uint32x4_t state0, state1, abcd_save, efgh_save, wk, tmp;
+    uint32x4_t m[4];
+    int g;
+    state0 = vld1q_u32(&sha256_state[0]);
+    state1 = vld1q_u32(&sha256_state[4]);
+    while (blocks--) {
+        abcd_save = state0;
+        efgh_save = state1;
+        for (g = 0; g < 4; g++) m[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(in + 16*g)));
+        for (g = 0; g < 16; g++) {
+            wk = vaddq_u32(m[g & 3], vld1q_u32(&lonesha256_K[4*g]));
+            if (g < 12) m[g & 3] = vsha256su1q_u32(vsha256su0q_u32(m[g & 3], m[(g + 1) & 3]), m[(g + 2) & 3], m[(g + 3) & 3]);
+            tmp = state0;
+            state0 = vsha256hq_u32(state0, state1, wk);
+            state1 = vsha256h2q_u32(state1, tmp, wk);
+        }
+        state0 = vaddq_u32(state0, abcd_save);
+        state1 = vaddq_u32(state1, efgh_save);
+        in += 64;
+    }
+    vst1q_u32(&sha256_state[0], state0);
+    vst1q_u32(&sha256_state[4], state1);
+}
+#endif /* LONESHA256_HAVE_ARMV8 */
+
+/* lonesha256_backend_available function */
+LSHA256DEF LSHA256UNUSED int lonesha256_backend_available (int backend) {
+    /* returns non-zero if "backend" was compiled in and is supported by the running CPU */
+#ifdef LONESHA256_HAVE_X86
+    int sha_ni, avx2, avx512;
+#endif
+    switch (backend) {
+    case LONESHA256_BACKEND_PORTABLE:
+        return 1;
+#ifdef LONESHA256_HAVE_X86
+    case LONESHA256_BACKEND_SHA_NI:
+        lonesha256_cpuid_x86(&sha_ni, &avx2, &avx512);
+        return sha_ni;
+    case LONESHA256_BACKEND_AVX2:
+        lonesha256_cpuid_x86(&sha_ni, &avx2, &avx512);
+        return avx2;
+#endif
+#ifdef LONESHA256_HAVE_ARMV8
+    case LONESHA256_BACKEND_ARMV8:
+    #if defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO) || defined(__APPLE__)
+        return 1;
+    #elif defined(__linux__)
+        return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+    #else
+        return 0;
+    #endif
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* lonesha256_select_backend function */
+LSHA256DEF LSHA256UNUSED int lonesha256_select_backend (void) {
+    /* returns the fastest backend supported by the running CPU */
+    if (lonesha256_backend_available(LONESHA256_BACKEND_SHA_NI)) return LONESHA256_BACKEND_SHA_NI;
+    if (lonesha256_backend_available(LONESHA256_BACKEND_ARMV8)) return LONESHA256_BACKEND_ARMV8;
+    if (lonesha256_backend_available(LONESHA256_BACKEND_AVX2)) return LONESHA256_BACKEND_AVX2;
+    return LONESHA256_BACKEND_PORTABLE;
+}
+
+/* lonesha256_backend_name function */
+LSHA256DEF LSHA256UNUSED const char* lonesha256_backend_name (int backend) {
+    /* returns a short human-readable name for "backend", or NULL if it is out of range */
+    static const char* const names[LONESHA256_BACKEND_COUNT] = {"portable", "sha-ni", "avx2", "armv8-ce"};
+    if (backend < 0 || backend >= LONESHA256_BACKEND_COUNT) return NULL;
+    return names[backend];
+}
+
+static lonesha256_compress_fn lonesha256_compress_for (int backend) {
+    switch (backend) {
+#ifdef LONESHA256_HAVE_X86
+    case LONESHA256_BACKEND_SHA_NI:
+        return lonesha256_compress_sha_ni;
+    case LONESHA256_BACKEND_AVX2:
+        return lonesha256_compress_avx2;
+#endif
+#ifdef LONESHA256_HAVE_ARMV8
+    case LONESHA256_BACKEND_ARMV8:
+        return lonesha256_compress_armv8;
+#endif
+    default:
+        return lonesha256_compress_portable;
+    }
+}
+
+/* lonesha256_init_backend function */
+LSHA256DEF LSHA256UNUSED int lonesha256_init_backend (lonesha256_ctx* ctx, int backend) {
+    /* starts a new hash in "ctx" using "backend"
+       returns non-zero if "backend" is not available */
+    static const uint32_t sha256_init_state[8] = {
         0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
         0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL
-    }, S[8], W[64], t0, t1, t;
-    unsigned char sha256_buf[64];
-    int i = 0; /* declare in advance for C90 compatibility */
+    };
+    if (!lonesha256_backend_available(backend)) return 1;
+    memcpy(ctx->state, sha256_init_state, sizeof(sha256_init_state));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+    ctx->backend = backend;
+    return 0;
+}
 
-    /* process input in 64 byte chunks */
-    while (len >= 64) {
-       SHA256_COMPRESS(in);
-       sha256_length += 64 * 8;
-       in += 64;
-       len -= 64;
-    }
-    /* copy remaining bytes into sha256_buf */
-    memcpy(sha256_buf, in, len);
-    /* finish up (len now number of bytes in sha256_buf) */
-    sha256_length += len * 8;
+/* lonesha256_init function */
+LSHA256DEF LSHA256UNUSED int lonesha256_init (lonesha256_ctx* ctx) {
+    /* starts a new hash in "ctx" using the fastest available backend */
+    return lonesha256_init_backend(ctx, lonesha256_select_backend());
+}
+
+/* lonesha256_update function */
+LSHA256DEF LSHA256UNUSED int lonesha256_update (lonesha256_ctx* ctx, const unsigned char* in, size_t len) {
+    /* adds the first "len" bytes in buffer "in" to the hash in "ctx" */
+    lonesha256_compress_fn compress = lonesha256_compress_for(ctx->backend);
+    size_t fill;
+    ctx->length += len;
+    /* top up a partially filled block first */
+    if (ctx->buf_len > 0) {
+        fill = 64 - ctx->buf_len;
+        if (fill > len) fill = len;
+        memcpy(ctx->buf + ctx->buf_len, in, fill);
+        ctx->buf_len += fill;
+        in += fill;
+        len -= fill;
+        if (ctx->buf_len < 64) return 0;
+        compress(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    /* process whole 64 byte chunks straight from the input */
+    compress(ctx->state, in, len / 64);
+    in += len & ~(size_t)63;
+    len &= 63;
+    /* keep the remainder for the next update */
+    memcpy(ctx->buf, in, len);
+    ctx->buf_len = len;
+    return 0;
+}
+
+/* lonesha256_final function */
+LSHA256DEF LSHA256UNUSED int lonesha256_final (lonesha256_ctx* ctx, unsigned char out[32]) {
+    /* writes the sha256 hash of everything passed to lonesha256_update() to buffer "out" */
+    unsigned char sha256_buf[128];
+    uint64_t sha256_length = ctx->length * 8;
+    size_t len = ctx->buf_len, tail;
+    int i = 0; /* declare in advance for C90 compatibility */
+    /* pad, store length and compress the last one or two blocks */
+    memcpy(sha256_buf, ctx->buf, len);
     sha256_buf[len++] = 0x80;
-    /* pad then compress if length is above 56 bytes */
-    if (len > 56) {
-        while (len < 64) sha256_buf[len++] = 0;
-        SHA256_COMPRESS(sha256_buf);
-        len = 0;
-    }
-    /* pad up to 56 bytes */
-    while (len < 56) sha256_buf[len++] = 0;
-    /* store length and compress */
-    STORE64H(sha256_length, sha256_buf + 56);
-    SHA256_COMPRESS(sha256_buf);
+    tail = (len > 56) ? 128 : 64;
+    while (len < tail - 8) sha256_buf[len++] = 0;
+    STORE64H(sha256_length, sha256_buf + tail - 8);
+    lonesha256_compress_for(ctx->backend)(ctx->state, sha256_buf, tail / 64);
     /* copy output */
     for (i = 0; i < 8; i++) {
-        STORE32H(sha256_state[i], out + 4*i);
+        STORE32H(ctx->state[i], out + 4*i);
     }
-    /* return */
     return 0;
 }
 
+/* lonesha256_with_backend function */
+LSHA256DEF LSHA256UNUSED int lonesha256_with_backend (int backend, unsigned char out[32], const unsigned char* in, size_t len) {
+    /* same as lonesha256(), but forces the use of "backend"
+       returns non-zero if "backend" is not available */
+    lonesha256_ctx ctx;
+    if (lonesha256_init_backend(&ctx, backend)) return 1;
+    lonesha256_update(&ctx, in, len);
+    return lonesha256_final(&ctx, out);
+}
+
+/* lonesha256 function */
+LSHA256DEF LSHA256UNUSED int lonesha256 (unsigned char out[32], const unsigned char* in, size_t len) {
+    /* writes the sha256 hash of the first "len" bytes in buffer "in" to buffer "out"
+       returns 0 on success, may return non-zero in future versions to indicate error */
+    return lonesha256_with_backend(lonesha256_select_backend(), out, in, len);
+}
+
+/* lonesha256_multi_lanes function */
+LSHA256DEF LSHA256UNUSED int lonesha256_multi_lanes (void) {
+    /* returns how many buffers lonesha256_multi() hashes in lockstep on the running CPU */
+#ifdef LONESHA256_HAVE_X86
+    int sha_ni, avx2, avx512;
+    lonesha256_cpuid_x86(&sha_ni, &avx2, &avx512);
+    if (avx512) return 16;
+    if (avx2 && !sha_ni) return 8;
+#endif
+    return 1;
+}
+
+#ifdef LONESHA256_HAVE_X86
+/* hashes one group of "lanes" buffers of "len" bytes in lockstep */
+static void lonesha256_multi_group (int lanes, unsigned char out[][32], const unsigned char* const in[], size_t len) {
+    static const uint32_t sha256_init_state[8] = {
+        0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
+        0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL
+    };
+    uint32_t sha256_state[128];
+    unsigned char sha256_buf[16][128];
+    const unsigned char* tails[16];
+    uint64_t sha256_length = (uint64_t)len * 8;
+    size_t full = len & ~(size_t)63, tail, l;
+    int i = 0, lane;
+    for (i = 0; i < 8; i++) {
+        for (lane = 0; lane < lanes; lane++) sha256_state[i * lanes + lane] = sha256_init_state[i];
+    }
+    /* every lane has the same length, so the padded tail blocks line up as well */
+    tail = ((len - full) + 1 > 56) ? 128 : 64;
+    for (lane = 0; lane < lanes; lane++) {
+        l = len - full;
+        memcpy(sha256_buf[lane], in[lane] + full, l);
+        sha256_buf[lane][l++] = 0x80;
+        while (l < tail - 8) sha256_buf[lane][l++] = 0;
+        STORE64H(sha256_length, sha256_buf[lane] + tail - 8);
+        tails[lane] = sha256_buf[lane];
+    }
+    if (lanes == 16) {
+        lonesha256_compress_x16_avx512(sha256_state, in, full / 64);
+        lonesha256_compress_x16_avx512(sha256_state, tails, tail / 64);
+    } else {
+        lonesha256_compress_x8_avx2(sha256_state, in, full / 64);
+        lonesha256_compress_x8_avx2(sha256_state, tails, tail / 64);
+    }
+    for (lane = 0; lane < lanes; lane++) {
+        for (i = 0; i < 8; i++) {
+            STORE32H(sha256_state[i * lanes + lane], out[lane] + 4*i);
+        }
+    }
+}
+#endif /* LONESHA256_HAVE_X86 */
+
+/* lonesha256_multi_with_lanes function */
+LSHA256DEF LSHA256UNUSED int lonesha256_multi_with_lanes (int lanes, unsigned char out[][32], const unsigned char* const in[], size_t count, size_t len) {
+    /* same as lonesha256_multi(), but forces groups of "lanes" buffers
+       returns non-zero if "lanes" is not available */
+#ifdef LONESHA256_HAVE_X86
+    unsigned char group_out[16][32];
+    const unsigned char* group_in[16];
+    size_t done = 0, group;
+    int lane, width;
+    int sha_ni, avx2, avx512;
+    lonesha256_cpuid_x86(&sha_ni, &avx2, &avx512);
+    if (lanes != 1 && lanes != 8 && lanes != 16) return 1;
+    if ((lanes == 8 && !avx2) || (lanes == 16 && !avx512)) return 1;
+    while (lanes > 1 && count - done > 1) {
+        width = lanes;
+        /* sixteen lanes holding fewer than eight buffers lose to eight lanes, or to the SHA extensions */
+        if (lanes == 16 && count - done < 8) {
+            if (sha_ni) break;
+            width = 8;
+        }
+        group = count - done < (size_t)width ? count - done : (size_t)width;
+        for (lane = 0; lane < width; lane++) group_in[lane] = in[done + ((size_t)lane < group ? (size_t)lane : 0)];
+        lonesha256_multi_group(width, group_out, group_in, len);
+        memcpy(out[done], group_out, group * 32);
+        done += group;
+    }
+#else
+    size_t done = 0;
+    if (lanes != 1) return 1;
+#endif
+    for (; done < count; done++) lonesha256(out[done], in[done], len);
+    return 0;
+}
+
+/* lonesha256_multi function */
+LSHA256DEF LSHA256UNUSED int lonesha256_multi (unsigned char out[][32], const unsigned char* const in[], size_t count, size_t len) {
+    /* writes the sha256 hash of the first "len" bytes of each of the "count" buffers in "in" to "out" */
+    return lonesha256_multi_with_lanes(lonesha256_multi_lanes(), out, in, count, len);
+}
+
 #undef S
 #undef R
 #undef Gamma0
@@ -154,6 +763,7 @@ LSHA256DEF int lonesha256 (unsigned char out[32], const unsigned char* in, size_
 #undef STORE32H
 #undef LOAD32H
 #undef STORE64H
+#undef SHA256_ROUNDS
 #undef SHA256_COMPRESS
 
 #ifdef __cplusplus
@@ -17,28 +17,71 @@
 ** If not, see <https://www.gnu.org/licenses/>.
 */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "CTFBatch.h"
 #include "CTFPatch.h"
+#include "CTFScan.h"
+#include "CTFSelfTest.h"
+#include "CTFServer.h"
 
 void print_help(void);
-int process_rom(const char *input_rom_path, const char *output_rom_path, uint8_t sc55_compat_mode, uint8_t sc55_drum_compat_mode, uint8_t ignore_checksum, uint8_t update_version);
+int process_rom(const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress);
+int self_test(void);
+int print_patched_hashes(const char *input_rom_path, const rom_patch_options *options);
 
 int main(int argc, char **argv)
 {
     char* rom_input_path = NULL;
 	char* rom_output_path = NULL;
-	uint8_t ignore_checksum = 0;
-	uint8_t sc55_compat_mode = 2;
-	uint8_t sc55_drum_compat_mode = 1;
-	uint8_t update_version = 1;
+	char* batch_source = NULL;
+	char* hash_database_path = NULL;
+	char* hash_listing_path = NULL;
+	char* serve_socket_path = NULL;
+	char* server_socket_path = getenv("CTFPATCH_SERVER");
+	char* scan_root = NULL;
+	SC55HashDatabase *hash_database = NULL;
+	SC55ROMStats stats;
+	rom_patch_options options;
+	FILE *progress = stdout;
+	FILE *manifest = stdout;
+	long num_threads = 0;
 	int c;
+	int print_stats = 0;
+	int patched_hashes = 0;
 	int operation_result = 0;
 
-	while((c = getopt(argc, argv, "i:o:cs:d:vh")) != -1)
+	static const struct option long_options[] = {
+		{ "stats", no_argument, NULL, 'S' },
+		{ "serve", required_argument, NULL, 'L' },
+		{ "server", required_argument, NULL, 'R' },
+		{ "scan", required_argument, NULL, 'I' },
+		{ "patched-hashes", no_argument, NULL, 'P' },
+		{ "io-uring", no_argument, NULL, 'U' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	options.ignore_checksum = 0;
+	options.sc55_compat_mode = 2;
+	options.sc55_drum_compat_mode = 1;
+	options.update_version = 1;
+	options.use_mmap = 0;
+	options.all_variants = 0;
+	options.dedup_outputs = 0;
+	options.use_io_uring = 0;
+	options.cache_directory = NULL;
+	options.hash_database = NULL;
+	options.stats = NULL;
+	options.buffer_pool = NULL;
+
+	while((c = getopt_long(argc, argv, "i:o:b:j:cs:d:vmaDC:H:M:th", long_options, NULL)) != -1)
 	{
 		switch(c)
 		{
@@ -48,23 +91,34 @@ int main(int argc, char **argv)
 			case 'o':
 				rom_output_path = strdup(optarg);
 				break;
+			case 'b':
+				batch_source = strdup(optarg);
+				break;
+			case 'j':
+				num_threads = strtol(optarg, NULL, 10);
+				if(num_threads < 0)
+				{
+					print_help();
+					exit(1);
+				}
+				break;
 			case 'c':
-				ignore_checksum = 1;
+				options.ignore_checksum = 1;
 				break;
 			case 's':
 				if(strcmp(optarg, "strict") == 0)
 				{
-					sc55_compat_mode = 1;
+					options.sc55_compat_mode = 1;
 					break;
 				}
 				if(strcmp(optarg, "sc55") == 0)
 				{
-					sc55_compat_mode = 2;
+					options.sc55_compat_mode = 2;
 					break;
 				}
 				if(strcmp(optarg, "mkii") == 0)
 				{
-					sc55_compat_mode = 4;
+					options.sc55_compat_mode = 4;
 					break;
 				}
 				print_help();
@@ -72,18 +126,56 @@ int main(int argc, char **argv)
 			case 'd':
 				if(strcmp(optarg, "early") == 0)
 				{
-					sc55_drum_compat_mode = 1;
+					options.sc55_drum_compat_mode = 1;
 					break;
 				}
 				if(strcmp(optarg, "late") == 0)
 				{
-					sc55_drum_compat_mode = 2;
+					options.sc55_drum_compat_mode = 2;
 					break;
 				}
 				print_help();
 				exit(1);
 			case 'v':
-				update_version = 0;
+				options.update_version = 0;
+				break;
+			case 'm':
+				options.use_mmap = 1;
+				break;
+			case 'a':
+				options.all_variants = 1;
+				break;
+			case 'D':
+				options.dedup_outputs = 1;
+				break;
+			case 'C':
+				options.cache_directory = strdup(optarg);
+				break;
+			case 'H':
+				hash_database_path = strdup(optarg);
+				break;
+			case 'M':
+				hash_listing_path = strdup(optarg);
+				break;
+			case 't':
+				exit(self_test());
+			case 'S':
+				print_stats = 1;
+				break;
+			case 'L':
+				serve_socket_path = strdup(optarg);
+				break;
+			case 'R':
+				server_socket_path = strdup(optarg);
+				break;
+			case 'I':
+				scan_root = strdup(optarg);
+				break;
+			case 'P':
+				patched_hashes = 1;
+				break;
+			case 'U':
+				options.use_io_uring = 1;
 				break;
 			case 'h':
 			default:
@@ -92,62 +184,304 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if(!rom_input_path || !rom_output_path)
+	if(hash_listing_path)
+	{
+		if(!rom_output_path)
+		{
+			print_help();
+			exit(1);
+		}
+
+		if(BuildHashDatabase(hash_listing_path, rom_output_path) != 0)
+		{
+			printf("Unable to build hash database %s from %s\n", rom_output_path, hash_listing_path);
+			exit(1);
+		}
+
+		exit(0);
+	}
+
+	if(hash_database_path)
+	{
+		hash_database = OpenHashDatabase(hash_database_path);
+		if(!hash_database)
+		{
+			printf("Unable to open hash database %s\n", hash_database_path);
+			exit(1);
+		}
+		options.hash_database = hash_database;
+	}
+
+	if(print_stats)
+	{
+		InitROMStats(&stats);
+		options.stats = &stats;
+	}
+
+	/* Servers and batches read many ROMs, so their buffers are pooled and reused */
+	if(serve_socket_path || batch_source)
+	{
+		options.buffer_pool = CreateBufferPool(0, 0, 1);
+	}
+
+	if(serve_socket_path)
+	{
+		exit(run_server(serve_socket_path, &options, (size_t)num_threads));
+	}
+
+	if(patched_hashes)
+	{
+		if(!rom_input_path)
+		{
+			print_help();
+			exit(1);
+		}
+
+		exit(print_patched_hashes(rom_input_path, &options));
+	}
+
+	if(scan_root)
+	{
+		if(rom_output_path && strcmp(rom_output_path, ROM_PATH_STDIO) != 0)
+		{
+			manifest = fopen(rom_output_path, "w");
+			if(!manifest)
+			{
+				printf("Unable to open manifest %s\n", rom_output_path);
+				exit(1);
+			}
+		}
+
+		operation_result = run_scan(scan_root, hash_database, manifest, (size_t)num_threads);
+		if(manifest != stdout && fclose(manifest) != 0)
+		{
+			operation_result = 1;
+		}
+		exit(operation_result);
+	}
+
+	if(batch_source)
+	{
+		if(rom_input_path || !rom_output_path)
+		{
+			print_help();
+			exit(1);
+		}
+
+		operation_result = run_batch(batch_source, rom_output_path, &options, (size_t)num_threads);
+		DestroyBufferPool(options.buffer_pool);
+	}
+	else if(!rom_input_path || !rom_output_path)
 	{
 		print_help();
 		exit(1);
 	}
+	else if(options.all_variants)
+	{
+		if(!output_template_has_token(rom_output_path, 's') || !output_template_has_token(rom_output_path, 'd'))
+		{
+			print_help();
+			exit(1);
+		}
 
-	operation_result = process_rom(rom_input_path, rom_output_path, sc55_compat_mode, sc55_drum_compat_mode, ignore_checksum, update_version);
+		operation_result = patch_rom_file_variants(rom_input_path, rom_output_path, rom_input_path, &options, 0, progress) == ROM_JOB_OK ? 0 : 1;
+	}
+	else
+	{
+		/* The patched ROM owns stdout, so everything else goes to stderr */
+		if(strcmp(rom_output_path, ROM_PATH_STDIO) == 0)
+		{
+			progress = stderr;
+		}
+
+		operation_result = -1;
+		if(server_socket_path && *server_socket_path)
+		{
+			operation_result = patch_rom_remote(server_socket_path, rom_input_path, rom_output_path, &options, progress);
+			if(operation_result == ROM_JOB_SERVER_UNAVAILABLE)
+			{
+				fprintf(progress, "No patch server on %s, patching locally.\n", server_socket_path);
+				operation_result = -1;
+			}
+			else if(operation_result == ROM_JOB_SERVER_SKIPPED)
+			{
+				fprintf(progress, "Input and output are the same file, patching locally.\n");
+				operation_result = -1;
+			}
+			else
+			{
+				operation_result = operation_result == ROM_JOB_OK ? 0 : 1;
+			}
+		}
+
+		if(operation_result < 0)
+		{
+			operation_result = process_rom(rom_input_path, rom_output_path, &options, progress);
+		}
+	}
+
+	if(print_stats)
+	{
+		print_rom_stats_json(&stats, progress);
+	}
 
 	exit(operation_result);
 }
 
-int process_rom(const char *input_rom_path, const char *output_rom_path, const uint8_t sc55_compat_mode, const uint8_t sc55_drum_compat_mode, const uint8_t ignore_checksum, const uint8_t update_version)
+int process_rom(const char *input_rom_path, const char *output_rom_path, const rom_patch_options *options, FILE *progress)
 {
-	int operation_result = 0;
+	return patch_rom_file(input_rom_path, output_rom_path, options, progress) == ROM_JOB_OK ? 0 : 1;
+}
 
+/* Prints SC55_PATCHED_HASHES entries for every patch of a ROM, ready to paste into SC55Hashes.h */
+int print_patched_hashes(const char *input_rom_path, const rom_patch_options *options)
+{
+	static const uint8_t compat_modes[3] = { SC55_STRICT_SC55_COMPAT, SC55_SC55_COMPAT, SC55_SC55MKII_COMPAT };
+	static const uint8_t drum_compat_modes[2] = { SC55_DRUM_EARLY_COMPAT, SC55_DRUM_LATE_COMPAT };
+	SC55ReadOptions read_options;
 	SC55ROMData rom_data;
+	SC55ROMPatch *patches;
+	uint8_t patched_sha256[32];
+	size_t i, j;
+	int result = 0;
+
+	InitReadOptions(&read_options);
+	read_options.ignore_sha256_failures = options->ignore_checksum;
+	read_options.hash_database = options->hash_database;
 
-	printf("Reading ROM...\n");
-	rom_data = ReadROM(input_rom_path, ignore_checksum);
+	rom_data = ReadROMWithOptions(input_rom_path, &read_options);
 	if(!rom_data.rom_data)
 	{
-		printf("Unable to read ROM data from %s\n", input_rom_path);
-		printf("Verify that the ROM is a supported image.\n");
+		fprintf(stderr, "Unable to read ROM data from %s\n", input_rom_path);
 		return 1;
 	}
 
-	printf("ROM data read.  Patching...\n");
-
-	operation_result = PatchROM(&rom_data, sc55_compat_mode, sc55_drum_compat_mode, update_version);
-	if(operation_result)
+	patches = (SC55ROMPatch*)malloc(12 * sizeof(SC55ROMPatch));
+	if(patches == NULL)
 	{
-		printf("Error applying ROM patch.\n");
-		return operation_result;
+		DestroyROM(&rom_data);
+		return 1;
 	}
 
-	printf("ROM data patched.  Writing...\n");
+	for(i = 0; i < 12; i++)
+	{
+		patches[i].compat_mode = compat_modes[i / 4];
+		patches[i].drum_compat_mode = drum_compat_modes[(i / 2) % 2];
+		patches[i].update_version = (uint8_t)(i % 2);
+	}
 
-	operation_result = WriteROM(&rom_data, output_rom_path);
-	if(operation_result)
+	if(BuildROMPatches(&rom_data, patches, 12) != 0)
 	{
-		printf("Error writing ROM to %s\n", output_rom_path);
-		return operation_result;
+		fprintf(stderr, "Unable to patch %s\n", input_rom_path);
+		result = 1;
 	}
 
-	printf("ROM written successfully.\n");
+	for(i = 0; i < 12 && result == 0; i++)
+	{
+		if(ApplyROMPatch(&rom_data, &patches[i]) != 0 || ComputeSHA256(-1, rom_data.rom_data, rom_data.rom_size, patched_sha256) != 0)
+		{
+			result = 1;
+			break;
+		}
+
+		printf("    {\"");
+		for(j = 0; j < 32; j++)
+		{
+			printf("%02x", rom_data.rom_sha256[j]);
+		}
+		printf("\", %d, %d, %d, \"", patches[i].compat_mode, patches[i].drum_compat_mode, patches[i].update_version);
+		for(j = 0; j < 32; j++)
+		{
+			printf("%02x", patched_sha256[j]);
+		}
+		printf("\"},\n");
+	}
 
+	free(patches);
 	DestroyROM(&rom_data);
-	return 0;
+	return result;
+}
+
+int self_test(void)
+{
+	static const int lane_counts[2] = { 8, 16 };
+	int backend;
+	int failures;
+	int multi_failures;
+	int fill_failures;
+	int journal_failures;
+	int i;
+
+	printf("Selected SHA-256 backend: %s\n", GetSHA256BackendName(GetSHA256Backend()));
+
+	failures = SelfTestSHA256();
+	multi_failures = SelfTestSHA256Multi();
+	if(failures < 0 || multi_failures < 0)
+	{
+		printf("Unable to allocate self-test buffer.\n");
+		return 1;
+	}
+
+	if(SelfTestHashIndex() != 0)
+	{
+		printf("Built-in hash index does not match the known ROM hashes.\n");
+		return 1;
+	}
+	printf("Built-in hash index ok\n");
+
+	fill_failures = SelfTestFillKernels();
+	if(fill_failures != 0)
+	{
+		printf(fill_failures < 0 ? "Unable to allocate self-test buffer.\n" : "Tone fill kernels do not match the portable kernel.\n");
+		return 1;
+	}
+	printf("Tone fill kernels ok\n");
+
+	journal_failures = SelfTestPatchJournal();
+	if(journal_failures != 0)
+	{
+		printf(journal_failures < 0 ? "Unable to allocate self-test buffer.\n" : journal_failures == 2 ? "PatchROM does not update the version bytes.\n" : "Patch journals do not reproduce PatchROM.\n");
+		return 1;
+	}
+	printf("Patch journals ok\n");
+
+	for(backend = 0; backend < SC55_SHA256_BACKEND_COUNT; backend++)
+	{
+		if(!SHA256BackendAvailable(backend))
+		{
+			printf("  %-10s unavailable\n", GetSHA256BackendName(backend));
+			continue;
+		}
+
+		printf("  %-10s %s\n", GetSHA256BackendName(backend), (failures & (1 << backend)) ? "FAILED" : "ok");
+	}
+
+	printf("Multi-buffer SHA-256 lanes: %d\n", GetSHA256Lanes());
+	for(i = 0; i < 2; i++)
+	{
+		if(!SHA256LanesAvailable(lane_counts[i]))
+		{
+			printf("  %-2d lanes   unavailable\n", lane_counts[i]);
+			continue;
+		}
+
+		printf("  %-2d lanes   %s\n", lane_counts[i], (multi_failures & (1 << i)) ? "FAILED" : "ok");
+	}
+
+	return (failures || multi_failures) ? 1 : 0;
 }
 
 void print_help(void)
 {
 	printf("Usage: CTFPatch [options] -i [FILE] -o [FILE]\n");
+	printf("       CTFPatch [options] -b [MANIFEST|DIR] -o [TEMPLATE]\n");
 	printf("Options:\n");
-	printf("  -i FILE  Path to input ROM\n");
-	printf("  -o FILE  Path to output ROM\n");
+	printf("  -i FILE  Path to input ROM, or - for stdin\n");
+	printf("  -o FILE  Path to output ROM, or - for stdout\n");
+	printf("  -b PATH  Batch mode: patch every ROM in a directory\n");
+	printf("           tree or listed in a manifest file\n");
+	printf("  -j N     Number of batch worker threads\n");
+	printf("           Defaults to one per core\n");
 	printf("  -c       If set, will ignore unknown checksums\n");
 	printf("  -s ARG   Which SC-55 compatibility mode to use\n");
 	printf("           Valid values: strict sc55 mkii\n");
@@ -157,9 +491,48 @@ void print_help(void)
 	printf("           Defaults to early if unset\n");
 	printf("  -v       Do not update ROM version string\n");
 	printf("           for known checksums.\n");
+	printf("  -m       Memory-map the input ROM instead\n");
+	printf("           of reading it into a buffer\n");
+	printf("  -a       Write all six -s and -d combinations\n");
+	printf("           from a single read of the input ROM\n");
+	printf("  -D       In batch mode, patch identical ROMs once\n");
+	printf("           and link their other outputs to it\n");
+	printf("  -C DIR   Cache patch results in DIR and reuse\n");
+	printf("           them for ROMs with the same checksum\n");
+	printf("  -H FILE  Also recognise ROMs listed in a hash\n");
+	printf("           database built with -M\n");
+	printf("  -M FILE  Build the hash database given by -o from\n");
+	printf("           a listing of: sha256 size version_address name\n");
+	printf("  -t       Run the SHA-256, tone fill and\n");
+	printf("           patch journal self-tests and exit\n");
+	printf("  --stats  Print phase timings, byte counts and fill\n");
+	printf("           counts as JSON when done\n");
+	printf("  --serve SOCKET\n");
+	printf("           Run a patch server on a Unix socket, using\n");
+	printf("           -j workers and the -H and -C settings\n");
+	printf("  --server SOCKET\n");
+	printf("           Have the server on SOCKET patch the ROM,\n");
+	printf("           falling back to patching locally; defaults\n");
+	printf("           to $CTFPATCH_SERVER\n");
+	printf("  --patched-hashes\n");
+	printf("           Print SC55_PATCHED_HASHES entries for\n");
+	printf("           every patch of the -i ROM and exit\n");
+	printf("  --io-uring\n");
+	printf("           In batch mode, keep many reads and writes\n");
+	printf("           in flight with io_uring where available\n");
+	printf("  --scan DIR\n");
+	printf("           List the known ROMs under DIR as JSON\n");
+	printf("           lines, to -o or stdout, without patching\n");
 	printf("  -h       Display this information\n");
 	printf("\n");
 	printf("Notes:\n");
-	printf("-i and -o are required\n");
+	printf("-i and -o are required unless -t, -b or --scan is used\n");
+	printf("In batch mode, -o is a template where %%p is the input's\n");
+	printf("directory relative to the batch source, %%f its file name,\n");
+	printf("%%n its name without extension and %%e its extension.\n");
+	printf("Manifest lines may give an explicit output after a tab.\n");
+	printf("With -a, -o is a template that must contain %%s for the\n");
+	printf("compatibility mode and %%d for the drum mode; the batch\n");
+	printf("tokens can be used with -i as well.\n");
 	return;
 }